@@ -3,6 +3,7 @@
 
 #include <iomanip>
 #include <memory>
+#include <unordered_map>
 
 //#include "xdata/InfoSpace.h"
 #include "xdata/InfoSpaceFactory.h"
@@ -21,9 +22,11 @@
 #include "gem/utils/GEMRegisterUtils.h"
 
 #include "gem/utils/Lock.h"
+#include "gem/utils/HwLock.h"
 #include "gem/utils/LockGuard.h"
 
 #include "gem/hw/exception/Exception.h"
+#include "gem/hw/GEMHwRetryPolicy.h"
 
 typedef uhal::exception::exception uhalException;
 
@@ -39,6 +42,10 @@ typedef std::vector<addressed_register_pair>    addressed_register_pair_list;
 typedef std::pair<std::pair<uint32_t, uint32_t>, uint32_t> masked_register_pair;
 typedef std::vector<masked_register_pair>                  masked_register_pair_list;
 
+// for reading a memory block into several destinations with a single dispatch
+typedef std::pair<uint32_t*, size_t> block_chunk;
+typedef std::vector<block_chunk>     block_chunk_list;
+
 typedef std::pair<std::string, uhal::ValWord<uint32_t> > register_value;
 typedef std::vector<register_value>                      register_val_list;
 
@@ -54,12 +61,6 @@ namespace gem {
     {
 
     public:
-      /* IPBus transactions still have some problems in the firmware
-         so it helps to retry a few times in the case of a failure
-         that is recognized
-      */
-      static const unsigned MAX_IPBUS_RETRIES = 5;
-
       /**
        * @struct OpticalLinkStatus
        * @brief This structure stores retrieved counters related to the GTX link
@@ -107,6 +108,231 @@ namespace gem {
       typedef std::pair<uint8_t, OpticalLinkStatus>  linkStatus;
       //typedef std::vector<linkStatus>                linkStatus;
 
+      /**
+       * @struct RegisterHandle
+       * @brief A register resolved once in the address table, so that accessing it
+       *        needs neither building its name nor looking up its node again
+       * @var RegisterHandle::name
+       * name is the full name of the register in the address table
+       * @var RegisterHandle::address
+       * address is the address of the register
+       * @var RegisterHandle::mask
+       * mask is the mask of the register
+       * @var RegisterHandle::node
+       * node is the uhal node of the register, owned by the device's uhal::HwInterface
+       */
+      typedef struct RegisterHandle {
+        std::string       name   ;
+        uint32_t          address;
+        uint32_t          mask   ;
+        uhal::Node const* node   ;
+
+      RegisterHandle() :
+        address(0x0),mask(0xffffffff),node(NULL) {};
+        bool isValid() const { return node != NULL; };
+      } RegisterHandle;
+
+      /**
+       * @class Batch
+       * @brief Collects register and block operations to send to the device in a
+       *        single transaction (one dispatch call)
+       *
+       * Operations are sent in the order they were queued. Reads return a handle
+       * to their result, which holds the value once commit() has succeeded.
+       * commit() takes the device lock for each attempt at the transaction and, on an
+       * IPBus error, retries the whole batch as the GEMHwRetryPolicy of the device
+       * allows, so a retried batch repeats its writes as well. The lock is released
+       * during the backoff, so other users of the device may access it between two
+       * attempts.
+       * The handles refer to the batch, which must outlive them.
+       */
+      class Batch
+      {
+      public:
+        /**
+         * @class Handle
+         * @brief Result of a register read queued in a Batch
+         */
+        class Handle
+        {
+        public:
+          Handle() : p_batch(NULL), m_index(0) {};
+
+          /**
+           * @retval true once the batch holding the read has been committed successfully
+           */
+          bool ready() const { return p_batch != NULL && p_batch->m_committed; };
+
+          /**
+           * @retval the value read, 0 until the batch has been committed successfully
+           */
+          uint32_t value() const { return ready() ? p_batch->m_values[m_index] : 0x0; };
+
+        private:
+          friend class Batch;
+          Handle(Batch const* batch, size_t const& index) : p_batch(batch), m_index(index) {};
+
+          Batch const* p_batch;
+          size_t       m_index;
+        };  // class Handle
+
+        /**
+         * @class BlockHandle
+         * @brief Result of a block read queued in a Batch
+         */
+        class BlockHandle
+        {
+        public:
+          BlockHandle() : p_batch(NULL), m_index(0) {};
+
+          bool ready() const { return p_batch != NULL && p_batch->m_committed; };
+
+          /**
+           * @retval the words read, empty until the batch has been committed successfully
+           */
+          std::vector<uint32_t> const& values() const {
+            return ready() ? p_batch->m_blocks[m_index] : s_noValues; };
+
+        private:
+          friend class Batch;
+          BlockHandle(Batch const* batch, size_t const& index) : p_batch(batch), m_index(index) {};
+
+          Batch const* p_batch;
+          size_t       m_index;
+
+          static const std::vector<uint32_t> s_noValues;
+        };  // class BlockHandle
+
+        explicit Batch(GEMHwDevice& device);
+
+        /**
+         * read(std::string const& regName)
+         * @param regName name of the register to read
+         * @retval handle to the value read
+         */
+        Handle read(std::string const& regName);
+
+        /**
+         * read(std::string const& regPrefix, std::string const& regName)
+         * @param regPrefix prefix in the address table, possibly root nodes
+         * @param regName name of the register to read from the address table
+         * @retval handle to the value read
+         */
+        Handle read(std::string const& regPrefix, std::string const& regName) {
+          return read(regPrefix+"."+regName); };
+
+        /**
+         * read(uint32_t const& regAddr, uint32_t const& regMask)
+         * @param regAddr address of the register to read
+         * @param regMask mask of the register to read
+         * @retval handle to the value read
+         */
+        Handle read(uint32_t const& regAddr, uint32_t const& regMask=0xffffffff);
+
+        /**
+         * read(RegisterHandle const& reg)
+         * @param reg register resolved by GEMHwDevice::getRegisterHandle
+         * @retval handle to the value read
+         */
+        Handle read(RegisterHandle const& reg);
+
+        /**
+         * write(std::string const& regName, uint32_t const& val)
+         * @param regName name of the register to write to
+         * @param val value to write to the register
+         */
+        void write(std::string const& regName, uint32_t const& val);
+
+        void write(std::string const& regPrefix, std::string const& regName, uint32_t const& val) {
+          write(regPrefix+"."+regName, val); };
+
+        /**
+         * write(uint32_t const& regAddr, uint32_t const& val)
+         * @param regAddr address of the register to write to
+         * @param val value to write to the register
+         */
+        void write(uint32_t const& regAddr, uint32_t const& val);
+
+        /**
+         * write(RegisterHandle const& reg, uint32_t const& val)
+         * @param reg register resolved by GEMHwDevice::getRegisterHandle
+         * @param val value to write to the register
+         */
+        void write(RegisterHandle const& reg, uint32_t const& val);
+
+        /**
+         * readBlock(std::string const& regName, size_t const& nWords)
+         * @param regName memory block or FIFO to read from
+         * @param nWords number of words to read
+         * @retval handle to the words read
+         */
+        BlockHandle readBlock(std::string const& regName, size_t const& nWords);
+
+        /**
+         * readBlock(std::string const& regName, block_chunk_list const& chunks)
+         * read consecutive chunks of a memory block or FIFO straight into their destinations,
+         * which must stay valid until the batch has been committed
+         * @param regName memory block or FIFO to read from
+         * @param chunks destinations and number of words to read into each, in order
+         */
+        void readBlock(std::string const& regName, block_chunk_list const& chunks);
+
+        /**
+         * writeBlock(std::string const& regName, std::vector<uint32_t> const& values)
+         * @param regName memory block to write to
+         * @param values list of 32-bit words to write into the memory block
+         */
+        void writeBlock(std::string const& regName, std::vector<uint32_t> const& values);
+
+        /**
+         * commit()
+         * send all the queued operations in a single transaction
+         * @retval true if the transaction succeeded and the handles hold their values
+         */
+        bool commit();
+
+        /**
+         * clear()
+         * drop all the queued operations and their results, invalidating the handles
+         */
+        void clear();
+
+        size_t size()        const { return m_ops.size(); };
+        bool   empty()       const { return m_ops.empty(); };
+        bool   isCommitted() const { return m_committed; };
+
+        GEMHwDevice& getDevice() const { return m_device; };
+
+      private:
+        enum OpType { NAMED_READ, ADDRESSED_READ, NODE_READ, NAMED_WRITE, ADDRESSED_WRITE, NODE_WRITE,
+                      BLOCK_READ, BLOCK_WRITE, CHUNK_READ };
+
+        typedef struct Op {
+          OpType      type;
+          std::string name;
+          uhal::Node const* node;
+          uint32_t    address;
+          uint32_t    mask;
+          uint32_t    value;
+          size_t      nWords;
+          size_t      result;  ///< index into m_values for reads, into m_blocks for blocks
+          uint32_t*   dest;    ///< where a chunk read is copied to
+        } Op;
+
+        std::string describe() const;
+
+        GEMHwDevice& m_device;
+
+        std::vector<Op>                     m_ops;
+        std::vector<uint32_t>               m_values;
+        std::vector<std::vector<uint32_t> > m_blocks;
+        bool                                m_committed;
+
+        // Prevent copying.
+        Batch(Batch const&);
+        Batch& operator=(Batch const&);
+      };  // class Batch
+
       /**
        * GEMHwDevice constructor
        * @param deviceName string to put into the logger
@@ -166,6 +392,13 @@ namespace gem {
                         const std::string &regName) {
         return readReg(regPrefix+"."+regName); };
 
+      /**
+       * readReg(RegisterHandle const& reg)
+       * @param reg register resolved by getRegisterHandle
+       * @retval returns the 32 bit unsigned value in the register
+       */
+      uint32_t readReg( RegisterHandle const& reg);
+
       /**
        * readMaskedAddress(std::string const& regName)
        * @param regName name of the register to read
@@ -222,6 +455,13 @@ namespace gem {
                          uint32_t const val) {
         return writeReg(regPrefix+"."+regName, val); };
 
+      /**
+       * writeReg(RegisterHandle const& reg, uint32_t const val)
+       * @param reg register resolved by getRegisterHandle
+       * @param val value to write to the register
+       */
+      void     writeReg( RegisterHandle const& reg, uint32_t const val);
+
       /**
        * writeRegs(register_pair_list const& regList)
        * write list of registers in a single transaction (one dispatch call)
@@ -271,10 +511,42 @@ namespace gem {
       std::vector<uint32_t> readBlock( std::string const& regName,
                                        size_t      const& nWords);
 
+      /**
+       * readBlock(std::string const& regName, uint32_t* buffer, size_t const nWords)
+       * read from a memory block directly into a caller owned buffer
+       * @param regName memory block to read from
+       * @param buffer destination, must have space for at least nWords
+       * @param nWords number of words to read
+       * @retval returns the number of words copied into the buffer
+       */
       uint32_t readBlock(std::string const& regName, uint32_t* buffer, size_t const& nWords);
+
+      /**
+       * readBlock(std::string const& regName, std::vector<toolbox::mem::Reference*>& buffer, size_t const nWords)
+       * read from a memory block into memory pool frames, the frames are filled in order,
+       * the data is appended after any data already present, and the data size of each frame is updated
+       * @param regName memory block to read from
+       * @param buffer frames to fill, allocated by the caller
+       * @param nWords maximum number of words to read, fewer are read if the frames are full
+       * @retval returns the number of words copied into the frames
+       */
       uint32_t readBlock(std::string const& regName, std::vector<toolbox::mem::Reference*>& buffer,
                          size_t const& nWords);
 
+      /**
+       * readBlockAndReg(std::string const& blockName, block_chunk_list const& chunks,
+       *                 std::string const& regName, uint32_t& regValue)
+       * read consecutive chunks of a memory block and then a register in a single transaction
+       * (one dispatch call), e.g., drain part of a FIFO and see how much is left behind
+       * @param blockName memory block to read from
+       * @param chunks destinations and number of words to read into each, in order
+       * @param regName register to read after the block
+       * @param regValue set to the value of regName
+       * @retval returns the total number of words copied into the chunks
+       */
+      uint32_t readBlockAndReg(std::string const& blockName, block_chunk_list const& chunks,
+                               std::string const& regName, uint32_t& regValue);
+
       /**
        * writeBlock(std::string const& regName, std::vector<uint32_t> const values)
        * write to a memory block
@@ -363,13 +635,52 @@ namespace gem {
 
       uhal::HwInterface& getGEMHwInterface() const;
 
+      /**
+       * getRegisterHandle(std::string const& regName)
+       * resolve a register in the address table, once per device, later calls return
+       * the cached handle, which stays valid for the lifetime of the device
+       * @param regName name of the register
+       * @retval returns the resolved register
+       * @throws uhal::exception::exception if the register is not in the address table
+       */
+      RegisterHandle const& getRegisterHandle(std::string const& regName) const;
+
+      RegisterHandle const& getRegisterHandle(std::string const& regPrefix,
+                                              std::string const& regName) const {
+        return getRegisterHandle(regPrefix+"."+regName); };
+
       std::string getLoggerName() const {
         return m_gemLogger.getName(); };
 
-      void updateErrorCounters(std::string const& errCode);
-
       virtual std::string printErrorCounts() const;
 
+      /**
+       * @returns the counters and latency histogram of the retries of the device transactions
+       */
+      GEMHwRetryPolicy::Stats getRetryStats() const {
+        return p_retryPolicy->getStats(); };
+
+      /**
+       * @retval false while the transactions are refused after the device failed persistently
+       */
+      bool isHealthy() const {
+        return p_retryPolicy->isHealthy(); };
+
+      /**
+       * @brief replace the retry policy, e.g., with different settings or one shared by several devices
+       */
+      void setRetryPolicy(std::shared_ptr<GEMHwRetryPolicy> policy) {
+        if (policy) p_retryPolicy = policy; };
+
+      std::shared_ptr<GEMHwRetryPolicy> getRetryPolicy() const {
+        return p_retryPolicy; };
+
+      /**
+       * @returns the contention counters of the lock serializing the access to the device
+       */
+      gem::utils::HwLock::Stats getLockStats() const {
+        return p_hwLock->getStats(); };
+
       /**
        * @brief performs a general reset of the GLIB
        */
@@ -400,7 +711,15 @@ namespace gem {
 
       log4cplus::Logger m_gemLogger;
 
-      mutable gem::utils::Lock m_hwLock;
+      /** serializes the access to the device, readout before control before monitoring,
+          see gem::utils::HwLock::AccessScope, shared with the other objects of the same device */
+      std::shared_ptr<gem::utils::HwLock> p_hwLock;
+
+      /** registers already resolved, keyed by their full name */
+      mutable std::unordered_map<std::string, RegisterHandle> m_registerHandles;
+
+      /** decides how the failed transactions of the device are retried */
+      std::shared_ptr<GEMHwRetryPolicy> p_retryPolicy;
 
       void setParametersFromInfoSpace();
       void setup(std::string const& deviceName);
@@ -426,7 +745,7 @@ namespace gem {
       xdata::UnsignedInteger32 xs_controlHubPort;
       xdata::UnsignedInteger32 xs_ipBusPort;
 
-      bool knownErrorCode(std::string const& errCode) const;
+      void countError(GEMHwRetryPolicy::ErrorClass const& errClass);
 
       //std::string registerToChar(uint32_t value) const;
     };  // class GEMHwDevice
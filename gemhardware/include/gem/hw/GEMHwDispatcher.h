@@ -0,0 +1,208 @@
+/** @file GEMHwDispatcher.h */
+
+#ifndef GEM_HW_GEMHWDISPATCHER_H
+#define GEM_HW_GEMHWDISPATCHER_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "toolbox/Task.h"
+
+#include "gem/hw/GEMHwDevice.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @class GEMHwDispatcher
+     * @brief Runs hardware jobs on a pool of threads, so that one thread can keep the
+     *        transactions of several devices in flight at the same time
+     *
+     * Each device is given to one of the threads the first time a job is submitted for it,
+     * so the jobs of one device run in the order they were submitted and never compete for
+     * its lock, while the jobs of different devices run concurrently. submit() returns at
+     * once with a Request, which the caller waits on when it needs the outcome.
+     */
+    class GEMHwDispatcher
+    {
+    public:
+      static const unsigned kSTOP_WARN_MSEC;  ///< interval of the warnings while the destructor waits for the threads to exit
+
+      /**
+       * @class Job
+       * @brief Work to run on the thread of a device
+       */
+      class Job
+      {
+      public:
+        virtual ~Job() {};
+
+        /**
+         * Perform the work, failures are reported by throwing
+         */
+        virtual void run() = 0;
+      };  // class Job
+
+      /**
+       * @class MemberJob
+       * @brief Job calling a member function of an object for one index, e.g., an AMC slot
+       */
+      template <class T>
+        class MemberJob : public Job
+        {
+        public:
+          typedef void (T::*method)(unsigned const&);
+
+          MemberJob(T* object, method func, unsigned const& index) :
+            p_object(object), m_method(func), m_index(index) {};
+
+          virtual void run() { (p_object->*m_method)(m_index); };
+
+        private:
+          T*       p_object;
+          method   m_method;
+          unsigned m_index;
+        };  // class MemberJob
+
+      /**
+       * @class Request
+       * @brief Outcome of a submitted job
+       */
+      class Request
+      {
+      public:
+        /**
+         * @retval true once the job has run, or has been dropped
+         */
+        bool ready() const { return m_done; };
+
+        /**
+         * @retval true if the job has run without throwing
+         */
+        bool succeeded() const { return m_done && m_succeeded; };
+
+        /**
+         * @retval the message of the exception that made the job fail
+         */
+        std::string const& error() const { return m_error; };
+
+        std::string const& deviceName() const { return m_deviceName; };
+
+      private:
+        friend class GEMHwDispatcher;
+        Request(std::shared_ptr<Job> job, std::string const& deviceName) :
+          p_job(job), m_deviceName(deviceName), m_done(false), m_succeeded(false) {};
+
+        std::shared_ptr<Job> p_job;
+        std::string          m_deviceName;
+        volatile bool        m_done;
+        bool                 m_succeeded;
+        std::string          m_error;
+      };  // class Request
+
+      typedef std::shared_ptr<Request> request_ptr;
+
+      /**
+       * @param name used in the log messages
+       * @param nThreads number of devices that can be accessed at the same time
+       */
+      GEMHwDispatcher(std::string const& name, unsigned const& nThreads);
+
+      ~GEMHwDispatcher();
+
+      /**
+       * Queue a job on the thread of a device
+       * @param device the job accesses, jobs for the same device run in order
+       * @param job work to run
+       * @retval the request to wait on
+       */
+      request_ptr submit(GEMHwDevice const& device, std::shared_ptr<Job> job);
+
+      /**
+       * Queue the commit of a batch on the thread of its device
+       * @param batch to commit, must outlive the request, the commit failing fails the request
+       * @retval the request to wait on
+       */
+      request_ptr submit(GEMHwDevice::Batch& batch);
+
+      /**
+       * Wait until a job has run
+       * @retval true if it succeeded
+       */
+      bool wait(request_ptr const& request);
+
+      /**
+       * Wait until all the jobs have run, the failures are logged
+       * @retval true if all of them succeeded
+       */
+      bool waitAll(std::vector<request_ptr> const& requests);
+
+      /**
+       * Body of the worker threads
+       * @param index of the worker thread
+       */
+      int workerTask(unsigned const& index);
+
+    private:
+      /**
+       * Job committing a batch
+       */
+      class CommitJob : public Job
+      {
+      public:
+        explicit CommitJob(GEMHwDevice::Batch& batch) : m_batch(batch) {};
+        virtual void run();
+
+      private:
+        GEMHwDevice::Batch& m_batch;
+      };  // class CommitJob
+
+      typedef struct Worker {
+        std::deque<request_ptr>        queue;
+        std::shared_ptr<toolbox::Task> task;
+        volatile bool                  done;
+      } Worker;
+
+      /**
+       * @returns the worker the device is given to, must be called with m_mutex held
+       */
+      unsigned workerFor(GEMHwDevice const& device);
+
+      std::string       m_name;
+      log4cplus::Logger m_gemLogger;
+
+      pthread_mutex_t m_mutex;
+      pthread_cond_t  m_queued;    ///< a job was queued, or the workers have to exit
+      pthread_cond_t  m_finished;  ///< a job has run
+
+      std::vector<std::shared_ptr<Worker> >    m_workers;
+      std::map<GEMHwDevice const*, unsigned>   m_assignments;
+      unsigned                                 m_nextWorker;
+      bool                                     m_exit;
+
+      // Prevent copying.
+      GEMHwDispatcher(GEMHwDispatcher const&);
+      GEMHwDispatcher& operator=(GEMHwDispatcher const&);
+    };  // class GEMHwDispatcher
+
+    class GEMHwDispatcherTask : public toolbox::Task {
+    public:
+    GEMHwDispatcherTask(GEMHwDispatcher* dispatcher, unsigned const& index) : toolbox::Task("GEMHwDispatcherTask")
+        {
+          p_dispatcher = dispatcher;
+          m_index      = index;
+        }
+      virtual int svc() { return p_dispatcher->workerTask(m_index); }
+    private:
+      GEMHwDispatcher* p_dispatcher;
+      unsigned         m_index;
+    };
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWDISPATCHER_H
@@ -0,0 +1,233 @@
+/** @file GEMHwRetryPolicy.h */
+
+#ifndef GEM_HW_GEMHWRETRYPOLICY_H
+#define GEM_HW_GEMHWRETRYPOLICY_H
+
+#include <string>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+
+    /**
+     * @class GEMHwRetryPolicy
+     * @brief Decides whether a failed IPBus transaction is retried, how long to wait before
+     *        retrying, and when a device failing persistently is no longer accessed
+     *
+     * The failures are classified from the uhal error message, and each class allows its
+     * own number of attempts; unrecognized errors are not retried. Transactions made for
+     * monitoring, see gem::utils::HwLock::AccessScope, are given fewer attempts. Between
+     * two attempts the caller waits for a backoff that doubles with each retry, shortened
+     * by a random jitter so that the devices behind one ControlHub do not retry in step.
+     *
+     * After failureThreshold consecutive transactions have failed with a recognized IPBus
+     * error, the circuit breaker opens: the device is marked unhealthy and its transactions
+     * are refused without accessing it. Transactions failing with an unknown error do not
+     * count toward the threshold. Once openTime has passed, a single transaction is let through as a
+     * probe, without retries. Its success closes the breaker, its failure keeps it open
+     * for another openTime.
+     */
+    class GEMHwRetryPolicy
+    {
+    public:
+      enum ErrorClass {
+        BAD_HEADER = 0,  ///< wrong amount of data in the reply
+        READ_ERROR = 1,  ///< IPBus read error reported by the device
+        TIMEOUT    = 2,  ///< no reply from the device or from the ControlHub
+        CONTROLHUB = 3,  ///< error reported by the ControlHub
+        UNKNOWN    = 4   ///< anything else, not retried by default
+      };
+      static const unsigned kN_ERROR_CLASSES = 5;
+      static const unsigned kN_LATENCY_BINS  = 8;
+
+      /**
+       * @struct Settings
+       * @brief Tunable parameters of the policy, all times in microseconds
+       * @var Settings::maxAttempts
+       * maxAttempts is the number of attempts allowed, first one included, when a transaction fails with each class of error
+       * @var Settings::maxMonitorAttempts
+       * maxMonitorAttempts caps the attempts of the transactions made for monitoring
+       * @var Settings::initialBackoff
+       * initialBackoff is the wait before the first retry
+       * @var Settings::maxBackoff
+       * maxBackoff caps the wait before any retry
+       * @var Settings::jitter
+       * jitter is the largest fraction of the backoff randomly taken off each wait
+       * @var Settings::failureThreshold
+       * failureThreshold is the number of consecutive transactions failed with an IPBus error that opens the circuit breaker
+       * @var Settings::openTime
+       * openTime is how long the circuit breaker stays open before a probe is let through
+       */
+      typedef struct Settings {
+        unsigned maxAttempts[kN_ERROR_CLASSES];
+        unsigned maxMonitorAttempts;
+        uint32_t initialBackoff;
+        uint32_t maxBackoff;
+        double   jitter;
+        unsigned failureThreshold;
+        uint32_t openTime;
+
+        Settings();
+      } Settings;
+
+      /**
+       * @struct Stats
+       * @brief Counters of the policy
+       * @var Stats::nTransactions
+       * nTransactions is the number of transactions attempted, not counting the refused ones
+       * @var Stats::nRetried
+       * nRetried is the number of transactions that needed more than one attempt
+       * @var Stats::nFailed
+       * nFailed is the number of transactions that failed after all their attempts
+       * @var Stats::nRejected
+       * nRejected is the number of transactions refused while the circuit breaker was open
+       * @var Stats::nErrors
+       * nErrors is the number of failed attempts by class of error
+       * @var Stats::retryLatency
+       * retryLatency is the histogram of the time the retried transactions took, see latencyBinLabel
+       * @var Stats::healthy
+       * healthy is false while the circuit breaker is open
+       */
+      typedef struct Stats {
+        uint64_t nTransactions;
+        uint64_t nRetried;
+        uint64_t nFailed;
+        uint64_t nRejected;
+        uint64_t nErrors[kN_ERROR_CLASSES];
+        uint64_t retryLatency[kN_LATENCY_BINS];
+        bool     healthy;
+
+        Stats() { reset(); };
+        void reset() {
+          nTransactions = 0; nRetried = 0; nFailed = 0; nRejected = 0;
+          for (unsigned errClass = 0; errClass < kN_ERROR_CLASSES; ++errClass)
+            nErrors[errClass] = 0;
+          for (unsigned bin = 0; bin < kN_LATENCY_BINS; ++bin)
+            retryLatency[bin] = 0;
+          healthy = true;
+          return; };
+      } Stats;
+
+      /**
+       * @class Transaction
+       * @brief Tracks the attempts of one transaction, used as
+       *        while (t.attempt()) { try { ...; t.succeeded(); } catch (...) { t.failed(what); } }
+       */
+      class Transaction
+      {
+      public:
+        explicit Transaction(GEMHwRetryPolicy& policy);
+        ~Transaction();
+
+        /**
+         * Wait for the backoff if this is a retry
+         * @retval true if the transaction should be sent (again), false once it has
+         *         succeeded, has run out of attempts, or was refused
+         */
+        bool attempt();
+
+        void succeeded();
+
+        /**
+         * Record a failed attempt
+         * @param what message of the exception
+         * @retval the class of the error
+         */
+        ErrorClass failed(std::string const& what);
+
+        bool     willRetry() const { return m_retry; };
+        bool     rejected()  const { return m_rejected; };
+        unsigned attempts()  const { return m_attempts; };
+
+      private:
+        void finish(bool const& success);
+
+        GEMHwRetryPolicy& m_policy;
+        unsigned          m_attempts;
+        bool              m_admitted;
+        bool              m_probe;
+        bool              m_retry;
+        bool              m_rejected;
+        bool              m_finished;
+        ErrorClass        m_lastError;  ///< class of the last failed attempt
+        uint64_t          m_start;
+
+        // Prevent copying.
+        Transaction(Transaction const&);
+        Transaction& operator=(Transaction const&);
+      };  // class Transaction
+
+      /**
+       * @param logger of the device the policy applies to
+       */
+      explicit GEMHwRetryPolicy(log4cplus::Logger const& logger);
+      virtual ~GEMHwRetryPolicy();
+
+      /**
+       * Classify a failure from the message of the uhal exception
+       */
+      virtual ErrorClass classify(std::string const& what) const;
+
+      /**
+       * @param retry number of the retry, starting from 1
+       * @retval the time to wait before the retry, in microseconds
+       */
+      virtual uint32_t backoff(unsigned const& retry);
+
+      Settings getSettings() const;
+      void     setSettings(Settings const& settings);
+
+      /**
+       * @returns a snapshot of the counters
+       */
+      Stats getStats() const;
+
+      /**
+       * Reset the counters and close the circuit breaker
+       */
+      void reset();
+
+      bool isHealthy() const;
+
+      static std::string errorClassName(unsigned const& errClass);
+
+      /**
+       * @returns the label of a bin of the latency histogram, e.g., LT_4MS,
+       *          the bins grow by a factor 4 from 1 ms and the last one holds the overflow
+       */
+      static std::string latencyBinLabel(unsigned const& bin);
+
+    private:
+      enum Admission { REFUSED, NORMAL, PROBE };
+
+      static uint64_t now();
+
+      Admission admit();
+      void      recordError(ErrorClass const& errClass);
+      void      recordOutcome(bool const& success, bool const& probe, unsigned const& attempts,
+                              uint64_t const& elapsed, ErrorClass const& lastError);
+
+      log4cplus::Logger m_gemLogger;
+
+      mutable pthread_mutex_t m_mutex;
+
+      Settings m_settings;
+      Stats    m_stats;
+      unsigned m_consecutiveFailures;
+      uint64_t m_openedAt;
+      bool     m_probing;
+      unsigned m_seed;
+
+      // Prevent copying.
+      GEMHwRetryPolicy(GEMHwRetryPolicy const&);
+      GEMHwRetryPolicy& operator=(GEMHwRetryPolicy const&);
+    };  // class GEMHwRetryPolicy
+
+  }  // namespace gem::hw
+}  // namespace gem
+
+#endif  // GEM_HW_GEMHWRETRYPOLICY_H
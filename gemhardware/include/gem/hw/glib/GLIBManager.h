@@ -14,6 +14,8 @@
 
 namespace gem {
   namespace hw {
+    class GEMHwDispatcher;
+
     namespace glib {
 
       class HwGLIB;
@@ -73,6 +75,12 @@ namespace gem {
 	  //uint16_t parseAMCEnableList(std::string const&);
 	  //bool     isValidSlotNumber( std::string const&);
           void     createGLIBInfoSpaceItems(is_toolbox_ptr is_glib, glib_shared_ptr glib);
+
+          /**
+           * Configure the GLIB in one slot, run by the dispatcher thread of the GLIB
+           * @param slot index of the GLIB in m_glibs
+           */
+          void     configureGLIB(unsigned const& slot);
           uint16_t m_amcEnableMask;
 
           class GLIBInfo {
@@ -121,6 +129,8 @@ namespace gem {
           std::array<std::shared_ptr<GLIBMonitor>, MAX_AMCS_PER_CRATE> m_glibMonitors;
           std::array<is_toolbox_ptr, MAX_AMCS_PER_CRATE>               is_glibs;
 
+          std::shared_ptr<gem::hw::GEMHwDispatcher> p_dispatcher;  ///< accesses the GLIBs concurrently
+
           xdata::Vector<xdata::Bag<GLIBInfo> > m_glibInfo;  // [MAX_AMCS_PER_CRATE];
           xdata::String                        m_amcSlots;
           xdata::String                        m_connectionFile;
@@ -36,6 +36,25 @@ namespace gem {
       private:
         std::shared_ptr<HwGLIB> p_glib;
 
+        /**
+         * @brief resolve the registers of all the monitorables, in the order updateMonitorables visits them
+         */
+        void resolveMonitorables();
+
+        /** registers of each monitorable, the second is only used by the 64 bit and I2C status types */
+        typedef std::pair<GEMHwDevice::RegisterHandle const*, GEMHwDevice::RegisterHandle const*> monitorable_regs;
+        std::vector<monitorable_regs> m_monitorableRegs;
+
+        /** values read for each monitorable, the flag is false for the items that were not read */
+        typedef std::pair<bool, std::pair<uint32_t, uint32_t> > monitorable_vals;
+
+        /**
+         * @brief read the registers of the monitorables [begin, end) in a single transaction
+         * @param vals values of all the monitorables, only the ones in the range are filled
+         * @retval false if the transaction failed, vals is then left untouched
+         */
+        bool readMonitorables(std::vector<monitorable_vals>& vals, size_t const& begin, size_t const& end);
+
         // system_monitorables
         //  "BOARD_ID"
         //  "SYSTEM_ID"
@@ -1,9 +1,19 @@
 #ifndef GEM_HW_GLIB_GLIBREADOUT_H
 #define GEM_HW_GLIB_GLIBREADOUT_H
 
+#include <map>
+
+#include "xdata/Vector.h"
+
 #include "gem/readout/GEMReadoutApplication.h"
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMEventBuilder.h"
+#include "gem/readout/GEMEventSerializer.h"
+#include "gem/readout/GEMEventWriter.h"
+#include "gem/readout/GEMReadoutBuffer.h"
+#include "gem/datachecker/GEMDataChecker.h"
 #include "gem/hw/glib/exception/Exception.h"
+#include "gem/utils/SPSCQueue.h"
 
 namespace gem {
   namespace readout {
@@ -23,6 +33,8 @@ namespace gem {
 
           static const uint32_t kUPDATE;
           static const uint32_t kUPDATE7;
+          static const unsigned kREADER_IDLE_USEC; ///< AMC reader sleep when no link has data
+          static const size_t   kMERGE_BACKLOG;    ///< words a link may hold while waiting for slower links
 
           GLIBReadout(xdaq::ApplicationStub* s);
           //GLIBReadout(xdaq::ApplicationStub* s, glib_shared_ptr glib);
@@ -40,6 +52,13 @@ namespace gem {
            */
           xoap::MessageReference updateScanParameters(xoap::MessageReference message) throw (xoap::exception::Exception);
 
+          /**
+           * Body of the thread polling all enabled links of one AMC, the frames read
+           * are tagged with the slot and link and queued for the readout task
+           * @param index position of the AMC in the list of AMCs being read out
+           */
+          int amcReadoutTask(unsigned const& index);
+
           // reply to a query about the queue depth, better to just export the queue depth into the infospace?
           //xoap::MessageReference queueDepth(xoap::MessageReference message) throw (xoap::exception::Exception);
 
@@ -59,6 +78,8 @@ namespace gem {
 
           virtual int readout(unsigned int expected, unsigned int* eventNumbers, std::vector< ::toolbox::mem::Reference* >& data);
 
+          virtual void processData(std::vector< ::toolbox::mem::Reference* >& data);
+
           uint32_t* dumpData( uint8_t const& mask );
 
           uint32_t* selectData(uint32_t counter[5]);
@@ -67,57 +88,127 @@ namespace gem {
 
           uint32_t* GEMEventMaker(uint32_t counter[5]);
 
-          void GEMevSelector(const uint32_t& ES);
+          /**
+           * Decode the next VFAT block of a single link buffer into the event being built
+           * @param source tag of the link the buffer holds the data of
+           */
+          uint32_t* GEMEventMaker(uint32_t counter[5], gem::readout::GEMReadoutBuffer& buffer,
+                                  uint32_t const& source);
+
+          /**
+           * Write out the events closed by the event builder, in the order they were opened
+           */
+          void writeClosedEvents();
+
+          void GEMevSelector(gem::readout::GEMEventBuilder::Event const& event);
 
           void GEMfillHeaders(uint32_t const& BC, uint32_t const& BX,
                               gem::readout::GEMDataAMCformat::GEMData& gem,
                               gem::readout::GEMDataAMCformat::GEBData& geb);
 
-          bool VFATfillData(/*int const& islot, */gem::readout::GEMDataAMCformat::GEBData& geb);
+          bool VFATfillData(/*int const& islot, */gem::readout::GEMDataAMCformat::GEBData& geb,
+                            size_t const& nVFATs);
 
           void GEMfillTrailers(gem::readout::GEMDataAMCformat::GEMData& gem,
                                gem::readout::GEMDataAMCformat::GEBData& geb);
 
-          void writeGEMevent(std::string outFile,
+          void writeGEMevent(gem::readout::GEMEventWriter& outFile,
                              bool const& OKprint,
                              std::string const& TypeDataFlag,
                              gem::readout::GEMDataAMCformat::GEMData& gem,
                              gem::readout::GEMDataAMCformat::GEBData& geb,
-                             gem::readout::GEMDataAMCformat::VFATData& vfat);
+                             gem::readout::GEMVFATPayloads const& vfats);
 
-          int queueDepth() {return m_dataque.size();}
+          int queueDepth() {return m_dataBuffer.size();}
 
         private:
+          /**
+           * One AMC being read out, polled by its own thread
+           */
+          struct AMCReader {
+            AMCReader() : slot(0), idle(true), done(true) {};
+
+            uint8_t         slot;        ///< uTCA slot, 0 when reading the single DeviceName
+            std::string     deviceName;
+            glib_shared_ptr glib;
+            std::vector<uint32_t> pending;  ///< VFAT blocks left in each link FIFO after the last read
+            std::unique_ptr<gem::utils::SPSCQueue< ::toolbox::mem::Reference*> > frames;  ///< to the readout task
+            std::shared_ptr<toolbox::Task> task;
+            volatile bool   idle;  ///< the thread has seen the readers stop
+            volatile bool   done;  ///< the thread has exited
+          };
+
+          /**
+           * Let the AMC reader threads poll the hardware
+           */
+          void startReaders();
+
+          /**
+           * Stop the AMC reader threads and wait for everything they read to be collected
+           */
+          void stopReaders();
+
+          /**
+           * Merge the per link buffers into events, taking the blocks of the L1A being
+           * built from every link before moving on to the next one
+           * @param flush do not wait for links that have fallen behind
+           */
+          void buildEvents(bool const& flush);
+
+          static uint32_t sourceTag(uint8_t const& slot, uint8_t const& gtx) {
+            return (slot << 8) | gtx; };
+
           uint32_t m_runType;
           uint32_t m_runParams;
 
+          // first AMC read out, used by the polling dumpData path
           glib_shared_ptr p_glib;
 
+          xdata::String            m_amcSlots;  ///< AMC slots to read out, DeviceName alone if empty
+          xdata::Integer           m_crateID;   ///< crate of the AMC slots
+          xdata::UnsignedInteger32 m_linkMask;  ///< GTX links to read out on every AMC
+          xdata::UnsignedInteger32 m_maxBlocksPerRead;  ///< limit on VFAT blocks in one read, 0 for no limit
+          xdata::UnsignedInteger32 m_eventWindow;       ///< events built at the same time, to collect out of order blocks
+          xdata::UnsignedInteger32 m_eventTimeoutMsec;  ///< write out an event this long after its first block, 0 for no timeout
+          xdata::UnsignedInteger32 m_sourceID;          ///< FED id in the CDF header of the binary events
+
+          std::vector<std::shared_ptr<AMCReader> > m_amcReaders;
+          volatile bool m_readersRunning;
+          volatile bool m_readersExit;
+
+          // raw FIFO words of each link waiting to be merged, keyed by the frame source tag
+          std::map<uint32_t, std::shared_ptr<gem::readout::GEMReadoutBuffer> > m_linkBuffers;
+
           // copied in from GEMDataParker
           uint32_t m_ESexp;
           bool     m_isFirst;
           //uint64_t m_ZSFlag;
           uint32_t m_contvfats;
 
-          void readVFATblock(std::queue<uint32_t>& dataque);
+          /**
+           * Decode the next complete VFAT block from the buffer, skipping any misaligned words
+           * @param source tag of the link the buffer holds the data of, for the misalignment counters
+           * @returns false if the buffer does not contain a complete block
+           */
+          bool readVFATblock(gem::readout::GEMReadoutBuffer& buffer, AMCVFATData& vfat,
+                             uint32_t const& source);
+
+          /**
+           * Count the words skipped to realign on a block start
+           */
+          void recordResync(uint32_t const& source, size_t const& nSkipped);
 
-          // this can't be the best way to do this...
-          uint32_t dat10,dat11, dat20,dat21, dat30,dat31, dat40,dat41;
-          uint32_t BX;
-          uint16_t bcn, evn, chipid, vfatcrc;
-          uint16_t b1010, b1100, b1110;
-          uint8_t  flags;
+          /**
+           * Log the chips that had blocks with a CRC mismatch during the run
+           */
+          void reportCRCMismatches();
 
           uint8_t m_latency, m_VT1, m_VT2;
 
-          //why are these global and not part of the header???
-          std::vector<AMCVFATData> m_vfats;
-          std::vector<AMCVFATData> m_erros;
+          // the events being built, keyed by event selector
+          gem::readout::GEMEventBuilder m_eventBuilder;
           int m_rvent;
 
-          static const int MaxVFATS = 24; // was 32 ???
-          static const int MaxERRS  = 4095; // should this also be 24? Or we can accomodate full GLIB FIFO of bad blocks belonging to the same event?
-
           //std::unique_ptr<GEMslotContents> slotInfo;// time to die!!!
 
           //log4cplus::Logger m_gemLogger;
@@ -126,13 +217,28 @@ namespace gem {
           //std::string m_slotFileName; // time to die!!!
           std::string m_errFileName;
           std::string m_outputType;
+          gem::readout::GEMEventSerializer m_serializer;  ///< lays out the events in the output type
+
+          // output files, opened at start and kept open for the whole run
+          std::unique_ptr<gem::readout::GEMEventWriter> m_outWriter;
+          std::unique_ptr<gem::readout::GEMEventWriter> m_errWriter;
 
           // queue safety
           mutable gem::utils::Lock m_queueLock;
-          // The main data flow
-          std::queue<uint32_t> m_dataque;
+          // The main data flow, raw FIFO words waiting to be built into events
+          gem::readout::GEMReadoutBuffer m_dataBuffer;
 
           xdata::UnsignedInteger64 m_queueDepth;
+
+          // misaligned data, the per link vectors are indexed by slot*N_GTX+gtx
+          xdata::UnsignedInteger64 m_resyncCount;   ///< times the data had to be realigned on a block start
+          xdata::UnsignedInteger64 m_skippedWords;  ///< words dropped while realigning
+          xdata::Vector<xdata::UnsignedInteger64> m_resyncCountPerLink;
+          xdata::Vector<xdata::UnsignedInteger64> m_skippedWordsPerLink;
+
+          // CRC of every VFAT block, checked once per built event
+          gem::datachecker::GEMDataChecker m_dataChecker;
+          xdata::UnsignedInteger64 m_crcMismatches;  ///< VFAT blocks whose CRC does not match the data
           /*
            * Counter all in one
            *   [0] VFAT's Blocks counter
@@ -154,6 +260,19 @@ namespace gem {
 
           int16_t m_scanParam;
         };  // class GLIBReadout
+
+      class GLIBAMCReadoutTask : public toolbox::Task {
+      public:
+      GLIBAMCReadoutTask(GLIBReadout* app, unsigned const& index) : toolbox::Task("GLIBAMCReadoutTask")
+          {
+            p_readoutApp = app;
+            m_index      = index;
+          }
+        virtual int svc() { return p_readoutApp->amcReadoutTask(m_index); }
+      private:
+        GLIBReadout* p_readoutApp;
+        unsigned     m_index;
+      };
     }  // namespace gem::hw::glib
   }  // namespace gem::hw
 }  // namespace gem
@@ -428,7 +428,25 @@ namespace gem {
            */
           bool linkCheck(uint8_t const& gtx, std::string const& opMsg);
 
+          /**
+           * Share out a read of whole VFAT blocks over the free space of memory pool frames
+           * @param data frames to fill, in order
+           * @param nBlocks maximum number of VFAT blocks to read
+           * @param chunks set to the destination and number of words of each frame receiving data
+           * @param filled set to the frames receiving data, in the order of the chunks
+           */
+          static void frameChunks(std::vector<toolbox::mem::Reference*> const& data, size_t const& nBlocks,
+                                  block_chunk_list& chunks, std::vector<toolbox::mem::Reference*>& filled);
+
         public:
+          /**
+           * Check whether a gtx was found to be operational when connecting, without logging
+           * @param uint8_t gtx GTX gtx to be queried
+           * @returns true if the gtx is in range and active
+           */
+          bool isLinkActive(uint8_t const& gtx) const {
+            return gtx < N_GTX && b_links[gtx]; };
+
           /**
            * Read the gtx status registers, store the information in a struct
            * @param uint8_t gtx is the number of the gtx to query
@@ -612,12 +630,67 @@ namespace gem {
            * @retval std::vector<uint32_t> returns the 7*nBlocks data words in the buffer
           */
           std::vector<uint32_t> getTrackingData(uint8_t const& gtx, size_t const& nBlocks=1);
-          //which of these will be better and do what we want
+
+          /**
+           * get the tracking data, placing it directly into a caller owned buffer
+           * @param uint8_t gtx is the number of the GTX tracking data to read
+           * @param uint32_t* data is the destination, must have space for 7*nBlocks words
+           * @param size_t nBlocks is the number of VFAT data blocks (7*32bit words) to read
+           * @retval uint32_t returns the number of complete VFAT blocks read
+          */
           uint32_t getTrackingData(uint8_t const& gtx, uint32_t* data, size_t const& nBlocks=1);
-          //which of these will be better and do what we want
+
+          /**
+           * get the tracking data, placing it directly into memory pool frames
+           * frames are filled in order with whole VFAT blocks, appended after any data already present
+           * @param uint8_t gtx is the number of the GTX tracking data to read
+           * @param std::vector<toolbox::mem::Reference*> data frames to fill, allocated by the caller
+           * @param size_t nBlocks is the maximum number of VFAT data blocks (7*32bit words) to read
+           * @retval uint32_t returns the number of complete VFAT blocks read
+          */
           uint32_t getTrackingData(uint8_t const& gtx, std::vector<toolbox::mem::Reference*>& data,
                                    size_t const& nBlocks=1);
 
+          /**
+           * get the tracking data and the FIFO occupancy left behind, in a single IPBus dispatch
+           * the occupancy returned is what the next call should read, so a polling loop
+           * costs one round trip per iteration
+           * @param uint8_t gtx is the number of the GTX tracking data to read
+           * @param uint32_t* data is the destination, must have space for 7*nBlocks words
+           * @param size_t nBlocks is the number of VFAT data blocks (7*32bit words) to read, may be 0
+           * @param uint32_t remaining is set to the number of VFAT blocks still in the FIFO after the read
+           * @retval uint32_t returns the number of complete VFAT blocks read
+          */
+          uint32_t getTrackingData(uint8_t const& gtx, uint32_t* data, size_t const& nBlocks,
+                                   uint32_t& remaining);
+
+          /**
+           * get the tracking data into memory pool frames and the FIFO occupancy left behind,
+           * in a single IPBus dispatch
+           * frames are filled in order with whole VFAT blocks, appended after any data already present
+           * @param uint8_t gtx is the number of the GTX tracking data to read
+           * @param std::vector<toolbox::mem::Reference*> data frames to fill, allocated by the caller
+           * @param size_t nBlocks is the maximum number of VFAT data blocks (7*32bit words) to read, may be 0
+           * @param uint32_t remaining is set to the number of VFAT blocks still in the FIFO after the read
+           * @retval uint32_t returns the number of complete VFAT blocks read
+          */
+          uint32_t getTrackingData(uint8_t const& gtx, std::vector<toolbox::mem::Reference*>& data,
+                                   size_t const& nBlocks, uint32_t& remaining);
+
+          /**
+           * get the tracking data of several GTX links into memory pool frames, and the FIFO
+           * occupancy each one leaves behind, in a single IPBus dispatch, so that the reads of
+           * all the links are in flight together rather than costing a round trip each
+           * @param uint32_t gtxMask links to read, inactive links are skipped
+           * @param data frames to fill for each GTX, indexed by GTX, allocated by the caller
+           * @param nBlocks maximum number of VFAT data blocks to read from each GTX, may be 0
+           * @param remaining set for each GTX read to the number of VFAT blocks still in its FIFO
+           * @retval uint32_t returns the total number of complete VFAT blocks read
+          */
+          uint32_t getTrackingData(uint32_t const& gtxMask,
+                                   std::vector<std::vector<toolbox::mem::Reference*> >& data,
+                                   std::vector<uint32_t> const& nBlocks, std::vector<uint32_t>& remaining);
+
           /**
            * Empty the tracking data FIFO
            * @param uint8_t gtx is the number of the gtx to query
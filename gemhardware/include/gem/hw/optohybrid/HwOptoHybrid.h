@@ -817,33 +817,11 @@ namespace gem {
            *  - 2 from an external source
            *  - 3 from looping back the sbits
            *  - 4 sent along the GEB
+           * @retval the count, 0 if there is no such counter
            */
           uint32_t getT1Count(uint8_t const& signal, uint8_t const& mode) {
-            std::stringstream t1Signal;
-            if (signal == 0x0)
-              t1Signal << "L1A";
-            if (signal == 0x1)
-              t1Signal << "CalPulse";
-            if (signal == 0x2)
-              t1Signal << "Resync";
-            if (signal == 0x3)
-              t1Signal << "BC0";
-
-            switch(mode) {
-            case 0:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.TTC.%s",     (t1Signal.str()).c_str()));
-            case 1:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.INTERNAL.%s",(t1Signal.str()).c_str()));
-            case 2:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.EXTERNAL.%s",(t1Signal.str()).c_str()));
-            case 3:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.LOOPBACK.%s",(t1Signal.str()).c_str()));
-            case 4:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.SENT.%s",    (t1Signal.str()).c_str()));
-            default:
-              return readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.T1.SENT.%s",    (t1Signal.str()).c_str()));
-            }
-          };
+            RegisterHandle const& reg = getT1CountRegister(signal, mode);
+            return reg.isValid() ? readReg(reg) : 0; };
 
           /**
            * Get the recorded number of L1A signals
@@ -1092,15 +1070,7 @@ namespace gem {
            * @param slot specifies which VFAT counters to read
            * 0-23
            */
-          std::pair<uint32_t,uint32_t> getVFATCRCCount(uint8_t const& chip) {
-            std::stringstream vfatCRC;
-            vfatCRC << "COUNTERS.CRC.";
-            uint32_t valid     = readReg(getDeviceBaseNode(),
-                                         toolbox::toString("COUNTERS.CRC.VALID.VFAT%d",    chip));
-            uint32_t incorrect = readReg(getDeviceBaseNode(),
-                                         toolbox::toString("COUNTERS.CRC.INCORRECT.VFAT%d",chip));
-            return std::make_pair(valid,incorrect);
-          };
+          std::pair<uint32_t,uint32_t> getVFATCRCCount(uint8_t const& chip);
 
 
           /**
@@ -1151,9 +1121,18 @@ namespace gem {
           std::vector<linkStatus> v_activeLinks;
 
         private:
+          /**
+           * @returns the T1 counter register of a signal and mode, see getT1Count,
+           *          resolved on first use
+           */
+          RegisterHandle const& getT1CountRegister(uint8_t const& signal, uint8_t const& mode);
+
           uint8_t m_controlLink;
           int m_slot;
 
+          std::vector<RegisterHandle const*> m_t1CountRegs;  ///< by mode and signal, NULL until resolved
+          std::vector<RegisterHandle const*> m_vfatCRCRegs;  ///< valid and incorrect by chip, NULL until resolved
+
         };  // class HwOptoHybrid
     }  // namespace gem::hw::glib
   }  // namespace gem::hw
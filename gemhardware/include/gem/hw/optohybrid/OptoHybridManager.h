@@ -17,6 +17,8 @@
 
 namespace gem {
   namespace hw {
+    class GEMHwDispatcher;
+
     namespace optohybrid {
 
       class HwOptoHybrid;
@@ -209,6 +211,12 @@ namespace gem {
 
           void     createOptoHybridInfoSpaceItems(is_toolbox_ptr is_optohybrid, optohybrid_shared_ptr optohybrid);
 
+          /**
+           * Configure one OptoHybrid and its VFATs, run by the dispatcher thread of the OptoHybrid
+           * @param index of the OptoHybrid, slot*MAX_OPTOHYBRIDS_PER_AMC+link
+           */
+          void     configureOptoHybrid(unsigned const& index);
+
           mutable gem::utils::Lock m_deviceLock;  // [MAX_OPTOHYBRIDS_PER_AMC*MAX_AMCS_PER_CRATE];
 
           // Matrix<optohybrid_shared_ptr, MAX_OPTOHYBRIDS_PER_AMC, MAX_AMCS_PER_CRATE>
@@ -221,6 +229,8 @@ namespace gem {
           std::array<std::array<is_toolbox_ptr, MAX_OPTOHYBRIDS_PER_AMC>, MAX_AMCS_PER_CRATE>
             is_optohybrids;
 
+          std::shared_ptr<gem::hw::GEMHwDispatcher> p_dispatcher;  ///< accesses the OptoHybrids concurrently
+
           xdata::Vector<xdata::Bag<OptoHybridInfo> > m_optohybridInfo;
           xdata::String        m_connectionFile;
 
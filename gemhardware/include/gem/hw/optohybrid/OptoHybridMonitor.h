@@ -66,6 +66,15 @@ namespace gem {
       private:
         std::shared_ptr<HwOptoHybrid> p_optohybrid;
 
+        /**
+         * @brief resolve the registers of all the monitorables, in the order updateMonitorables visits them
+         */
+        void resolveMonitorables();
+
+        /** registers of each monitorable, the second is only used by the 64 bit and I2C status types */
+        typedef std::pair<GEMHwDevice::RegisterHandle const*, GEMHwDevice::RegisterHandle const*> monitorable_regs;
+        std::vector<monitorable_regs> m_monitorableRegs;
+
       };  // class OptoHybridMonitor
 
     }  // namespace gem::hw::optohybrid
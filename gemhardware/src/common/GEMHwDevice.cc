@@ -1,5 +1,7 @@
 /*General structure taken blatantly from tcds::utils::HwDeviceTCA as we're using the same card*/
 
+#include <algorithm>
+
 #include "toolbox/net/URN.h"
 
 #include "gem/hw/GEMHwDevice.h"
@@ -8,8 +10,7 @@
 gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
                                   std::string const& connectionFile) :
   b_is_connected(false),
-  m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_gemLogger(log4cplus::Logger::getInstance(deviceName))
 {
   DEBUG("GEMHwDevice(std::string, std::string) ctor");
   setLogLevelTo(uhal::Error());
@@ -38,8 +39,7 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
                                   std::string const& connectionURI,
                                   std::string const& addressTable) :
   b_is_connected(false),
-  m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_gemLogger(log4cplus::Logger::getInstance(deviceName))
 {
   DEBUG("GEMHwDevice(std::string, std::string, std::string) ctor");
   setLogLevelTo(uhal::Error());
@@ -70,8 +70,7 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
 gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
                                   uhal::HwInterface& uhalDevice) :
   b_is_connected(false),
-  m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true)
+  m_gemLogger(log4cplus::Logger::getInstance(deviceName))
 {
   DEBUG("GEMHwDevice(std::string, uhal::HwInterface) ctor");
   setLogLevelTo(uhal::Error());
@@ -97,7 +96,6 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName,
 gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName):
   b_is_connected(false),
   m_gemLogger(log4cplus::Logger::getInstance(deviceName)),
-  m_hwLock(toolbox::BSem::FULL, true),
   m_controlHubIPAddress("localhost"),
   m_addressTable("allregsnonfram.xml"),
   m_ipBusProtocol("2.0"),
@@ -228,6 +226,10 @@ void gem::hw::GEMHwDevice::setup(std::string const& deviceName)
   m_ipBusErrs.Timeout       = 0;
   m_ipBusErrs.ControlHubErr = 0;
 
+  p_retryPolicy = std::make_shared<GEMHwRetryPolicy>(m_gemLogger);
+  // the other applications accessing the device in this process take the same lock
+  p_hwLock      = gem::utils::HwLock::getDeviceLock(deviceName);
+
   setLogLevelTo(uhal::Error());
 }
 
@@ -244,419 +246,148 @@ uhal::HwInterface& gem::hw::GEMHwDevice::getGEMHwInterface() const
   //have to fix the return value for failed access, better to return a pointer?
 }
 
-uint32_t gem::hw::GEMHwDevice::readReg(std::string const& name)
+gem::hw::GEMHwDevice::RegisterHandle const& gem::hw::GEMHwDevice::getRegisterHandle(std::string const& name) const
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
+  {
+    // lookups of registers already resolved only need the shared lock
+    gem::utils::SharedLockGuard<gem::utils::HwLock> sharedLock(*p_hwLock);
+    auto cached = m_registerHandles.find(name);
+    if (cached != m_registerHandles.end())
+      return cached->second;
+  }
+
+  gem::utils::LockGuard<gem::utils::HwLock> guardedLock(*p_hwLock);
+  auto cached = m_registerHandles.find(name);
+  if (cached != m_registerHandles.end())
+    return cached->second;
+
+  // the nodes belong to the uhal::HwInterface, so the pointer lives as long as the device
+  uhal::Node const& node = getGEMHwInterface().getNode(name);
+  RegisterHandle reg;
+  reg.name    = name;
+  reg.address = node.getAddress();
+  reg.mask    = node.getMask();
+  reg.node    = &node;
+  TRACE("GEMHwDevice::Resolved register " << name << " at 0x" << std::setfill('0') << std::setw(8)
+        << std::hex << reg.address << " mask 0x" << std::setw(8) << reg.mask << std::dec);
+  return m_registerHandles.insert(std::make_pair(name, reg)).first->second;
+}
 
-  unsigned retryCount = 0;
-  uint32_t res = 0x0;
+uint32_t gem::hw::GEMHwDevice::readReg(std::string const& name)
+{
   TRACE("GEMHwDevice::gem::hw::GEMHwDevice::readReg " << name << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValWord<uint32_t> val = hw.getNode(name).read();
-      hw.dispatch();
-      res = val.value();
-      TRACE("GEMHwDevice::Successfully read register " << name.c_str() << " with value 0x"
-            << std::setfill('0') << std::setw(8) << std::hex << res << std::dec
-            << " retry count is " << retryCount << ". Should move on to next operation");
-      return res;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to read register " << name <<
-               ", retrying. retryCount("<<retryCount<<")"
-               << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register %s",name.c_str());
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-  return res;
+  Batch batch(*this);
+  Batch::Handle val = batch.read(name);
+  batch.commit();
+  return val.value();
 }
 
 uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  unsigned retryCount = 0;
-  uint32_t res = 0x0;
   TRACE("GEMHwDevice::gem::hw::GEMHwDevice::readReg 0x" << std::setfill('0') << std::setw(8)
         << std::hex << address << std::dec << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValWord<uint32_t> val = hw.getClient().read(address);
-      hw.dispatch();
-      res = val.value();
-      TRACE("GEMHwDevice::Successfully read register 0x" << std::setfill('0') << std::setw(8)
-            << std::hex << address << std::dec << " with value 0x"
-            << std::setfill('0') << std::setw(8) << std::hex << res << std::dec
-            << " retry count is " << retryCount << ". Should move on to next operation");
-      return res;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '0x%08x' (uHAL)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to read register 0x" << std::setfill('0') << std::setw(8)
-               << std::hex << address << std::dec
-               << ", retrying. retryCount("<<retryCount<<")"
-               << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '0x%08x' (std)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register 0x%08x",
-                                      address);
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-  return res;
+  Batch batch(*this);
+  Batch::Handle val = batch.read(address);
+  batch.commit();
+  return val.value();
 }
 
 uint32_t gem::hw::GEMHwDevice::readReg(uint32_t const& address, uint32_t const& mask)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  unsigned retryCount = 0;
-  uint32_t res = 0x0;
   TRACE("GEMHwDevice::gem::hw::GEMHwDevice::readReg 0x" << std::setfill('0') << std::setw(8)
-        << std::hex << address << std::dec << std::endl);
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValWord<uint32_t> val = hw.getClient().read(address,mask);
-      hw.dispatch();
-      res = val.value();
-      TRACE("GEMHwDevice::Successfully read register 0x" << std::setfill('0') << std::setw(8)
-            << std::hex << address << std::dec << " with mask "
-            << std::hex << mask << std::dec << " with value "
-            << std::setfill('0') << std::setw(8) << std::hex << res << std::dec
-            << " retry count is " << retryCount << ". Should move on to next operation");
-      return res;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '0x%08x' (uHAL)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to read register 0x" << std::setfill('0') << std::setw(8)
-               << std::hex << address << std::dec << " with mask "
-               << std::hex << address << std::dec
-               << ", retrying. retryCount("<<retryCount<<")"
-               << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read register '0x%08x' (std)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register 0x%08x",
-                                      address);
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-  return res;
+        << std::hex << address << std::dec << " with mask " << std::hex << mask << std::dec << std::endl);
+  Batch batch(*this);
+  Batch::Handle val = batch.read(address, mask);
+  batch.commit();
+  return val.value();
+}
+
+uint32_t gem::hw::GEMHwDevice::readReg(RegisterHandle const& reg)
+{
+  Batch batch(*this);
+  Batch::Handle val = batch.read(reg);
+  batch.commit();
+  return val.value();
 }
 
 uint32_t gem::hw::GEMHwDevice::readMaskedAddress(std::string const& name)
 {
-  uint32_t address = getGEMHwInterface().getNode(name).getAddress();
-  uint32_t mask    = getGEMHwInterface().getNode(name).getMask();
-  return readReg(address,mask);
+  RegisterHandle const& reg = getRegisterHandle(name);
+  return readReg(reg.address,reg.mask);
 }
 
 void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      std::vector<std::pair<std::string,uhal::ValWord<uint32_t> > > vals;
-      // vals.reserve(regList.size());
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        vals.push_back(std::make_pair(curReg->first,hw.getNode(curReg->first).read()));
-      hw.dispatch();
+  Batch batch(*this);
+  std::vector<Batch::Handle> vals;
+  vals.reserve(regList.size());
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+    vals.push_back(batch.read(curReg->first));
+  if (!batch.commit())
+    return;
 
-      // would like to have these local to the loop, how to do...?
-      auto curVal = vals.begin();
-      auto curReg = regList.begin();
-      for ( ; curReg != regList.end(); ++curVal,++curReg)
-        curReg->second = (curVal->second).value();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
-      std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
-      std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  auto curVal = vals.begin();
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curVal,++curReg)
+    curReg->second = curVal->value();
 }
 
 void gem::hw::GEMHwDevice::readRegs(addressed_register_pair_list &regList)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      std::vector<std::pair<uint32_t, uhal::ValWord<uint32_t> > > vals;
-      // vals.reserve(regList.size());
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        vals.push_back(std::make_pair(curReg->first,hw.getClient().read(curReg->first)));
-      hw.dispatch();
+  Batch batch(*this);
+  std::vector<Batch::Handle> vals;
+  vals.reserve(regList.size());
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+    vals.push_back(batch.read(curReg->first));
+  if (!batch.commit())
+    return;
 
-      // would like to have these local to the loop, how to do...?
-      auto curVal = vals.begin();
-      auto curReg = regList.begin();
-      for ( ; curReg != regList.end(); ++curVal,++curReg)
-        curReg->second = (curVal->second).value();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first);
-      std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first);
-      std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  auto curVal = vals.begin();
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curVal,++curReg)
+    curReg->second = curVal->value();
 }
 
 void gem::hw::GEMHwDevice::readRegs(masked_register_pair_list &regList)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      std::vector<std::pair<std::pair<uint32_t,uint32_t>,uhal::ValWord<uint32_t> > > vals;
-      // vals.reserve(regList.size());
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        vals.push_back(std::make_pair(std::make_pair(curReg->first.first,curReg->first.second),
-                                      hw.getClient().read(curReg->first.first,curReg->second)));
-      hw.dispatch();
+  Batch batch(*this);
+  std::vector<Batch::Handle> vals;
+  vals.reserve(regList.size());
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+    vals.push_back(batch.read(curReg->first.first,curReg->first.second));
+  if (!batch.commit())
+    return;
 
-      // would like to have these local to the loop, how to do...?
-      auto curVal = vals.begin();
-      auto curReg = regList.begin();
-      for ( ; curReg != regList.end(); ++curVal,++curReg)
-        curReg->second = (curVal->second).value();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first.first, curReg->first.second);
-      std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '0x%08x mask 0x%08x'", curReg->first.first, curReg->first.second);
-      std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read registers");
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  auto curVal = vals.begin();
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curVal,++curReg)
+    curReg->second = curVal->value();
 }
 
 void gem::hw::GEMHwDevice::writeReg(std::string const& name, uint32_t const val)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      hw.getNode(name).write(val);
-      hw.dispatch();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to write value 0x" << std::hex<< val << std::dec << " to register " << name <<
-               ", retrying. retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write to register %s",name.c_str());
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  Batch batch(*this);
+  batch.write(name, val);
+  batch.commit();
 }
 
 void gem::hw::GEMHwDevice::writeReg(uint32_t const& address, uint32_t const val)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      hw.getClient().write(address, val);
-      hw.dispatch();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '0x%08x' (uHAL)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to write value 0x" << std::hex<< val << std::dec << " to register 0x"
-                << std::setfill('0') << std::setw(8) << std::hex << address << std::dec
-                << ", retrying. retryCount("<<retryCount<<")"
-                << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '0x%08x' (std)", address);
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write to register 0x%08x",
-                                      address);
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  Batch batch(*this);
+  batch.write(address, val);
+  batch.commit();
+}
+
+void gem::hw::GEMHwDevice::writeReg(RegisterHandle const& reg, uint32_t const val)
+{
+  Batch batch(*this);
+  batch.write(reg, val);
+  batch.commit();
 }
 
 void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        hw.getNode(curReg->first).write(curReg->second);
-      hw.dispatch();
-      return;
-      //break;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = "Could not write to register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
-      std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = "Could not write to register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
-      std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
+  Batch batch(*this);
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+    batch.write(curReg->first,curReg->second);
+  batch.commit();
 }
 
 void gem::hw::GEMHwDevice::writeValueToRegs(std::vector<std::string> const& regNames, uint32_t const& regValue)
@@ -684,113 +415,99 @@ void gem::hw::GEMHwDevice::zeroRegs(std::vector<std::string> const& regNames)
 
 std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-  size_t numWords       = hw.getNode(name).getSize();
+  size_t numWords = getRegisterHandle(name).node->getSize();
   TRACE("GEMHwDevice::reading block " << name << " which has size "<<numWords);
   return readBlock(name, numWords);
 }
 
 std::vector<uint32_t> gem::hw::GEMHwDevice::readBlock(std::string const& name, size_t const& numWords)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-
-  std::vector<uint32_t> res(numWords);
-
-  unsigned retryCount = 0;
   if (numWords < 1)
-    return res;
+    return std::vector<uint32_t>();
 
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      uhal::ValVector<uint32_t> values = hw.getNode(name).readBlock(numWords);
-      hw.dispatch();
-      std::copy(values.begin(), values.end(), res.begin());
-      return res;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read block '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to read block " << name << " with " << numWords << " words" <<
-               ", retrying. retryCount("<<retryCount<<")" << std::endl
-               << "error was " << errCode
-               << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not read block '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read block");
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-  return res;
+  Batch batch(*this);
+  Batch::BlockHandle values = batch.readBlock(name, numWords);
+  // a failed read returns as many zeros as were asked for
+  if (!batch.commit())
+    return std::vector<uint32_t>(numWords);
+  return values.values();
 }
 
 uint32_t gem::hw::GEMHwDevice::readBlock(std::string const& name, uint32_t* buffer,
                                          size_t const& numWords)
 {
-  // not yet implemented
-  return 0;
+  if (numWords < 1 || buffer == NULL)
+    return 0;
+
+  Batch batch(*this);
+  batch.readBlock(name, block_chunk_list(1, block_chunk(buffer, numWords)));
+  return batch.commit() ? numWords : 0;
 }
 
 uint32_t gem::hw::GEMHwDevice::readBlock(std::string const& name, std::vector<toolbox::mem::Reference*>& buffer,
                                          size_t const& numWords)
 {
-  // not yet implemented
-  return 0;
+  // fill the frames in order, appending after any data they already hold
+  // never read more than fits, anything left over stays in the hardware
+  // all the chunks go in one batch, so the read is a single transaction
+  block_chunk_list chunks;
+  std::vector<toolbox::mem::Reference*> filled;
+  uint32_t nRead = 0;
+  for (auto frame = buffer.begin(); frame != buffer.end() && nRead < numWords; ++frame) {
+    if (*frame == NULL)
+      continue;
+    size_t used  = (*frame)->getDataOffset() + (*frame)->getDataSize();
+    size_t space = ((*frame)->getBuffer()->getSize() - used)/sizeof(uint32_t);
+    size_t toRead = std::min(space, numWords - nRead);
+    if (toRead == 0)
+      continue;
+    uint32_t* dest = reinterpret_cast<uint32_t*>(static_cast<char*>((*frame)->getDataLocation())
+                                                 + (*frame)->getDataSize());
+    chunks.push_back(block_chunk(dest, toRead));
+    filled.push_back(*frame);
+    nRead += toRead;
+  }
+  if (chunks.empty())
+    return 0;
+
+  Batch batch(*this);
+  batch.readBlock(name, chunks);
+  if (!batch.commit())
+    return 0;
+  for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+    filled.at(chunk)->setDataSize(filled.at(chunk)->getDataSize() + chunks.at(chunk).second*sizeof(uint32_t));
+  TRACE("GEMHwDevice::readBlock " << name << " read " << nRead << " of " << numWords
+        << " words into " << buffer.size() << " frames");
+  return nRead;
+}
+
+uint32_t gem::hw::GEMHwDevice::readBlockAndReg(std::string const& blockName, block_chunk_list const& chunks,
+                                               std::string const& regName, uint32_t& regValue)
+{
+  Batch batch(*this);
+  batch.readBlock(blockName, chunks);
+  Batch::Handle reg = batch.read(regName);
+  if (!batch.commit()) {
+    regValue = 0;
+    return 0;
+  }
+
+  uint32_t nRead = 0;
+  for (auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+    if (chunk->first != NULL)
+      nRead += chunk->second;
+  regValue = reg.value();
+  return nRead;
 }
 
 void gem::hw::GEMHwDevice::writeBlock(std::string const& name, std::vector<uint32_t> const values)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
   if (values.size() < 1)
     return;
 
-  uhal::HwInterface& hw = getGEMHwInterface();
-  unsigned retryCount = 0;
-  while (retryCount < MAX_IPBUS_RETRIES) {
-    ++retryCount;
-    try {
-      hw.getNode(name).writeBlock(values);
-      hw.dispatch();
-      return;
-    } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to block '%s' (uHAL)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      std::string errCode = toolbox::toString("%s",err.what());
-      if (knownErrorCode(errCode)) {
-        if (retryCount > 4)
-          WARN("GEMHwDevice::Failed to write block " << name <<
-               ", retrying. retryCount("<<retryCount<<")"
-               << std::endl);
-        updateErrorCounters(errCode);
-        continue;
-      } else {
-        ERROR("GEMHwDevice::" << msg);
-        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
-      }
-    } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to block '%s' (std)", name.c_str());
-      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
-      ERROR("GEMHwDevice::" << msg);
-      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
-    }
-  }
-  std::string msg = toolbox::toString("Maximum number of retries reached, unable to write block %s",name.c_str());
-  ERROR("GEMHwDevice::" << msg);
-  // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+  Batch batch(*this);
+  batch.writeBlock(name, values);
+  batch.commit();
 }
 
 std::vector<uint32_t> gem::hw::GEMHwDevice::readFIFO(std::string const& name)
@@ -820,40 +537,242 @@ void gem::hw::GEMHwDevice::zeroFIFO(std::string const& name)
   return writeReg(name+".FLUSH",0x0);
 }
 
-bool gem::hw::GEMHwDevice::knownErrorCode(std::string const& errCode) const {
-  return ((errCode.find("amount of data")              != std::string::npos) ||
-          (errCode.find("INFO CODE = 0x4L")            != std::string::npos) ||
-          (errCode.find("INFO CODE = 0x6L")            != std::string::npos) ||
-          (errCode.find("timed out")                   != std::string::npos) ||
-          (errCode.find("had response field = 0x04")   != std::string::npos) ||
-          (errCode.find("had response field = 0x06")   != std::string::npos) ||
-          (errCode.find("ControlHub error code is: 3") != std::string::npos) ||
-          (errCode.find("ControlHub error code is: 4") != std::string::npos));
+const std::vector<uint32_t> gem::hw::GEMHwDevice::Batch::BlockHandle::s_noValues;
+
+gem::hw::GEMHwDevice::Batch::Batch(GEMHwDevice& device) :
+  m_device(device),
+  m_committed(false)
+{
+}
+
+gem::hw::GEMHwDevice::Batch::Handle gem::hw::GEMHwDevice::Batch::read(std::string const& name)
+{
+  Op op = {NAMED_READ, name, NULL, 0x0, 0xffffffff, 0x0, 0, m_values.size(), NULL};
+  m_ops.push_back(op);
+  m_values.push_back(0x0);
+  m_committed = false;
+  return Handle(this, op.result);
 }
 
+gem::hw::GEMHwDevice::Batch::Handle gem::hw::GEMHwDevice::Batch::read(uint32_t const& address,
+                                                                      uint32_t const& mask)
+{
+  Op op = {ADDRESSED_READ, "", NULL, address, mask, 0x0, 0, m_values.size(), NULL};
+  m_ops.push_back(op);
+  m_values.push_back(0x0);
+  m_committed = false;
+  return Handle(this, op.result);
+}
 
-void gem::hw::GEMHwDevice::updateErrorCounters(std::string const& errCode) {
-  if (errCode.find("amount of data")    != std::string::npos)
+gem::hw::GEMHwDevice::Batch::Handle gem::hw::GEMHwDevice::Batch::read(RegisterHandle const& reg)
+{
+  Op op = {reg.isValid() ? NODE_READ : NAMED_READ, reg.name, reg.node, reg.address, reg.mask, 0x0, 0, m_values.size(), NULL};
+  m_ops.push_back(op);
+  m_values.push_back(0x0);
+  m_committed = false;
+  return Handle(this, op.result);
+}
+
+void gem::hw::GEMHwDevice::Batch::write(std::string const& name, uint32_t const& val)
+{
+  Op op = {NAMED_WRITE, name, NULL, 0x0, 0xffffffff, val, 0, 0, NULL};
+  m_ops.push_back(op);
+  m_committed = false;
+}
+
+void gem::hw::GEMHwDevice::Batch::write(uint32_t const& address, uint32_t const& val)
+{
+  Op op = {ADDRESSED_WRITE, "", NULL, address, 0xffffffff, val, 0, 0, NULL};
+  m_ops.push_back(op);
+  m_committed = false;
+}
+
+void gem::hw::GEMHwDevice::Batch::write(RegisterHandle const& reg, uint32_t const& val)
+{
+  Op op = {reg.isValid() ? NODE_WRITE : NAMED_WRITE, reg.name, reg.node, reg.address, reg.mask, val, 0, 0, NULL};
+  m_ops.push_back(op);
+  m_committed = false;
+}
+
+gem::hw::GEMHwDevice::Batch::BlockHandle gem::hw::GEMHwDevice::Batch::readBlock(std::string const& name,
+                                                                                size_t const& numWords)
+{
+  Op op = {BLOCK_READ, name, NULL, 0x0, 0xffffffff, 0x0, numWords, m_blocks.size(), NULL};
+  m_blocks.push_back(std::vector<uint32_t>());
+  // nothing to send for an empty read, but the handle is still valid
+  if (numWords > 0)
+    m_ops.push_back(op);
+  m_committed = false;
+  return BlockHandle(this, op.result);
+}
+
+void gem::hw::GEMHwDevice::Batch::readBlock(std::string const& name, block_chunk_list const& chunks)
+{
+  for (auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+    if (chunk->first == NULL || chunk->second == 0)
+      continue;
+    Op op = {CHUNK_READ, name, NULL, 0x0, 0xffffffff, 0x0, chunk->second, 0, chunk->first};
+    m_ops.push_back(op);
+  }
+  m_committed = false;
+}
+
+void gem::hw::GEMHwDevice::Batch::writeBlock(std::string const& name, std::vector<uint32_t> const& values)
+{
+  if (values.size() < 1)
+    return;
+  Op op = {BLOCK_WRITE, name, NULL, 0x0, 0xffffffff, 0x0, values.size(), m_blocks.size(), NULL};
+  m_ops.push_back(op);
+  m_blocks.push_back(values);
+  m_committed = false;
+}
+
+bool gem::hw::GEMHwDevice::Batch::commit()
+{
+  m_committed = false;
+  if (m_ops.empty()) {
+    m_committed = true;
+    return true;
+  }
+
+  GEMHwRetryPolicy::Transaction transaction(*(m_device.p_retryPolicy));
+  while (transaction.attempt()) {
+    try {
+      // the lock is only held for one attempt, so other users get the device during the backoff
+      gem::utils::LockGuard<gem::utils::HwLock> guardedLock(*(m_device.p_hwLock));
+      uhal::HwInterface& hw = m_device.getGEMHwInterface();
+
+      // a failed dispatch leaves the uhal results invalid, so everything is queued again on a retry
+      std::vector<uhal::ValWord<uint32_t> >   words;
+      std::vector<uhal::ValVector<uint32_t> > blocks;
+      words.reserve(m_values.size());
+      blocks.reserve(m_blocks.size());
+      for (auto op = m_ops.begin(); op != m_ops.end(); ++op) {
+        switch (op->type) {
+        case NAMED_READ:
+          words.push_back(m_device.getRegisterHandle(op->name).node->read());
+          break;
+        case ADDRESSED_READ:
+          words.push_back(hw.getClient().read(op->address, op->mask));
+          break;
+        case NODE_READ:
+          words.push_back(op->node->read());
+          break;
+        case NAMED_WRITE:
+          m_device.getRegisterHandle(op->name).node->write(op->value);
+          break;
+        case ADDRESSED_WRITE:
+          hw.getClient().write(op->address, op->value);
+          break;
+        case NODE_WRITE:
+          op->node->write(op->value);
+          break;
+        case BLOCK_READ:
+          blocks.push_back(m_device.getRegisterHandle(op->name).node->readBlock(op->nWords));
+          break;
+        case CHUNK_READ:
+          blocks.push_back(m_device.getRegisterHandle(op->name).node->readBlock(op->nWords));
+          break;
+        case BLOCK_WRITE:
+          m_device.getRegisterHandle(op->name).node->writeBlock(m_blocks[op->result]);
+          break;
+        }
+      }
+      hw.dispatch();
+
+      auto word  = words.begin();
+      auto block = blocks.begin();
+      for (auto op = m_ops.begin(); op != m_ops.end(); ++op) {
+        if (op->type == NAMED_READ || op->type == ADDRESSED_READ || op->type == NODE_READ) {
+          m_values[op->result] = word->value();
+          ++word;
+        } else if (op->type == BLOCK_READ) {
+          m_blocks[op->result].assign(block->begin(), block->end());
+          ++block;
+        } else if (op->type == CHUNK_READ) {
+          std::copy(block->begin(), block->end(), op->dest);
+          ++block;
+        }
+      }
+      m_committed = true;
+      transaction.succeeded();
+      TRACE_LOGGER(m_device.m_gemLogger, "GEMHwDevice::Successfully committed batch of " << m_ops.size()
+                   << " operations, attempt count is " << transaction.attempts());
+      return true;
+    } catch (uhal::exception::exception const& err) {
+      GEMHwRetryPolicy::ErrorClass const errClass = transaction.failed(err.what());
+      m_device.countError(errClass);
+      if (transaction.willRetry()) {
+        DEBUG_LOGGER(m_device.m_gemLogger, "GEMHwDevice::Failed to commit batch of " << m_ops.size()
+                     << " operations, retrying. attemptCount(" << transaction.attempts() << ")" << std::endl
+                     << "error was " << err.what());
+      } else {
+        std::string msgBase = toolbox::toString("Could not commit batch of %d operations after %d attempts (uHAL, %s)",
+                                                static_cast<int>(m_ops.size()), transaction.attempts(),
+                                                GEMHwRetryPolicy::errorClassName(errClass).c_str());
+        std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+        ERROR_LOGGER(m_device.m_gemLogger, "GEMHwDevice::" << msg << " Operations were:" << describe());
+        // XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+      }
+    } catch (std::exception const& err) {
+      m_device.countError(transaction.failed(err.what()));
+      std::string msgBase = toolbox::toString("Could not commit batch of %d operations (std)",
+                                              static_cast<int>(m_ops.size()));
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      ERROR_LOGGER(m_device.m_gemLogger, "GEMHwDevice::" << msg << " Operations were:" << describe());
+      // XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+    }
+  }
+  // a device failing persistently is not accessed, its circuit breaker already reported it
+  if (transaction.rejected())
+    DEBUG_LOGGER(m_device.m_gemLogger, "GEMHwDevice::Device unhealthy, batch of " << m_ops.size()
+                 << " operations not sent");
+  return false;
+}
+
+void gem::hw::GEMHwDevice::Batch::clear()
+{
+  m_ops.clear();
+  m_values.clear();
+  m_blocks.clear();
+  m_committed = false;
+}
+
+std::string gem::hw::GEMHwDevice::Batch::describe() const
+{
+  std::string ops;
+  for (auto op = m_ops.begin(); op != m_ops.end(); ++op) {
+    if (op->type == ADDRESSED_READ || op->type == ADDRESSED_WRITE)
+      ops += toolbox::toString(" '0x%08x'", op->address);
+    else
+      ops += toolbox::toString(" '%s'", op->name.c_str());
+  }
+  return ops;
+}
+
+void gem::hw::GEMHwDevice::countError(GEMHwRetryPolicy::ErrorClass const& errClass)
+{
+  switch (errClass) {
+  case GEMHwRetryPolicy::BAD_HEADER:
     ++m_ipBusErrs.BadHeader;
-  if (errCode.find("INFO CODE = 0x4L")  != std::string::npos)
+    break;
+  case GEMHwRetryPolicy::READ_ERROR:
     ++m_ipBusErrs.ReadError;
-  if ((errCode.find("INFO CODE = 0x6L") != std::string::npos) ||
-      (errCode.find("timed out")        != std::string::npos))
+    break;
+  case GEMHwRetryPolicy::TIMEOUT:
     ++m_ipBusErrs.Timeout;
-  if (errCode.find("ControlHub error code is: 3") != std::string::npos)
-    ++m_ipBusErrs.ControlHubErr;
-  if (errCode.find("ControlHub error code is: 4") != std::string::npos)
-    ++m_ipBusErrs.ControlHubErr;
-  if ((errCode.find("had response field = 0x04") != std::string::npos) ||
-      (errCode.find("had response field = 0x06") != std::string::npos))
+    break;
+  case GEMHwRetryPolicy::CONTROLHUB:
     ++m_ipBusErrs.ControlHubErr;
+    break;
+  default:
+    break;
+  }
 }
 
 void gem::hw::GEMHwDevice::zeroBlock(std::string const& name)
 {
-  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_hwLock);
-  uhal::HwInterface& hw = getGEMHwInterface();
-  size_t numWords = hw.getNode(name).getSize();
+  size_t numWords = getRegisterHandle(name).node->getSize();
   std::vector<uint32_t> zeros(numWords, 0);
   return writeBlock(name, zeros);
 }
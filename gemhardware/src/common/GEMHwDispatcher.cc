@@ -0,0 +1,174 @@
+/**
+ * class: GEMHwDispatcher
+ * description: Pool of threads accessing several hardware devices concurrently
+ */
+
+#include "gem/hw/GEMHwDispatcher.h"
+
+#include <algorithm>
+
+#include <unistd.h>
+
+const unsigned gem::hw::GEMHwDispatcher::kSTOP_WARN_MSEC = 5000;
+
+gem::hw::GEMHwDispatcher::GEMHwDispatcher(std::string const& name, unsigned const& nThreads) :
+  m_name(name),
+  m_gemLogger(log4cplus::Logger::getInstance(name)),
+  m_nextWorker(0),
+  m_exit(false)
+{
+  pthread_mutex_init(&m_mutex, NULL);
+  pthread_cond_init(&m_queued, NULL);
+  pthread_cond_init(&m_finished, NULL);
+
+  for (unsigned index = 0; index < std::max(nThreads, 1U); ++index) {
+    std::shared_ptr<Worker> worker = std::make_shared<Worker>();
+    worker->done = false;
+    m_workers.push_back(worker);
+  }
+  // the threads are only started once every worker exists
+  for (unsigned index = 0; index < m_workers.size(); ++index) {
+    m_workers.at(index)->task = std::make_shared<gem::hw::GEMHwDispatcherTask>(this, index);
+    m_workers.at(index)->task->activate();
+  }
+  DEBUG("GEMHwDispatcher::" << m_name << " started " << m_workers.size() << " threads");
+}
+
+gem::hw::GEMHwDispatcher::~GEMHwDispatcher()
+{
+  pthread_mutex_lock(&m_mutex);
+  m_exit = true;
+  pthread_cond_broadcast(&m_queued);
+  pthread_mutex_unlock(&m_mutex);
+
+  // the jobs already running are allowed to finish, the ones still queued are dropped,
+  // the threads use the mutex and the workers, so they have to be gone before those are
+  for (unsigned msec = 1; ; ++msec) {
+    __sync_synchronize();
+    bool done = true;
+    for (auto worker = m_workers.begin(); worker != m_workers.end(); ++worker)
+      if (!(*worker)->done)
+        done = false;
+    if (done)
+      break;
+    if (msec % kSTOP_WARN_MSEC == 0)
+      WARN("GEMHwDispatcher::" << m_name << " still waiting for the threads to exit after "
+           << msec << " ms");
+    usleep(1000);
+  }
+
+  pthread_mutex_lock(&m_mutex);
+  for (auto worker = m_workers.begin(); worker != m_workers.end(); ++worker) {
+    for (auto request = (*worker)->queue.begin(); request != (*worker)->queue.end(); ++request) {
+      (*request)->m_error = "dispatcher stopped before the job could run";
+      (*request)->m_done  = true;
+    }
+    (*worker)->queue.clear();
+  }
+  pthread_cond_broadcast(&m_finished);
+  pthread_mutex_unlock(&m_mutex);
+
+  pthread_cond_destroy(&m_finished);
+  pthread_cond_destroy(&m_queued);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+gem::hw::GEMHwDispatcher::request_ptr gem::hw::GEMHwDispatcher::submit(GEMHwDevice const& device,
+                                                                        std::shared_ptr<Job> job)
+{
+  request_ptr request(new Request(job, device.getLoggerName()));
+  pthread_mutex_lock(&m_mutex);
+  if (m_exit) {
+    request->m_error = "dispatcher stopped before the job could run";
+    request->m_done  = true;
+  } else {
+    m_workers.at(workerFor(device))->queue.push_back(request);
+    pthread_cond_broadcast(&m_queued);
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return request;
+}
+
+gem::hw::GEMHwDispatcher::request_ptr gem::hw::GEMHwDispatcher::submit(GEMHwDevice::Batch& batch)
+{
+  return submit(batch.getDevice(), std::make_shared<CommitJob>(batch));
+}
+
+bool gem::hw::GEMHwDispatcher::wait(request_ptr const& request)
+{
+  pthread_mutex_lock(&m_mutex);
+  while (!request->m_done)
+    pthread_cond_wait(&m_finished, &m_mutex);
+  bool const succeeded = request->m_succeeded;
+  pthread_mutex_unlock(&m_mutex);
+  return succeeded;
+}
+
+bool gem::hw::GEMHwDispatcher::waitAll(std::vector<request_ptr> const& requests)
+{
+  bool succeeded = true;
+  for (auto request = requests.begin(); request != requests.end(); ++request) {
+    if (wait(*request))
+      continue;
+    ERROR("GEMHwDispatcher::" << m_name << " job for " << (*request)->deviceName()
+          << " failed: " << (*request)->error());
+    succeeded = false;
+  }
+  return succeeded;
+}
+
+int gem::hw::GEMHwDispatcher::workerTask(unsigned const& index)
+{
+  Worker& worker = *m_workers.at(index);
+  pthread_mutex_lock(&m_mutex);
+  while (!m_exit) {
+    if (worker.queue.empty()) {
+      pthread_cond_wait(&m_queued, &m_mutex);
+      continue;
+    }
+    request_ptr request = worker.queue.front();
+    worker.queue.pop_front();
+    pthread_mutex_unlock(&m_mutex);
+
+    bool        succeeded = false;
+    std::string error;
+    try {
+      request->p_job->run();
+      succeeded = true;
+    } catch (xcept::Exception const& e) {
+      error = e.what();
+    } catch (std::exception const& e) {
+      error = e.what();
+    } catch (...) {
+      error = "unknown exception";
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    // the job is dropped here, so that it does not outlive what it refers to
+    request->p_job.reset();
+    request->m_succeeded = succeeded;
+    request->m_error     = error;
+    request->m_done      = true;
+    pthread_cond_broadcast(&m_finished);
+  }
+  pthread_mutex_unlock(&m_mutex);
+  worker.done = true;
+  return 0;
+}
+
+void gem::hw::GEMHwDispatcher::CommitJob::run()
+{
+  if (!m_batch.commit())
+    XCEPT_RAISE(gem::hw::exception::HardwareProblem, "Unable to commit the batch of operations");
+}
+
+unsigned gem::hw::GEMHwDispatcher::workerFor(GEMHwDevice const& device)
+{
+  auto assigned = m_assignments.find(&device);
+  if (assigned != m_assignments.end())
+    return assigned->second;
+  unsigned const index = m_nextWorker;
+  m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+  m_assignments.insert(std::make_pair(&device, index));
+  return index;
+}
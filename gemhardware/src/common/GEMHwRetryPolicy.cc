@@ -0,0 +1,294 @@
+/**
+ * class: GEMHwRetryPolicy
+ * description: Retry, backoff and circuit breaker policy for the IPBus transactions of a device
+ */
+
+#include "gem/hw/GEMHwRetryPolicy.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "toolbox/string.h"
+
+#include "gem/utils/HwLock.h"
+
+const unsigned gem::hw::GEMHwRetryPolicy::kN_ERROR_CLASSES;
+const unsigned gem::hw::GEMHwRetryPolicy::kN_LATENCY_BINS;
+
+gem::hw::GEMHwRetryPolicy::Settings::Settings() :
+  maxMonitorAttempts(2),
+  initialBackoff(1000),
+  maxBackoff(50000),
+  jitter(0.5),
+  failureThreshold(5),
+  openTime(5000000)
+{
+  // IPBus transactions still have some problems in the firmware,
+  // so the errors that are recognized are worth a few retries
+  maxAttempts[BAD_HEADER] = 5;
+  maxAttempts[READ_ERROR] = 5;
+  // each attempt already waited for the uhal timeout
+  maxAttempts[TIMEOUT]    = 3;
+  maxAttempts[CONTROLHUB] = 5;
+  maxAttempts[UNKNOWN]    = 1;
+}
+
+gem::hw::GEMHwRetryPolicy::Transaction::Transaction(GEMHwRetryPolicy& policy) :
+  m_policy(policy),
+  m_attempts(0),
+  m_admitted(false),
+  m_probe(false),
+  m_retry(false),
+  m_rejected(false),
+  m_finished(false),
+  m_lastError(UNKNOWN),
+  m_start(0)
+{
+}
+
+gem::hw::GEMHwRetryPolicy::Transaction::~Transaction()
+{
+  // a transaction abandoned between attempts counts as failed
+  if (m_admitted && !m_finished)
+    finish(false);
+}
+
+bool gem::hw::GEMHwRetryPolicy::Transaction::attempt()
+{
+  if (m_finished || m_rejected)
+    return false;
+
+  if (m_attempts == 0) {
+    Admission const admission = m_policy.admit();
+    if (admission == REFUSED) {
+      m_rejected = true;
+      return false;
+    }
+    m_admitted = true;
+    m_probe    = (admission == PROBE);
+    m_start    = now();
+  } else {
+    if (!m_retry)
+      return false;
+    usleep(m_policy.backoff(m_attempts));
+  }
+  ++m_attempts;
+  m_retry = false;
+  return true;
+}
+
+void gem::hw::GEMHwRetryPolicy::Transaction::succeeded()
+{
+  if (m_admitted && !m_finished)
+    finish(true);
+}
+
+gem::hw::GEMHwRetryPolicy::ErrorClass gem::hw::GEMHwRetryPolicy::Transaction::failed(std::string const& what)
+{
+  ErrorClass const errClass = m_policy.classify(what);
+  m_policy.recordError(errClass);
+  m_lastError = errClass;
+
+  Settings const settings = m_policy.getSettings();
+  unsigned maxAttempts = m_probe ? 1 : settings.maxAttempts[errClass];
+  if (gem::utils::HwLock::getAccess() == gem::utils::HwLock::MONITOR)
+    maxAttempts = std::min(maxAttempts, settings.maxMonitorAttempts);
+
+  m_retry = (m_attempts < maxAttempts);
+  if (!m_retry)
+    finish(false);
+  return errClass;
+}
+
+void gem::hw::GEMHwRetryPolicy::Transaction::finish(bool const& success)
+{
+  m_finished = true;
+  m_retry    = false;
+  m_policy.recordOutcome(success, m_probe, m_attempts, now() - m_start, m_lastError);
+}
+
+gem::hw::GEMHwRetryPolicy::GEMHwRetryPolicy(log4cplus::Logger const& logger) :
+  m_gemLogger(logger),
+  m_consecutiveFailures(0),
+  m_openedAt(0),
+  m_probing(false),
+  m_seed(static_cast<unsigned>(now()) ^ static_cast<unsigned>(reinterpret_cast<size_t>(this)))
+{
+  pthread_mutex_init(&m_mutex, NULL);
+}
+
+gem::hw::GEMHwRetryPolicy::~GEMHwRetryPolicy()
+{
+  pthread_mutex_destroy(&m_mutex);
+}
+
+gem::hw::GEMHwRetryPolicy::ErrorClass gem::hw::GEMHwRetryPolicy::classify(std::string const& what) const
+{
+  // the only place knowing the uhal error messages
+  if (what.find("amount of data") != std::string::npos)
+    return BAD_HEADER;
+  if (what.find("INFO CODE = 0x4L") != std::string::npos)
+    return READ_ERROR;
+  if ((what.find("INFO CODE = 0x6L") != std::string::npos) ||
+      (what.find("timed out")        != std::string::npos))
+    return TIMEOUT;
+  if ((what.find("ControlHub error code is: 3") != std::string::npos) ||
+      (what.find("ControlHub error code is: 4") != std::string::npos) ||
+      (what.find("had response field = 0x04")   != std::string::npos) ||
+      (what.find("had response field = 0x06")   != std::string::npos))
+    return CONTROLHUB;
+  return UNKNOWN;
+}
+
+uint32_t gem::hw::GEMHwRetryPolicy::backoff(unsigned const& retry)
+{
+  pthread_mutex_lock(&m_mutex);
+  uint64_t delay = m_settings.initialBackoff;
+  for (unsigned doubling = 1; doubling < retry && delay < m_settings.maxBackoff; ++doubling)
+    delay *= 2;
+  delay = std::min(delay, static_cast<uint64_t>(m_settings.maxBackoff));
+  double const cut = m_settings.jitter*(static_cast<double>(rand_r(&m_seed))/RAND_MAX);
+  pthread_mutex_unlock(&m_mutex);
+  return static_cast<uint32_t>(delay*(1.0 - std::min(std::max(cut, 0.0), 1.0)));
+}
+
+gem::hw::GEMHwRetryPolicy::Settings gem::hw::GEMHwRetryPolicy::getSettings() const
+{
+  pthread_mutex_lock(&m_mutex);
+  Settings settings = m_settings;
+  pthread_mutex_unlock(&m_mutex);
+  return settings;
+}
+
+void gem::hw::GEMHwRetryPolicy::setSettings(Settings const& settings)
+{
+  pthread_mutex_lock(&m_mutex);
+  m_settings = settings;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+gem::hw::GEMHwRetryPolicy::Stats gem::hw::GEMHwRetryPolicy::getStats() const
+{
+  pthread_mutex_lock(&m_mutex);
+  Stats stats = m_stats;
+  pthread_mutex_unlock(&m_mutex);
+  return stats;
+}
+
+void gem::hw::GEMHwRetryPolicy::reset()
+{
+  pthread_mutex_lock(&m_mutex);
+  m_stats.reset();
+  m_consecutiveFailures = 0;
+  m_probing = false;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool gem::hw::GEMHwRetryPolicy::isHealthy() const
+{
+  pthread_mutex_lock(&m_mutex);
+  bool const healthy = m_stats.healthy;
+  pthread_mutex_unlock(&m_mutex);
+  return healthy;
+}
+
+std::string gem::hw::GEMHwRetryPolicy::errorClassName(unsigned const& errClass)
+{
+  switch (errClass) {
+  case BAD_HEADER:
+    return "BAD_HEADER";
+  case READ_ERROR:
+    return "READ_ERROR";
+  case TIMEOUT:
+    return "TIMEOUT";
+  case CONTROLHUB:
+    return "CONTROLHUB";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+std::string gem::hw::GEMHwRetryPolicy::latencyBinLabel(unsigned const& bin)
+{
+  if (bin+1 >= kN_LATENCY_BINS)
+    return toolbox::toString("GE_%dMS", 1 << (2*(kN_LATENCY_BINS-2)));
+  return toolbox::toString("LT_%dMS", 1 << (2*bin));
+}
+
+uint64_t gem::hw::GEMHwRetryPolicy::now()
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return static_cast<uint64_t>(tv.tv_sec)*1000000 + tv.tv_usec;
+}
+
+gem::hw::GEMHwRetryPolicy::Admission gem::hw::GEMHwRetryPolicy::admit()
+{
+  pthread_mutex_lock(&m_mutex);
+  Admission admission = NORMAL;
+  if (!m_stats.healthy) {
+    if (m_probing || now() - m_openedAt < m_settings.openTime) {
+      ++m_stats.nRejected;
+      admission = REFUSED;
+    } else {
+      m_probing = true;
+      admission = PROBE;
+    }
+  }
+  pthread_mutex_unlock(&m_mutex);
+  return admission;
+}
+
+void gem::hw::GEMHwRetryPolicy::recordError(ErrorClass const& errClass)
+{
+  pthread_mutex_lock(&m_mutex);
+  ++m_stats.nErrors[errClass];
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void gem::hw::GEMHwRetryPolicy::recordOutcome(bool const& success, bool const& probe, unsigned const& attempts,
+                                              uint64_t const& elapsed, ErrorClass const& lastError)
+{
+  pthread_mutex_lock(&m_mutex);
+  ++m_stats.nTransactions;
+  if (attempts > 1) {
+    ++m_stats.nRetried;
+    unsigned bin = 0;
+    for (uint64_t edge = 1000; bin+1 < kN_LATENCY_BINS && elapsed >= edge; edge *= 4)
+      ++bin;
+    ++m_stats.retryLatency[bin];
+  }
+
+  bool opened = false, closed = false;
+  if (success) {
+    m_consecutiveFailures = 0;
+    closed = !m_stats.healthy;
+    m_stats.healthy = true;
+  } else {
+    ++m_stats.nFailed;
+    // only the IPBus errors say the device is not answering, the others neither count nor reset the count
+    bool const ipbusError = (lastError != UNKNOWN);
+    if (ipbusError)
+      ++m_consecutiveFailures;
+    if (!m_stats.healthy || (ipbusError && m_consecutiveFailures >= m_settings.failureThreshold)) {
+      opened = m_stats.healthy;
+      m_stats.healthy = false;
+      m_openedAt = now();
+    }
+  }
+  if (probe)
+    m_probing = false;
+  unsigned const nFailures = m_consecutiveFailures;
+  uint32_t const openTime  = m_settings.openTime;
+  pthread_mutex_unlock(&m_mutex);
+
+  if (opened)
+    ERROR("GEMHwRetryPolicy::Device marked unhealthy after " << nFailures
+          << " consecutive failed transactions, refusing its transactions for "
+          << openTime/1000 << " ms");
+  else if (closed)
+    INFO("GEMHwRetryPolicy::Device healthy again, probe transaction succeeded");
+}
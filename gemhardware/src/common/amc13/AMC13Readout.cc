@@ -48,6 +48,8 @@ gem::hw::amc13::AMC13Readout::AMC13Readout(xdaq::ApplicationStub* stub)
 
 gem::hw::amc13::AMC13Readout::~AMC13Readout()
 {
+  // the base class threads call back into this object
+  stopThreads();
 }
 
 void gem::hw::amc13::AMC13Readout::actionPerformed(xdata::Event& event)
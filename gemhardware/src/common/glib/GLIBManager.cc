@@ -8,6 +8,7 @@
 
 #include "gem/hw/glib/GLIBManager.h"
 
+#include "gem/hw/GEMHwDispatcher.h"
 #include "gem/hw/glib/HwGLIB.h"
 #include "gem/hw/glib/GLIBMonitor.h"
 #include "gem/hw/glib/GLIBManagerWeb.h"
@@ -294,6 +295,13 @@ void gem::hw::glib::GLIBManager::initializeAction()
       return;
     }
   }
+  // one thread per GLIB, so that all of them can be configured at the same time
+  unsigned nGLIBs = 0;
+  for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot)
+    if (m_glibInfo[slot].bag.present)
+      ++nGLIBs;
+  p_dispatcher = std::make_shared<gem::hw::GEMHwDispatcher>("GLIBManager", nGLIBs);
+
   // usleep(100); // just for testing the timing of different applications
   DEBUG("GLIBManager::initializeAction end");
 }
@@ -303,6 +311,8 @@ void gem::hw::glib::GLIBManager::configureAction()
 {
   DEBUG("GLIBManager::configureAction");
 
+  // the GLIBs are configured concurrently, each by its own dispatcher thread
+  std::vector<gem::hw::GEMHwDispatcher::request_ptr> requests;
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
     // usleep(50); // just for testing the timing of different applications
     GLIBInfo& info = m_glibInfo[slot].bag;
@@ -311,58 +321,71 @@ void gem::hw::glib::GLIBManager::configureAction()
       continue;
 
     if (m_glibs.at(slot)->isHwConnected()) {
-      m_glibs.at(slot)->resetL1ACount();
-      m_glibs.at(slot)->resetCalPulseCount();
-
-      // reset the DAQ
-      m_glibs.at(slot)->resetDAQLink();
-      m_glibs.at(slot)->setL1AInhibit(0x1);
-
-      if (m_scanType.value_ == 2) {
-	//uint32_t ilatency = m_scanMin.value_;
-	INFO("GLIBManager::configureAction: FIRST  " << m_scanMin.value_);
-
-	m_glibs.at(slot)->setDAQLinkRunType(0x2);
-	m_glibs.at(slot)->setDAQLinkRunParameter(0x1,m_scanMin.value_);
-	// m_glibs.at(slot)->setDAQLinkRunParameter(0x2,VT1);  // set these at start so DQM has them?
-	// m_glibs.at(slot)->setDAQLinkRunParameter(0x3,VT2);  // set these at start so DQM has them?
-      } else if (m_scanType.value_ == 3) {
-	uint32_t initialVT1 = m_scanMin.value_;
-	uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
-	INFO("GLIBManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
-
-	m_glibs.at(slot)->setDAQLinkRunType(0x3);
-	// m_glibs.at(slot)->setDAQLinkRunParameter(0x1,latency);  // set this at start so DQM has it?
-	m_glibs.at(slot)->setDAQLinkRunParameter(0x2,initialVT1);
-	m_glibs.at(slot)->setDAQLinkRunParameter(0x3,initialVT2);
-      } else {
-	m_glibs.at(slot)->setDAQLinkRunType(0x1);
-	m_glibs.at(slot)->setDAQLinkRunParameters(0xfaac);
-      }
-
-      // should FIFOs be emptied in configure or at start?
-      // should be removed as migration to generic AMC firmware happens
-      // INFO("GLIBManager::emptying trigger/tracking data FIFOs");
-      // for (unsigned gtx = 0; gtx < HwGLIB::N_GTX; ++gtx) {
-      //   // m_glibs.at(slot)->flushTriggerFIFO(gtx);
-      //   m_glibs.at(slot)->flushFIFO(gtx);
-      // }
-      // what else is required for configuring the GLIB?
-      // need to reset optical links?
-      // reset counters?
-      // setup run mode?
-      // setup DAQ mode?
+      requests.push_back(p_dispatcher->submit(*m_glibs.at(slot),
+                                              std::make_shared<gem::hw::GEMHwDispatcher::MemberJob<GLIBManager> >(
+                                                this, &GLIBManager::configureGLIB, slot)));
     } else {
       ERROR("GLIBManager::GLIB in slot " << (slot+1) << " is not connected");
       //fireEvent("Fail");
+      // the GLIBs already being configured are waited for, as their jobs refer to this application
+      p_dispatcher->waitAll(requests);
       XCEPT_RAISE(gem::hw::glib::exception::Exception, "configureAction failed");
       // maybe raise exception so as to not continue with other cards?
     }
   }
 
+  if (!p_dispatcher->waitAll(requests))
+    XCEPT_RAISE(gem::hw::glib::exception::Exception, "configureAction failed");
+
   DEBUG("GLIBManager::configureAction end");
 }
 
+void gem::hw::glib::GLIBManager::configureGLIB(unsigned const& slot)
+{
+  DEBUG("GLIBManager::configureGLIB in slot " << (slot+1));
+  m_glibs.at(slot)->resetL1ACount();
+  m_glibs.at(slot)->resetCalPulseCount();
+
+  // reset the DAQ
+  m_glibs.at(slot)->resetDAQLink();
+  m_glibs.at(slot)->setL1AInhibit(0x1);
+
+  if (m_scanType.value_ == 2) {
+    //uint32_t ilatency = m_scanMin.value_;
+    INFO("GLIBManager::configureAction: FIRST  " << m_scanMin.value_);
+
+    m_glibs.at(slot)->setDAQLinkRunType(0x2);
+    m_glibs.at(slot)->setDAQLinkRunParameter(0x1,m_scanMin.value_);
+    // m_glibs.at(slot)->setDAQLinkRunParameter(0x2,VT1);  // set these at start so DQM has them?
+    // m_glibs.at(slot)->setDAQLinkRunParameter(0x3,VT2);  // set these at start so DQM has them?
+  } else if (m_scanType.value_ == 3) {
+    uint32_t initialVT1 = m_scanMin.value_;
+    uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
+    INFO("GLIBManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
+
+    m_glibs.at(slot)->setDAQLinkRunType(0x3);
+    // m_glibs.at(slot)->setDAQLinkRunParameter(0x1,latency);  // set this at start so DQM has it?
+    m_glibs.at(slot)->setDAQLinkRunParameter(0x2,initialVT1);
+    m_glibs.at(slot)->setDAQLinkRunParameter(0x3,initialVT2);
+  } else {
+    m_glibs.at(slot)->setDAQLinkRunType(0x1);
+    m_glibs.at(slot)->setDAQLinkRunParameters(0xfaac);
+  }
+
+  // should FIFOs be emptied in configure or at start?
+  // should be removed as migration to generic AMC firmware happens
+  // INFO("GLIBManager::emptying trigger/tracking data FIFOs");
+  // for (unsigned gtx = 0; gtx < HwGLIB::N_GTX; ++gtx) {
+  //   // m_glibs.at(slot)->flushTriggerFIFO(gtx);
+  //   m_glibs.at(slot)->flushFIFO(gtx);
+  // }
+  // what else is required for configuring the GLIB?
+  // need to reset optical links?
+  // reset counters?
+  // setup run mode?
+  // setup DAQ mode?
+}
+
 void gem::hw::glib::GLIBManager::startAction()
   throw (gem::hw::glib::exception::Exception)
 {
@@ -662,6 +685,30 @@ void gem::hw::glib::GLIBManager::createGLIBInfoSpaceItems(is_toolbox_ptr is_glib
   // TTC registers
   is_glib->createUInt32("TTC_CONTROL", glib->getTTCControl(),   NULL, GEMUpdateType::HW32);
   is_glib->createUInt32("TTC_SPY",     glib->getTTCSpyBuffer(), NULL, GEMUpdateType::HW32);
+
+  // contention of the lock serializing the access to the device, times in microseconds
+  is_glib->createUInt64("LOCK_ACQUIRED",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_SHARED",       0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_CONTENDED",    0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_WAIT_READOUT", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_WAIT_CONTROL", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_WAIT_MONITOR", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_MAX_WAIT",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_HOLD",         0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("LOCK_MAX_HOLD",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+
+  // retries of the failed transactions, and whether the device is still accessed
+  is_glib->createUInt32("DEVICE_HEALTHY",     1, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("RETRY_TRANSACTIONS", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("RETRY_RETRIED",      0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("RETRY_FAILED",       0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_glib->createUInt64("RETRY_REJECTED",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  for (unsigned errClass = 0; errClass < gem::hw::GEMHwRetryPolicy::kN_ERROR_CLASSES; ++errClass)
+    is_glib->createUInt64("RETRY_ERR_"+gem::hw::GEMHwRetryPolicy::errorClassName(errClass),
+                          0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  for (unsigned bin = 0; bin < gem::hw::GEMHwRetryPolicy::kN_LATENCY_BINS; ++bin)
+    is_glib->createUInt64("RETRY_LATENCY_"+gem::hw::GEMHwRetryPolicy::latencyBinLabel(bin),
+                          0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
 }
 
 void gem::hw::glib::GLIBManager::dumpGLIBFIFO(xgi::Input* in, xgi::Output* out)
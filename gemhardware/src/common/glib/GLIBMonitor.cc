@@ -231,6 +231,61 @@ void gem::hw::glib::GLIBMonitor::setupHwMonitoring()
   addMonitorable("TTC", "HWMonitoring",
                  std::make_pair("TTC_SPY", "GLIB.TTC.SPY"),
                  GEMUpdateType::HW32, "hex");
+
+  addMonitorableSet("Hardware Lock", "HWMonitoring");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_ACQUIRED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_SHARED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_CONTENDED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_WAIT_READOUT", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_WAIT_CONTROL", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_WAIT_MONITOR", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_MAX_WAIT", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_HOLD", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("Hardware Lock", "HWMonitoring",
+                 std::make_pair("LOCK_MAX_HOLD", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+
+  addMonitorableSet("IPBus Retries", "HWMonitoring");
+  addMonitorable("IPBus Retries", "HWMonitoring",
+                 std::make_pair("DEVICE_HEALTHY", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("IPBus Retries", "HWMonitoring",
+                 std::make_pair("RETRY_TRANSACTIONS", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("IPBus Retries", "HWMonitoring",
+                 std::make_pair("RETRY_RETRIED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("IPBus Retries", "HWMonitoring",
+                 std::make_pair("RETRY_FAILED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  addMonitorable("IPBus Retries", "HWMonitoring",
+                 std::make_pair("RETRY_REJECTED", ""),
+                 GEMUpdateType::NOUPDATE, "dec");
+  for (unsigned errClass = 0; errClass < gem::hw::GEMHwRetryPolicy::kN_ERROR_CLASSES; ++errClass)
+    addMonitorable("IPBus Retries", "HWMonitoring",
+                   std::make_pair("RETRY_ERR_"+gem::hw::GEMHwRetryPolicy::errorClassName(errClass), ""),
+                   GEMUpdateType::NOUPDATE, "dec");
+  for (unsigned bin = 0; bin < gem::hw::GEMHwRetryPolicy::kN_LATENCY_BINS; ++bin)
+    addMonitorable("IPBus Retries", "HWMonitoring",
+                   std::make_pair("RETRY_LATENCY_"+gem::hw::GEMHwRetryPolicy::latencyBinLabel(bin), ""),
+                   GEMUpdateType::NOUPDATE, "dec");
+
   updateMonitorables();
 }
 
@@ -243,58 +298,168 @@ void gem::hw::glib::GLIBMonitor::updateMonitorables()
 {
   // define how to update the desired values
   // get SYSTEM monitorables
-  // can this be split into two loops, one just to do a list read, the second to fill the InfoSpace with the returned values
+  // all the registers are read in a single transaction, or one monitorable at a time if that fails,
+  // then the loop fills the InfoSpace with the returned values, in the same order
   DEBUG("GLIBMonitor: Updating monitorables");
+  // the monitoring reads give way to the readout and to the control of the device
+  gem::utils::HwLock::AccessScope monitorAccess(gem::utils::HwLock::MONITOR);
+  size_t nMonitorables = 0;
+  for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist)
+    nMonitorables += monlist->second.size();
+  if (m_monitorableRegs.size() != nMonitorables)
+    resolveMonitorables();
+
+  // the lock and retry counters are not registers, they are filled from the device directly
+  auto hwMonitoring = m_infoSpaceMap.find("HWMonitoring");
+  if (hwMonitoring != m_infoSpaceMap.end() && hwMonitoring->second.first->find("LOCK_ACQUIRED")) {
+    gem::utils::HwLock::Stats const lockStats = p_glib->getLockStats();
+    std::shared_ptr<gem::base::utils::GEMInfoSpaceToolBox> is_hw = hwMonitoring->second.first;
+    is_hw->setUInt64("LOCK_ACQUIRED",     lockStats.nLocks);
+    is_hw->setUInt64("LOCK_SHARED",       lockStats.nSharedLocks);
+    is_hw->setUInt64("LOCK_CONTENDED",    lockStats.nContended);
+    is_hw->setUInt64("LOCK_WAIT_READOUT", lockStats.waitTime[gem::utils::HwLock::READOUT]);
+    is_hw->setUInt64("LOCK_WAIT_CONTROL", lockStats.waitTime[gem::utils::HwLock::CONTROL]);
+    is_hw->setUInt64("LOCK_WAIT_MONITOR", lockStats.waitTime[gem::utils::HwLock::MONITOR]);
+    is_hw->setUInt64("LOCK_MAX_WAIT",     lockStats.maxWaitTime);
+    is_hw->setUInt64("LOCK_HOLD",         lockStats.holdTime);
+    is_hw->setUInt64("LOCK_MAX_HOLD",     lockStats.maxHoldTime);
+  }
+  if (hwMonitoring != m_infoSpaceMap.end() && hwMonitoring->second.first->find("RETRY_TRANSACTIONS")) {
+    gem::hw::GEMHwRetryPolicy::Stats const retryStats = p_glib->getRetryStats();
+    std::shared_ptr<gem::base::utils::GEMInfoSpaceToolBox> is_hw = hwMonitoring->second.first;
+    is_hw->setUInt32("DEVICE_HEALTHY",     retryStats.healthy ? 1 : 0);
+    is_hw->setUInt64("RETRY_TRANSACTIONS", retryStats.nTransactions);
+    is_hw->setUInt64("RETRY_RETRIED",      retryStats.nRetried);
+    is_hw->setUInt64("RETRY_FAILED",       retryStats.nFailed);
+    is_hw->setUInt64("RETRY_REJECTED",     retryStats.nRejected);
+    for (unsigned errClass = 0; errClass < gem::hw::GEMHwRetryPolicy::kN_ERROR_CLASSES; ++errClass)
+      is_hw->setUInt64("RETRY_ERR_"+gem::hw::GEMHwRetryPolicy::errorClassName(errClass),
+                       retryStats.nErrors[errClass]);
+    for (unsigned bin = 0; bin < gem::hw::GEMHwRetryPolicy::kN_LATENCY_BINS; ++bin)
+      is_hw->setUInt64("RETRY_LATENCY_"+gem::hw::GEMHwRetryPolicy::latencyBinLabel(bin),
+                       retryStats.retryLatency[bin]);
+  }
+
+  std::vector<monitorable_vals> vals(m_monitorableRegs.size());
+  if (!readMonitorables(vals, 0, m_monitorableRegs.size())) {
+    WARN("GLIBMonitor: Unable to read the monitorables together, reading them one at a time");
+    size_t nRead = 0;
+    std::vector<size_t> failed;
+    for (size_t mon = 0; mon < m_monitorableRegs.size(); ++mon) {
+      if (!m_monitorableRegs[mon].first)
+        continue;
+      if (readMonitorables(vals, mon, mon+1))
+        ++nRead;
+      else
+        failed.push_back(mon);
+    }
+    // when nothing could be read the device is at fault, not the registers, so they are all kept
+    if (nRead > 0) {
+      for (auto mon = failed.begin(); mon != failed.end(); ++mon) {
+        WARN("GLIBMonitor: Unable to read " << m_monitorableRegs[*mon].first->name
+             << ", the monitorable is not updated any more");
+        m_monitorableRegs[*mon] = monitorable_regs(NULL, NULL);
+      }
+    }
+  }
+
+  auto val = vals.begin();
   for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist) {
     DEBUG("GLIBMonitor: Updating monitorables in set " << monlist->first);
-    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
+    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem, ++val) {
+      // nothing was read for the items without registers
+      if (!val->first)
+        continue;
       DEBUG("GLIBMonitor: Updating monitorable " << monitem->first);
-      std::stringstream regName;
-      regName << monitem->second.regname;
-      uint32_t address = p_glib->getGEMHwInterface().getNode(regName.str()).getAddress();
-      uint32_t mask    = p_glib->getGEMHwInterface().getNode(regName.str()).getMask();
       if (monitem->second.updatetype == GEMUpdateType::HW8) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       } else if (monitem->second.updatetype == GEMUpdateType::HW16) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       } else if (monitem->second.updatetype == GEMUpdateType::HW24) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       } else if (monitem->second.updatetype == GEMUpdateType::HW32) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       } else if (monitem->second.updatetype == GEMUpdateType::HW64) {
-        address = p_glib->getGEMHwInterface().getNode(regName.str()+".LOWER").getAddress();
-        mask    = p_glib->getGEMHwInterface().getNode(regName.str()+".LOWER").getMask();
-        uint32_t lower = p_glib->readReg(address,mask);
-        address = p_glib->getGEMHwInterface().getNode(regName.str()+".UPPER").getAddress();
-        mask    = p_glib->getGEMHwInterface().getNode(regName.str()+".UPPER").getMask();
-        uint32_t upper = p_glib->readReg(address,mask);
+        uint32_t lower = val->second.first;
+        uint32_t upper = val->second.second;
         (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)upper) << 32) + lower);
       } else if (monitem->second.updatetype == GEMUpdateType::I2CSTAT) {
-        std::stringstream strobeReg;
-        strobeReg << regName.str() << ".Strobe." << monitem->first;
-        address = p_glib->getGEMHwInterface().getNode(strobeReg.str()).getAddress();
-        mask    = p_glib->getGEMHwInterface().getNode(strobeReg.str()).getMask();
-        uint32_t strobe = p_glib->readReg(address,mask);
-        std::stringstream ackReg;
-        ackReg << regName.str() << ".Ack." << monitem->first;
-        address = p_glib->getGEMHwInterface().getNode(ackReg.str()).getAddress();
-        mask    = p_glib->getGEMHwInterface().getNode(ackReg.str()).getMask();
-        uint32_t ack = p_glib->readReg(address,mask);
+        uint32_t strobe = val->second.first;
+        uint32_t ack    = val->second.second;
         (monitem->second.infoSpace)->setUInt64(monitem->first, (((uint64_t)ack) << 32) + strobe);
       } else if (monitem->second.updatetype == GEMUpdateType::PROCESS) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       } else if (monitem->second.updatetype == GEMUpdateType::TRACKER) {
-        (monitem->second.infoSpace)->setUInt32(monitem->first,p_glib->readReg(address,mask));
-      } else if (monitem->second.updatetype == GEMUpdateType::NOUPDATE) {
-        continue;
-      } else {
-        ERROR("GLIBMonitor: Unknown update type encountered");
-        continue;
+        (monitem->second.infoSpace)->setUInt32(monitem->first,val->second.first);
       }
     } // end loop over items in list
   } // end loop over monitorableSets
 }
 
+bool gem::hw::glib::GLIBMonitor::readMonitorables(std::vector<monitorable_vals>& vals,
+                                                  size_t const& begin, size_t const& end)
+{
+  gem::hw::GEMHwDevice::Batch batch(*p_glib);
+  std::vector<std::pair<gem::hw::GEMHwDevice::Batch::Handle, gem::hw::GEMHwDevice::Batch::Handle> > handles;
+  handles.reserve(end-begin);
+  for (size_t mon = begin; mon < end; ++mon) {
+    gem::hw::GEMHwDevice::Batch::Handle first, second;
+    if (m_monitorableRegs[mon].first)
+      first  = batch.read(*(m_monitorableRegs[mon].first));
+    if (m_monitorableRegs[mon].second)
+      second = batch.read(*(m_monitorableRegs[mon].second));
+    handles.push_back(std::make_pair(first, second));
+  }
+  if (!batch.commit())
+    return false;
+
+  for (size_t mon = begin; mon < end; ++mon) {
+    std::pair<gem::hw::GEMHwDevice::Batch::Handle, gem::hw::GEMHwDevice::Batch::Handle> const& handle = handles[mon-begin];
+    vals[mon] = std::make_pair(handle.first.ready(),
+                               std::make_pair(handle.first.value(), handle.second.value()));
+  }
+  return true;
+}
+
+void gem::hw::glib::GLIBMonitor::resolveMonitorables()
+{
+  DEBUG("GLIBMonitor: Resolving the monitorable registers");
+  m_monitorableRegs.clear();
+  for (auto monlist = m_monitorableSetsMap.begin(); monlist != m_monitorableSetsMap.end(); ++monlist) {
+    for (auto monitem = monlist->second.begin(); monitem != monlist->second.end(); ++monitem) {
+      std::stringstream regName;
+      regName << monitem->second.regname;
+      monitorable_regs regs(NULL, NULL);
+      try {
+        if (monitem->second.updatetype == GEMUpdateType::HW64) {
+          regs.first  = &p_glib->getRegisterHandle(regName.str()+".LOWER");
+          regs.second = &p_glib->getRegisterHandle(regName.str()+".UPPER");
+        } else if (monitem->second.updatetype == GEMUpdateType::I2CSTAT) {
+          std::stringstream strobeReg;
+          strobeReg << regName.str() << ".Strobe." << monitem->first;
+          std::stringstream ackReg;
+          ackReg << regName.str() << ".Ack." << monitem->first;
+          regs.first  = &p_glib->getRegisterHandle(strobeReg.str());
+          regs.second = &p_glib->getRegisterHandle(ackReg.str());
+        } else if (monitem->second.updatetype == GEMUpdateType::HW8     ||
+                   monitem->second.updatetype == GEMUpdateType::HW16    ||
+                   monitem->second.updatetype == GEMUpdateType::HW24    ||
+                   monitem->second.updatetype == GEMUpdateType::HW32    ||
+                   monitem->second.updatetype == GEMUpdateType::PROCESS ||
+                   monitem->second.updatetype == GEMUpdateType::TRACKER) {
+          regs.first  = &p_glib->getRegisterHandle(regName.str());
+        } else if (monitem->second.updatetype != GEMUpdateType::NOUPDATE) {
+          ERROR("GLIBMonitor: Unknown update type encountered for " << monitem->first);
+        }
+      } catch (uhal::exception::exception const& err) {
+        WARN("GLIBMonitor: Unable to find the registers of " << monitem->first << ": " << err.what());
+        regs = monitorable_regs(NULL, NULL);
+      }
+      m_monitorableRegs.push_back(regs);
+    }
+  }
+}
+
 void gem::hw::glib::GLIBMonitor::buildMonitorPage(xgi::Output* out)
 {
   DEBUG("GLIBMonitor::buildMonitorPage");
@@ -378,5 +543,6 @@ void gem::hw::glib::GLIBMonitor::reset()
   m_infoSpaceMap.clear();
   m_infoSpaceMonitorableSetMap.clear();
   m_monitorableSetInfoSpaceMap.clear();
+  m_monitorableRegs.clear();
   m_monitorableSetsMap.clear();
 }
@@ -8,42 +8,83 @@
 
 #include "gem/hw/glib/GLIBReadout.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
+#include <unistd.h>
 
 #include "boost/format.hpp"
 #include "boost/lexical_cast.hpp"
 #include "boost/utility/binary.hpp"
 
 #include "gem/hw/glib/HwGLIB.h"
+#include "gem/hw/utils/GEMCrateUtils.h"
 #include "gem/utils/soap/GEMSOAPToolBox.h"
+#include "gem/readout/GEMVFATDecoder.h"
 #include "gem/readout/exception/Exception.h"
 
 XDAQ_INSTANTIATOR_IMPL(gem::hw::glib::GLIBReadout);
 
 const uint32_t gem::hw::glib::GLIBReadout::kUPDATE  = 5000;
 const uint32_t gem::hw::glib::GLIBReadout::kUPDATE7 = 7;
+const unsigned gem::hw::glib::GLIBReadout::kREADER_IDLE_USEC = 100;
+const size_t   gem::hw::glib::GLIBReadout::kMERGE_BACKLOG    = 7*1024;
 
 gem::hw::glib::GLIBReadout::GLIBReadout(xdaq::ApplicationStub* stub) :
   GEMReadoutApplication(stub),
   m_runType(0x0),
   m_runParams(0x0),
+  m_amcSlots(""),
+  m_crateID(1),
+  m_linkMask((0x1 << HwGLIB::N_GTX) - 1),
+  m_maxBlocksPerRead(0),
+  m_eventWindow(1),
+  m_eventTimeoutMsec(0),
+  m_sourceID(0),
+  m_readersRunning(false),
+  m_readersExit(false),
   m_ESexp(-1),
   m_isFirst(true),
   m_contvfats(0),
+  m_rvent(0),
+  m_outWriter(new gem::readout::GEMEventWriter(gem::readout::GEMEventWriter::kDEFAULT_BUFFER_SIZE, true)),
+  m_errWriter(new gem::readout::GEMEventWriter(gem::readout::GEMEventWriter::kDEFAULT_BUFFER_SIZE, true)),
   m_queueLock(toolbox::BSem::FULL, true)
 {
   xoap::bind(this,&GLIBReadout::updateScanParameters,"UpdateScanParameter","urn:GLIBReadout-soap:1");
   //xoap::bind(this,&GLIBReadout::queueDepth,          "QueueDepth",         "urn:GLIBReadout-soap:1");
   p_appInfoSpace->fireItemAvailable("QueueDepth", &m_queueDepth);
+  p_appInfoSpace->fireItemAvailable("AMCSlots",   &m_amcSlots);
+  p_appInfoSpace->fireItemAvailable("CrateID",    &m_crateID);
+  p_appInfoSpace->fireItemAvailable("LinkMask",   &m_linkMask);
+  p_appInfoSpace->fireItemAvailable("MaxBlocksPerRead", &m_maxBlocksPerRead);
+  p_appInfoSpace->fireItemAvailable("EventWindow",      &m_eventWindow);
+  p_appInfoSpace->fireItemAvailable("EventTimeoutMsec", &m_eventTimeoutMsec);
+  p_appInfoSpace->fireItemAvailable("SourceID",         &m_sourceID);
+
+  m_resyncCountPerLink.setSize((MAX_AMCS_PER_CRATE+1)*HwGLIB::N_GTX);
+  m_skippedWordsPerLink.setSize((MAX_AMCS_PER_CRATE+1)*HwGLIB::N_GTX);
+  p_appInfoSpace->fireItemAvailable("ResyncCount",         &m_resyncCount);
+  p_appInfoSpace->fireItemAvailable("SkippedWords",        &m_skippedWords);
+  p_appInfoSpace->fireItemAvailable("ResyncCountPerLink",  &m_resyncCountPerLink);
+  p_appInfoSpace->fireItemAvailable("SkippedWordsPerLink", &m_skippedWordsPerLink);
+  p_appInfoSpace->fireItemAvailable("CRCMismatches",       &m_crcMismatches);
 }
 
 gem::hw::glib::GLIBReadout::~GLIBReadout()
 {
   DEBUG("GLIBReadout::destructor called");
+  // the base class threads call back into this object
+  stopThreads();
+  m_readersRunning = false;
+  m_readersExit    = true;
+  for (auto amc = m_amcReaders.begin(); amc != m_amcReaders.end(); ++amc)
+    while (!(*amc)->done)
+      usleep(kREADER_IDLE_USEC);
 }
 
 void gem::hw::glib::GLIBReadout::actionPerformed(xdata::Event& event)
@@ -61,7 +102,33 @@ void gem::hw::glib::GLIBReadout::initializeAction()
 {
   INFO("GLIBReadout::initializeAction begin");
   try {
-    p_glib = glib_shared_ptr(new gem::hw::glib::HwGLIB(m_deviceName.toString(), m_connectionFile.toString()));
+    if (m_amcReaders.empty()) {
+      // same slot map and device naming as the GLIBManager
+      uint16_t slotMask = 0x0;
+      if (!m_amcSlots.toString().empty())
+        slotMask = gem::hw::utils::parseAMCEnableList(m_amcSlots.toString());
+
+      for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
+        if (!((slotMask >> slot) & 0x1))
+          continue;
+        std::shared_ptr<AMCReader> amc(new AMCReader());
+        amc->slot       = slot+1;
+        amc->deviceName = toolbox::toString("gem.shelf%02d.glib%02d", m_crateID.value_, slot+1);
+        m_amcReaders.push_back(amc);
+      }
+      if (m_amcReaders.empty()) {
+        std::shared_ptr<AMCReader> amc(new AMCReader());
+        amc->slot       = 0;
+        amc->deviceName = m_deviceName.toString();
+        m_amcReaders.push_back(amc);
+      }
+    }
+
+    for (auto amc = m_amcReaders.begin(); amc != m_amcReaders.end(); ++amc) {
+      DEBUG("GLIBReadout::initializeAction connecting to " << (*amc)->deviceName);
+      (*amc)->glib = glib_shared_ptr(new gem::hw::glib::HwGLIB((*amc)->deviceName, m_connectionFile.toString()));
+    }
+    p_glib = m_amcReaders.front()->glib;
   } catch (gem::hw::glib::exception::Exception const& ex) {
     ERROR("GLIBReadout::initializeAction caught exception " << ex.what());
     XCEPT_RAISE(gem::hw::glib::exception::Exception, "initializeAction failed");
@@ -72,8 +139,24 @@ void gem::hw::glib::GLIBReadout::initializeAction()
     ERROR("GLIBReadout::initializeAction caught exception " << ex.what());
     XCEPT_RAISE(gem::hw::glib::exception::Exception, "initializeAction failed");
   }
-  DEBUG("GLIBReadout::initializeAction connected");
-
+  DEBUG("GLIBReadout::initializeAction connected to " << m_amcReaders.size() << " AMCs");
+
+  gem::readout::GEMReadoutApplication::initializeAction();
+
+  // the readers need the pool, so are only started once the base has created it
+  size_t nFrames = m_readoutSettings.bag.poolSize.value_/std::max(m_readoutSettings.bag.frameSize.value_, 1U);
+  for (unsigned index = 0; index < m_amcReaders.size(); ++index) {
+    AMCReader& amc = *m_amcReaders.at(index);
+    if (amc.task)
+      continue;
+    amc.pending.assign(HwGLIB::N_GTX, 0);
+    amc.frames = std::unique_ptr<gem::utils::SPSCQueue<toolbox::mem::Reference*> >(
+      new gem::utils::SPSCQueue<toolbox::mem::Reference*>(nFrames+1));
+    amc.idle = true;
+    amc.done = false;
+    amc.task = std::make_shared<gem::hw::glib::GLIBAMCReadoutTask>(this, index);
+    amc.task->activate();
+  }
 }
 
 
@@ -86,46 +169,300 @@ void gem::hw::glib::GLIBReadout::configureAction()
   m_errFileName  = m_outFileName + "_ERR";
   //m_slotFileName = slotFileName;
   m_outputType   = m_readoutSettings.bag.outputType.toString();
+  m_serializer.setOutputType(gem::readout::GEMEventSerializer::parseOutputType(m_outputType));
+  m_serializer.setSourceID(m_sourceID.value_);
+  m_serializer.setZeroSuppression(m_readoutSettings.bag.zeroSuppress.value_,
+                                  m_readoutSettings.bag.sparseMaxStrips.value_);
+  // the files are opened at start, the compression is set while they are closed
+  int const compressionLevel = (m_outputType == "BinZ") ? m_readoutSettings.bag.compressionLevel.value_ : 0;
+  m_outWriter->setCompression(compressionLevel);
+  m_errWriter->setCompression(compressionLevel);
+  // only the data file is segmented, the error file stays small
+  m_outWriter->setRotation(m_readoutSettings.bag.segmentEvents.value_,
+                           m_readoutSettings.bag.segmentBytes.value_,
+                           m_readoutSettings.bag.segmentSeconds.value_);
+  gem::readout::GEMEventWriter::FsyncPolicy const fsyncPolicy =
+    gem::readout::GEMEventWriter::parseFsyncPolicy(m_readoutSettings.bag.fsyncPolicy.toString());
+  m_outWriter->setFsyncPolicy(fsyncPolicy);
+  m_errWriter->setFsyncPolicy(fsyncPolicy);
+  // the error file gets little data, only the data file bypasses the page cache
+  m_outWriter->setDirectIO(m_readoutSettings.bag.directIO.value_);
   m_counter = {0,0,0,0,0};
   m_vfat = 0;
   m_event = 0;
   m_sumVFAT = 0;
+  m_resyncCount  = 0;
+  m_skippedWords = 0;
+  for (unsigned link = 0; link < m_resyncCountPerLink.size(); ++link) {
+    m_resyncCountPerLink[link]  = 0;
+    m_skippedWordsPerLink[link] = 0;
+  }
+  m_dataChecker.resetCounters();
+  m_crcMismatches = 0;
+  m_eventBuilder.clear();
+  m_eventBuilder.setWindow(m_eventWindow.value_);
+  m_eventBuilder.setTimeout(m_eventTimeoutMsec.value_);
+  gem::readout::GEMReadoutApplication::configureAction();
 }
 
 void gem::hw::glib::GLIBReadout::startAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::startAction begin");
+  if (!m_outWriter->open(m_outFileName))
+    XCEPT_RAISE(gem::hw::glib::exception::Exception, "startAction unable to open " + m_outFileName);
+  if (!m_errWriter->open(m_errFileName))
+    XCEPT_RAISE(gem::hw::glib::exception::Exception, "startAction unable to open " + m_errFileName);
+  gem::readout::GEMReadoutApplication::startAction();
+  startReaders();
 }
 
 void gem::hw::glib::GLIBReadout::pauseAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::pauseAction begin");
+  stopReaders();
+  gem::readout::GEMReadoutApplication::pauseAction();
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+  m_outWriter->flush();
+  m_errWriter->flush();
 }
 
 void gem::hw::glib::GLIBReadout::resumeAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::resumeAction begin");
+  gem::readout::GEMReadoutApplication::resumeAction();
+  startReaders();
 }
 
 void gem::hw::glib::GLIBReadout::stopAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::stopAction begin");
+  stopReaders();
+  gem::readout::GEMReadoutApplication::stopAction();
+  // wait for the readout task to finish with the writers
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+  // nothing more is coming, write out whatever is left on the links
+  buildEvents(true);
+  m_eventBuilder.flush();
+  writeClosedEvents();
+  m_linkBuffers.clear();
+  m_outWriter->close();
+  m_errWriter->close();
+  reportCRCMismatches();
 }
 
 void gem::hw::glib::GLIBReadout::haltAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::haltAction begin");
+  stopReaders();
+  gem::readout::GEMReadoutApplication::haltAction();
+  // wait for the readout task to finish with the writers
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+  m_linkBuffers.clear();
+  m_outWriter->close();
+  m_errWriter->close();
 }
 
 void gem::hw::glib::GLIBReadout::resetAction()
   throw (gem::hw::glib::exception::Exception)
 {
   INFO("GLIBReadout::resetAction begin");
+  gem::readout::GEMReadoutApplication::resetAction();
+  // wait for the readout task to finish with the writers
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+  m_outWriter->close();
+  m_errWriter->close();
+}
+
+void gem::hw::glib::GLIBReadout::startReaders()
+{
+  for (auto amc = m_amcReaders.begin(); amc != m_amcReaders.end(); ++amc) {
+    (*amc)->pending.assign(HwGLIB::N_GTX, 0);
+    (*amc)->idle = false;
+  }
+  __sync_synchronize();
+  m_readersRunning = true;
+}
+
+void gem::hw::glib::GLIBReadout::stopReaders()
+{
+  m_readersRunning = false;
+
+  // the readout task is still running and collects the last frames from the readers
+  for (unsigned msec = 0; msec < kDRAIN_TIMEOUT_MSEC; ++msec) {
+    __sync_synchronize();
+    bool drained = true;
+    for (auto amc = m_amcReaders.begin(); amc != m_amcReaders.end(); ++amc)
+      if ((*amc)->task && (!(*amc)->idle || !(*amc)->frames->empty()))
+        drained = false;
+    if (drained)
+      return;
+    usleep(1000);
+  }
+  WARN("GLIBReadout::stopReaders timed out waiting for the AMC readers");
+}
+
+int gem::hw::glib::GLIBReadout::amcReadoutTask(unsigned const& index)
+{
+  AMCReader& amc = *m_amcReaders.at(index);
+  std::vector<std::vector<toolbox::mem::Reference*> > data(HwGLIB::N_GTX);
+  std::vector<uint32_t> nBlocks(HwGLIB::N_GTX, 0);
+  // the other users of the GLIB wait while this thread is waiting for it
+  gem::utils::HwLock::AccessScope readoutAccess(gem::utils::HwLock::READOUT);
+
+  // each frame starts with a tag word identifying the link it was read from
+  size_t const blocksPerFrame =
+    (m_readoutSettings.bag.frameSize.value_ - sizeof(uint32_t))/(7*sizeof(uint32_t));
+
+  while (!m_readersExit) {
+    if (!m_readersRunning) {
+      amc.idle = true;
+      usleep(kREADER_IDLE_USEC);
+      continue;
+    }
+    amc.idle = false;
+
+    // the links of one AMC are read in a single dispatch, so their transactions are in flight together
+    uint32_t gtxMask = 0;
+    for (uint8_t gtx = 0; gtx < HwGLIB::N_GTX; ++gtx) {
+      data.at(gtx).clear();
+      nBlocks.at(gtx) = 0;
+      if (!((m_linkMask.value_ >> gtx) & 0x1) || !amc.glib->isLinkActive(gtx))
+        continue;
+      gtxMask |= (0x1 << gtx);
+
+      // the occupancy comes back with every read, so reading what was left last time
+      // and finding out what to read next costs a single dispatch
+      nBlocks.at(gtx) = amc.pending.at(gtx);
+      if (m_maxBlocksPerRead.value_ > 0)
+        nBlocks.at(gtx) = std::min(nBlocks.at(gtx), m_maxBlocksPerRead.value_);
+
+      // if the pool runs dry the remainder is picked up on the next pass
+      for (uint32_t nAlloc = 0; nAlloc < nBlocks.at(gtx) && blocksPerFrame > 0; nAlloc += blocksPerFrame) {
+        toolbox::mem::Reference* frame = allocateFrame();
+        if (!frame)
+          break;
+        *static_cast<uint32_t*>(frame->getDataLocation()) = sourceTag(amc.slot, gtx);
+        frame->setDataSize(sizeof(uint32_t));
+        data.at(gtx).push_back(frame);
+      }
+    }
+
+    uint32_t nRead = 0;
+    if (gtxMask) {
+      try {
+        nRead = amc.glib->getTrackingData(gtxMask, data, nBlocks, amc.pending);
+      } catch (xcept::Exception const& e) {
+        ERROR("GLIBReadout::amcReadoutTask " << amc.deviceName << " caught exception " << e.what());
+      } catch (std::exception const& e) {
+        ERROR("GLIBReadout::amcReadoutTask " << amc.deviceName << " caught exception " << e.what());
+      }
+    }
+
+    // the queue can hold every frame in the pool, only frames with data are passed on
+    for (auto link = data.begin(); link != data.end(); ++link) {
+      for (auto frame = link->begin(); frame != link->end(); ++frame)
+        if ((*frame)->getDataSize() <= sizeof(uint32_t) || !amc.frames->push(*frame))
+          (*frame)->release();
+      link->clear();
+    }
+
+    if (nRead == 0)
+      usleep(kREADER_IDLE_USEC);
+  }
+  amc.idle = true;
+  amc.done = true;
+  return 0;
+}
+
+int gem::hw::glib::GLIBReadout::readout(unsigned int expected, unsigned int* eventNumbers,
+                                        std::vector< ::toolbox::mem::Reference* >& data)
+{
+  // the hardware is polled by the AMC readers, collect what they have read
+  int nRead = 0;
+  toolbox::mem::Reference* frame = NULL;
+  for (auto amc = m_amcReaders.begin(); amc != m_amcReaders.end(); ++amc) {
+    if (!(*amc)->frames)
+      continue;
+    while ((*amc)->frames->pop(frame)) {
+      nRead += (frame->getDataSize() - sizeof(uint32_t))/(7*sizeof(uint32_t));
+      data.push_back(frame);
+    }
+  }
+
+  if (data.empty())
+    usleep(kREADER_IDLE_USEC);
+  else
+    DEBUG("GLIBReadout::readout collected " << nRead << " VFAT blocks in " << data.size() << " frames");
+  return nRead;
+}
+
+void gem::hw::glib::GLIBReadout::processData(std::vector< ::toolbox::mem::Reference* >& data)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+  for (auto frame = data.begin(); frame != data.end(); ++frame) {
+    size_t nWords = (*frame)->getDataSize()/sizeof(uint32_t);
+    if (nWords < 2)
+      continue;
+    uint32_t const* words = static_cast<uint32_t const*>((*frame)->getDataLocation());
+    std::shared_ptr<gem::readout::GEMReadoutBuffer>& buffer = m_linkBuffers[words[0]];
+    if (!buffer)
+      buffer = std::make_shared<gem::readout::GEMReadoutBuffer>();
+    uint32_t* dest = buffer->reserve(nWords-1);
+    memcpy(dest, words+1, (nWords-1)*sizeof(uint32_t));
+    buffer->commit(nWords-1);
+  }
+
+  buildEvents(false);
+  // events waiting for blocks that never came
+  m_eventBuilder.expire();
+  writeClosedEvents();
+
+  updateWriterCounters(*m_outWriter);
+}
+
+void gem::hw::glib::GLIBReadout::buildEvents(bool const& flush)
+{
+  while (true) {
+    auto current = m_linkBuffers.end();  // a link with more of the event being built
+    auto next    = m_linkBuffers.end();  // the link holding the next event
+    uint32_t nextDistance = 0x100;
+    size_t   backlog      = 0;
+    bool     waiting      = false;
+
+    for (auto link = m_linkBuffers.begin(); link != m_linkBuffers.end(); ++link) {
+      gem::readout::GEMReadoutBuffer& buffer = *(link->second);
+      if (buffer.size() < 7) {
+        waiting = true;
+        continue;
+      }
+      uint32_t const ES = gem::readout::GEMVFATDecoder::eventSelector(buffer.front());
+      if (ES == m_ESexp) {
+        current = link;
+        break;
+      }
+      // the closest EC after the current one, modulo the 8 bit counter
+      uint32_t const distance = ((ES >> 12) - (m_ESexp >> 12)) & 0xff;
+      if (distance < nextDistance) {
+        nextDistance = distance;
+        next         = link;
+      }
+      backlog = std::max(backlog, buffer.size());
+    }
+
+    if (current != m_linkBuffers.end()) {
+      GEMEventMaker(m_counter, *(current->second), current->first);
+    } else if (next != m_linkBuffers.end() && (flush || !waiting || backlog >= kMERGE_BACKLOG)) {
+      // every link is past the current event, or the links that are not have fallen too far behind
+      GEMEventMaker(m_counter, *(next->second), next->first);
+    } else {
+      break;
+    }
+  }
 }
 
 uint32_t* gem::hw::glib::GLIBReadout::dumpData(uint8_t const& readout_mask)
@@ -146,51 +483,33 @@ uint32_t* gem::hw::glib::GLIBReadout::dumpData(uint8_t const& readout_mask)
 uint32_t* gem::hw::glib::GLIBReadout::getGLIBData(uint8_t const& gtx, uint32_t counter[5])
 {
   uint32_t *point = &counter[0];
-
-  DEBUG("GLIBReadout::getGLIBData Starting while loop readout "
-        << std::endl << "FIFO VFAT block depth 0x" << std::hex
-        << p_glib->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl << "FIFO depth 0x" << std::hex
-        << p_glib->getFIFOOccupancy(gtx)
-        );
-  while ( p_glib->getFIFOVFATBlockOccupancy(gtx) ) {
+  gem::utils::HwLock::AccessScope readoutAccess(gem::utils::HwLock::READOUT);
+
+  // each read also returns the occupancy left behind, so after the first poll
+  // every iteration is a single dispatch
+  uint32_t nBlocks = p_glib->getFIFOVFATBlockOccupancy(gtx);
+  DEBUG("GLIBReadout::getGLIBData Starting while loop readout, FIFO VFAT block depth 0x"
+        << std::hex << nBlocks << std::dec);
+  while (nBlocks) {
     DEBUG("GLIBReadout::getGLIBData initiating call to getTrackingData(gtx,"
-          << p_glib->getFIFOVFATBlockOccupancy(gtx) << ")");
-    std::vector<uint32_t> data = p_glib->getTrackingData(gtx, p_glib->getFIFOVFATBlockOccupancy(gtx));
-    DEBUG("GLIBReadout::getGLIBData"
-          << std::endl << "FIFO VFAT block depth 0x" << std::hex
-          << p_glib->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl << "FIFO depth 0x" << std::hex
-          << p_glib->getFIFOOccupancy(gtx)
-          );
-
-    uint32_t contqueue = 0;
-    for (auto iword = data.begin(); iword != data.end(); ++iword) {
-      contqueue++;
-      //gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
-      DEBUG(" ::getGLIBData pushing into queue 0x"
-            << std::setfill('0') << std::setw(8) << std::hex << *iword << std::dec );
-      m_dataque.push(*iword);
-      if (contqueue%kUPDATE7 == 0 &&  contqueue != 0) {
-        m_contvfats++;
-        DEBUG(" ::getGLIBData counter " << contqueue << " contvfats " << m_contvfats
-              << " m_dataque.size " << m_dataque.size());
-      }
+          << nBlocks << ")");
+    uint32_t nRead = 0, remaining = 0;
+    {
+      // the block read lands directly in the readout buffer
+      gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+      uint32_t* dest = m_dataBuffer.reserve(7*nBlocks);
+      nRead = p_glib->getTrackingData(gtx, dest, nBlocks, remaining);
+      m_dataBuffer.commit(7*nRead);
     }
-    DEBUG(" ::getGLIBData end of while loop do we go again?" << std::endl
-          << " FIFO VFAT block occupancy  0x" << std::hex << p_glib->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl
-          << " FIFO occupancy             0x" << std::hex << p_glib->getFIFOOccupancy(gtx) << std::endl
-          << " hasTrackingData            0x" << std::hex << p_glib->hasTrackingData(gtx)  << std::endl
-          );
-  }// while(p_glib->getFIFOVFATBlockOccupancy(gtx))
-  DEBUG("GLIBReadout::getGLIBData"
-        << std::endl
-        << " FIFO VFAT block occupancy  0x" << std::hex << p_glib->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl
-        << " FIFO occupancy             0x" << std::hex << p_glib->getFIFOOccupancy(gtx) << std::endl
-        << " hasTrackingData            0x" << std::hex << p_glib->hasTrackingData(gtx)  << std::endl
-        );
+    nBlocks = remaining;
+    m_contvfats += nRead;
+
+    DEBUG(" ::getGLIBData read " << nRead << " blocks, contvfats " << m_contvfats
+          << " buffer size " << m_dataBuffer.size()
+          << " FIFO VFAT block occupancy 0x" << std::hex << nBlocks << std::dec);
+    if (nRead == 0)
+      break;
+  }// while(nBlocks)
   return point;
 }
 
@@ -207,6 +526,12 @@ uint32_t* gem::hw::glib::GLIBReadout::selectData(uint32_t counter[5])
 }
 
 uint32_t* gem::hw::glib::GLIBReadout::GEMEventMaker(uint32_t counter[5])
+{
+  return GEMEventMaker(counter, m_dataBuffer, sourceTag(m_amcReaders.empty() ? 0 : m_amcReaders.front()->slot, 0));
+}
+
+uint32_t* gem::hw::glib::GLIBReadout::GEMEventMaker(uint32_t counter[5], gem::readout::GEMReadoutBuffer& buffer,
+                                                    uint32_t const& source)
 {
   uint32_t *point = &counter[0];
 
@@ -216,191 +541,126 @@ uint32_t* gem::hw::glib::GLIBReadout::GEMEventMaker(uint32_t counter[5])
 
   //int islot = -1;
 
-  // Booking FIFO variables
-  uint64_t msVFAT, lsVFAT;
   uint32_t ES;
 
   DEBUG("GLIBReadout::GEMEventMaker  " << std::hex << point );
-  if (m_dataque.empty()) return point;
-  DEBUG(" ::GEMEventMaker m_dataque.size " << m_dataque.size() );
-
-  this->readVFATblock(m_dataque);
-
-  uint64_t data1  = dat10 | dat11;
-  uint64_t data2  = dat20 | dat21;
-  uint64_t data3  = dat30 | dat31;
-  uint64_t data4  = dat40 | dat41;
+  {
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+    DEBUG(" ::GEMEventMaker buffer size " << buffer.size() );
+    if (!this->readVFATblock(buffer, vfat, source)) return point;
+  }
 
   m_vfat++;
 
-  //islot = slotInfo->GEBslotIndex( (uint32_t)chipid);
+  //islot = slotInfo->GEBslotIndex( (uint32_t)(0x0fff & vfat.ChipID));
 
   // GEM Event selector
-  ES = ( evn << 12 ) | bcn;
-  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << " evn 0x"<< evn
-        << " bcn 0x" << std::hex << bcn << std::dec << " vftas.size "
-        << m_vfats.size() << " m_erros.size " << m_erros.size()
-        << " chip ID 0x" << std::hex << (int)chipid << std::dec <<
+  ES = gem::readout::GEMVFATDecoder::eventSelector(vfat);
+  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << " EC 0x" << ((0x0ff0 & vfat.EC) >> 4)
+        << " BC 0x" << std::hex << (0x0fff & vfat.BC) << std::dec << " open events "
+        << m_eventBuilder.getOpenEvents()
+        << " chip ID 0x" << std::hex << (0x0fff & vfat.ChipID) << std::dec <<
         //" slot number " << islot <<
-        " m_isFirst " << m_isFirst << " event " << m_event);
-
-  lsVFAT = (data3 << 32) | (data4);
-  msVFAT = (data1 << 32) | (data2);
-
-  vfat.BC     = ( b1010 << 12 ) | (bcn);                // 1010     | bcn:12
-  vfat.EC     = ( b1100 << 12 ) | (evn << 4) | (flags); // 1100     | EC:8      | Flag:4
-  vfat.ChipID = ( b1110 << 12 ) | (chipid);             // 1110     | ChipID:12
-  vfat.lsData = lsVFAT;                                 // lsData:64
-  vfat.msData = msVFAT;                                 // msData:64
-  vfat.BXfrOH = BX;                                     // BXfrOH:32
-  vfat.crc    = vfatcrc;                                // crc:16
-
-  if ( ES == m_ESexp ) {
-    m_isFirst = false;
-  } else {
-    m_isFirst = true;
-
-    if ( m_vfats.size() != 0 || m_erros.size() != 0 ) {
-      DEBUG(" ::GEMEventMaker m_isFirst GEMevSelector ");
-      GEMevSelector(m_ESexp);
-    }
+        " event " << m_event);
 
-    m_event++;
-    // VFATS dimensions have limits
-    m_vfats.reserve(MaxVFATS);
-    m_erros.reserve(MaxERRS);
-    m_ESexp = ES;
-  }
-  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << std::dec << " bool " << m_isFirst );
   //if (islot < 0 || islot > 23) {
-  //  if ( int(m_erros.size()) <MaxERRS ) m_erros.push_back(vfat);
-  //  DEBUG(" ::GEMEventMaker warning !!! islot is undefined " << islot << " m_erros.size " << int(m_erros.size()) );
-  //} else {
+  //  DEBUG(" ::GEMEventMaker warning !!! islot is undefined " << islot );
+  //}
   // VFATs Pay Load
-  if ( int(m_vfats.size()) <= MaxVFATS )
-    m_vfats.push_back(vfat);
-  DEBUG(" ::GEMEventMaker m_event " << m_event << " m_vfats.size " << m_vfats.size() << std::hex << " ES 0x" << ES << std::dec );
-  //}//end of event selection
+  m_eventBuilder.add(vfat);
+  m_ESexp = ES;
 
-  m_queueDepth = m_dataque.size();
+  // write out whatever the new block completed, or pushed out of the window
+  writeClosedEvents();
+
+  m_queueDepth = buffer.size();
   p_appInfoSpace->fireItemValueRetrieve("QueueDepth");
   p_appInfoSpace->fireItemValueChanged("QueueDepth");
 
   counter[0] = m_vfat;
   counter[1] = m_event;
-  counter[2] = m_vfats.size() + m_erros.size();
-  counter[3] = m_vfats.size();
-  counter[4] = m_erros.size();
+  counter[2] = m_eventBuilder.getOpenVFATs() + m_eventBuilder.getOpenErrors();
+  counter[3] = m_eventBuilder.getOpenVFATs();
+  counter[4] = m_eventBuilder.getOpenErrors();
 
   return point;
 }
 
-void gem::hw::glib::GLIBReadout::GEMevSelector(const  uint32_t& ES)
+void gem::hw::glib::GLIBReadout::writeClosedEvents()
+{
+  gem::readout::GEMEventBuilder::Event* event = NULL;
+  while (m_eventBuilder.pop(event)) {
+    m_event++;
+    GEMevSelector(*event);
+    m_eventBuilder.recycle(event);
+  }
+}
+
+void gem::hw::glib::GLIBReadout::GEMevSelector(gem::readout::GEMEventBuilder::Event const& event)
 {
   //  GEM Event Data Format definition
   AMCGEMData  gem;
   AMCGEBData  geb;
-  AMCVFATData vfat;
 
-  DEBUG(" ::GEMEventMaker m_vfats.size " << int(m_vfats.size()) << " m_rvent " << m_rvent << " event " << m_event);
+  DEBUG(" ::GEMevSelector ES 0x" << std::hex << event.ES << std::dec << " vfats.size " << event.vfats.size()
+        << " erros.size " << event.erros.size() << " m_rvent " << m_rvent << " event " << m_event
+        << (event.timedOut ? " timed out" : ""));
 
-  uint32_t locEvent = 0;
-  uint32_t locError = 0;
   std::string TypeDataFlag = "PayLoad";
 
-  // contents all local events (one buffer, all links):
-  locEvent++;
-  uint32_t nChip = 0;
-  for (auto iVFAT=m_vfats.begin(); iVFAT != m_vfats.end(); ++iVFAT) {//try auto
-
-    uint8_t ECff = ( (0x0ff0 & (*iVFAT).EC ) >> 4);
-    uint32_t localEvent = ( ECff << 12 ) | ( 0x0fff & (*iVFAT).BC );
-
-    DEBUG(" ::GEMEventMaker vfats ES 0x" << std::hex << ( 0x00ffffff & ES) << " and from vfat 0x" <<
-          ( 0x00ffffff & localEvent ) << " EC 0x" << (int)ECff << " BC 0x" << ( 0x0fff & (*iVFAT).BC ) << std::dec );
-
-    if ( ES == localEvent ) {
-      nChip++;
-      // VFATs Pay Load
-      geb.vfats.push_back(*iVFAT);
-      //int islot = slotInfo->GEBslotIndex((uint32_t)(*iVFAT).ChipID);
-      //DEBUG(" ::GEMevSelector slot number " << islot );
-
-      if (VFATfillData(/*islot, */geb) ) {
-        if ( m_vfats.size() == nChip ) {
-
-          GEMfillHeaders(m_event, nChip, gem, geb);
-          GEMfillTrailers(gem, geb);
-          // GEM Event Writing
-          DEBUG(" ::GEMEventMaker writing...  geb.vfats.size " << int(geb.vfats.size()) );
-          TypeDataFlag = "PayLoad";
-          if(int(geb.vfats.size()) != 0) writeGEMevent(m_outFileName, false, TypeDataFlag,
-                                                       gem, geb, vfat);
-          // update online histograms
-	  //          p_gemOnlineDQM->Update(geb);
-          geb.vfats.clear();
-        }// end of writing event
-      }// if slot correct
-    }// if localEvent
-  }// end of GEB PayLoad Data
-
-  geb.vfats.clear();
-  TypeDataFlag = "Errors";
-
-  // contents all local events (one buffer, all links):
-  DEBUG(" ::GEMEventMaker END ES 0x" << std::hex << ES << std::dec << " errES " <<  m_erros.size() << " m_rvent " << m_rvent );
-
-  uint32_t nErro = 0;
-  for (auto iErr=m_erros.begin(); iErr != m_erros.end(); ++iErr) {
-
-    uint8_t ECff = ( (0x0ff0 & (*iErr).EC ) >> 4);
-    uint32_t localErr = ( ECff << 12 ) | ( 0x0fff & (*iErr).BC );
-    DEBUG(" ::GEMEventMaker ERROR vfats ES 0x" << ES << " EC " << localErr );
-
-    if( ES == localErr ) {
-      nErro++;
-      DEBUG(" ::GEMEventMaker " << " nErro " << nErro << " ES 0x" << std::hex << ES << std::dec );
-      // VFATs Errors
-      geb.vfats.push_back(*iErr);
-      if ( m_erros.size() == nErro ) {
-        // GEMDataAMCformat::printVFATdataBits(nErro, vfat);
-        //int islot = -1;
-        VFATfillData(/*islot, */geb);
-        GEMfillHeaders(m_rvent, nErro, gem, geb);
-        GEMfillTrailers(gem, geb);
-        // GEM ERRORS Event Writing
-        TypeDataFlag = "Errors";
-        if(int(geb.vfats.size()) != 0) writeGEMevent(m_errFileName, false, TypeDataFlag,
-                                                     gem, geb, vfat);
-        geb.vfats.clear();
-      }// if localErr
-    }// if localErr
-  }// end of GEB PayLoad Data
-
-  geb.vfats.clear();
+  // CRC check all blocks of the event in one go
+  if (!event.vfats.empty()) {
+    size_t nBad = m_dataChecker.checkCRC(event.vfats);
+    if (nBad > 0) {
+      m_crcMismatches = m_dataChecker.getMismatchCount();
+      DEBUG(" ::GEMevSelector " << nBad << " of " << event.vfats.size() << " VFAT blocks with a CRC mismatch"
+            << " ES 0x" << std::hex << event.ES << std::dec);
+    }
+  }
 
-  if (m_event%kUPDATE == 0 &&  m_event != 0) {
-    DEBUG(" ::GEMEventMaker m_vfats.size " << std::setfill(' ') << std::setw(7) << int(m_vfats.size()) <<
-          " m_erros.size " << std::setfill(' ') << std::setw(3) << int(m_erros.size()) <<
-          " locEvent   " << std::setfill(' ') << std::setw(6) << locEvent <<
-          " locError   " << std::setfill(' ') << std::setw(3) << locError << " event " << m_event
-          );
+  // all blocks of the event were collected by the event builder, and are written from there
+  if (!event.vfats.empty()) {
+    //int islot = slotInfo->GEBslotIndex((uint32_t)event.vfats.ChipID()[event.vfats.size()-1]);
+    //DEBUG(" ::GEMevSelector slot number " << islot );
+
+    if (VFATfillData(/*islot, */geb, event.vfats.size()) ) {
+      GEMfillHeaders(m_event, event.vfats.size(), gem, geb);
+      GEMfillTrailers(gem, geb);
+      // GEM Event Writing
+      DEBUG(" ::GEMevSelector writing...  vfats.size " << int(event.vfats.size()) );
+      writeGEMevent(*m_outWriter, false, TypeDataFlag, gem, geb, event.vfats);
+      // update online histograms
+      //          p_gemOnlineDQM->Update(geb);
+    }// if slot correct
   }
 
-  locEvent = 0;
+  if (!event.erros.empty()) {
+    // GEMDataAMCformat::printVFATdataBits(nErro, vfat);
+    //int islot = -1;
+    TypeDataFlag = "Errors";
+    VFATfillData(/*islot, */geb, event.erros.size());
+    GEMfillHeaders(m_rvent, event.erros.size(), gem, geb);
+    GEMfillTrailers(gem, geb);
+    // GEM ERRORS Event Writing
+    writeGEMevent(*m_errWriter, false, TypeDataFlag, gem, geb, event.erros);
+  }
 
-  m_vfats.clear();
-  m_erros.clear();
-  // reset event logic
-  m_isFirst = true;
+  if (m_event%kUPDATE == 0 &&  m_event != 0) {
+    DEBUG(" ::GEMevSelector vfats.size " << std::setfill(' ') << std::setw(7) << int(event.vfats.size()) <<
+          " erros.size " << std::setfill(' ') << std::setw(3) << int(event.erros.size()) <<
+          " open events " << m_eventBuilder.getOpenEvents() << " timed out " << m_eventBuilder.getTimeoutCount() <<
+          " event " << m_event
+          );
+  }
 }
 
-bool gem::hw::glib::GLIBReadout::VFATfillData(/*int const& islot, */AMCGEBData&  geb)
+bool gem::hw::glib::GLIBReadout::VFATfillData(/*int const& islot, */AMCGEBData&  geb, size_t const& nVFATs)
 {
   // Chamber Header, Zero Suppression flags, Chamber ID
+  // the ZSFlag and sumVFAT are filled in by the serializer when zero suppressing
   uint64_t ZSFlag  = 0x0;                    // :24
   uint64_t ChamID  = 0xffffffffffffffff & (0b00011111);                  // :5
-  uint64_t sumVFAT = int(3*int(geb.vfats.size()));  // :11
+  uint64_t sumVFAT = int(3*int(nVFATs));     // :11
   geb.header  = (ZSFlag << 40)|(ChamID << 35)|(sumVFAT << 23);
   ZSFlag =  (0xffffff0000000000 & geb.header) >> 40;
   ChamID =  (0x000000fff0000000 & geb.header) >> 28;
@@ -420,57 +680,19 @@ bool gem::hw::glib::GLIBReadout::VFATfillData(/*int const& islot, */AMCGEBData&
 }// end VFATfillData
 
 
-void gem::hw::glib::GLIBReadout::writeGEMevent(std::string  outFile, bool const&  OKprint,
+void gem::hw::glib::GLIBReadout::writeGEMevent(gem::readout::GEMEventWriter& outFile, bool const&  OKprint,
                                                std::string const& TypeDataFlag,
-                                               AMCGEMData&  gem, AMCGEBData&  geb, AMCVFATData& vfat)
+                                               AMCGEMData&  gem, AMCGEBData&  geb,
+                                               gem::readout::GEMVFATPayloads const& vfats)
 {
   if(OKprint) {
     DEBUG(" ::writeGEMevent m_vfat " << m_vfat << " event " << m_event << " sumVFAT " << (0x000000000fffffff & geb.header) <<
-          " geb.vfats.size " << int(geb.vfats.size()) );
-  }
-  // GEM Chamber's Data
-  if (m_outputType == "Hex") {
-    gem::readout::GEMDataAMCformat::writeGEMhd1 (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMhd2 (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMhd3 (outFile, m_event, gem);
-  } else {
-    gem::readout::GEMDataAMCformat::writeGEMhd1Binary (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMhd2Binary (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMhd3Binary (outFile, m_event, gem);
-  }
-  //  GEB Headers Data
-  if (m_outputType == "Hex") {
-    gem::readout::GEMDataAMCformat::writeGEBheader (outFile, m_event, geb);
-    gem::readout::GEMDataAMCformat::writeGEBrunhed (outFile, m_event, geb);
-  } else {
-    gem::readout::GEMDataAMCformat::writeGEBheaderBinary (outFile, m_event, geb);
-    //gem::readout::GEMDataAMCformat::writeGEBrunhedBinary (outFile, m_event, geb);
-  } // gem::readout::GEMDataAMCformat::printGEBheader (m_event, geb);
-  //  GEB PayLoad Data
-  int nChip=0;
-  for (auto iVFAT=geb.vfats.begin(); iVFAT != geb.vfats.end(); ++iVFAT) {
-    nChip++;
-
-    if (m_outputType == "Hex") {
-      gem::readout::GEMDataAMCformat::writeVFATdata (outFile, nChip, *iVFAT);
-    } else {
-      gem::readout::GEMDataAMCformat::writeVFATdataBinary (outFile, nChip, *iVFAT);
-    };
-  }//end of GEB PayLoad Data
-  //  GEB Trailers Data
-  if (m_outputType == "Hex") {
-    gem::readout::GEMDataAMCformat::writeGEBtrailer (outFile, m_event, geb);
-  } else {
-    gem::readout::GEMDataAMCformat::writeGEBtrailerBinary (outFile, m_event, geb);
-  }
-  //  GEM Trailers Data
-  if (m_outputType == "Hex") {
-    gem::readout::GEMDataAMCformat::writeGEMtr2 (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMtr1 (outFile, m_event, gem);
-  } else {
-    gem::readout::GEMDataAMCformat::writeGEMtr2Binary (outFile, m_event, gem);
-    gem::readout::GEMDataAMCformat::writeGEMtr1Binary (outFile, m_event, gem);
+          " vfats.size " << int(vfats.size()) );
   }
+  // the whole event is laid out and written in one go, in the format chosen at configure
+  if (!m_serializer.write(outFile, gem, geb, vfats))
+    WARN(" ::writeGEMevent unable to write " << TypeDataFlag << " event " << m_event
+         << " to " << outFile.getFileName());
 }
 
 void gem::hw::glib::GLIBReadout::GEMfillHeaders(uint32_t const& event, uint32_t const& DAVCount_,
@@ -572,73 +794,58 @@ void gem::hw::glib::GLIBReadout::GEMfillTrailers(AMCGEMData&  gem,AMCGEBData&  g
   DEBUG(" OHcrc 0x" << std::hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << std::dec);
 }
 
-void gem::hw::glib::GLIBReadout::readVFATblock(std::queue<uint32_t>& dataque)
-{
-  uint32_t datafront = 0;
-  for (int iQue = 0; iQue < 7; iQue++){
-    datafront = dataque.front();
-    DEBUG(" ::GEMEventMaker iQue " << iQue << " 0x"
-          << std::setfill('0') << std::setw(8) << std::hex << datafront << std::dec );
-    //this never seems to get reset? maybe iQue%7 to read the words after the first block?
-    if ((iQue%7) == 5 ) {
-      dat41   = ((0xffff0000 & datafront) >> 16 );
-      vfatcrc = (0x0000ffff & datafront);
-    } else if ( (iQue%7) == 4 ) {
-      dat40   = ((0x0000ffff & datafront) << 16 );
-      dat31   = ((0xffff0000 & datafront) >> 16 );
-    } else if ( (iQue%7) == 3 ) {
-      dat21   = ((0xffff0000 & datafront) >> 16 );
-      dat30   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 2 ) {
-      dat11   = ((0xffff0000 & datafront) >> 16 );
-      dat20   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 1 ) {
-      b1110   = ((0xf0000000 & datafront) >> 28 );
-      chipid  = ((0x0fff0000 & datafront) >> 16 );
-      dat10   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 0 ) {
-      b1010   = ((0xf0000000 & datafront) >> 28 );
-      b1100   = ((0x0000f000 & datafront) >> 12 );
-      bcn     = ((0x0fff0000 & datafront) >> 16 );
-      evn     = ((0x00000ff0 & datafront) >>  4 );
-      flags   = (0x0000000f & datafront);
-
-      if (!(b1010 == 0xa && b1100 == 0xc)) {
-        bool misAligned_ = true;
-        while ((misAligned_) && (dataque.size()>7)){
-          /* we have a misaligned word, increment misalignment counter, pop queue,
-             push bad value into some form of storage for later analysis?
-             then continue with the loop, but without incrementing iQue so we hopefully
-             eventually align again
-
-             Do not go through all the loop with condition statements
-             since iQue stays the same and we removed 7 blocks
-             -MD
-          */
-          INFO(" ::GEMEventMaker found misaligned word 0x"
-               << std::setfill('0') << std::hex << datafront << std::dec
-               << " queue m_dataque.size " << dataque.size() );
-          dataque.pop();
-          datafront = dataque.front();
-          b1010   = ((0xf0000000 & datafront) >> 28 );
-          b1100   = ((0x0000f000 & datafront) >> 12 );
-          bcn     = ((0x0fff0000 & datafront) >> 16 );
-          evn     = ((0x00000ff0 & datafront) >>  4 );
-          flags   = (0x0000000f & datafront);
-          if ((b1010 == 0xa && b1100 == 0xc)) { misAligned_ = false;}
-        }// end of while misaligned
-      }
-    } else if ( (iQue%7) == 6 ) {
-      BX      = datafront;
-    }
-    DEBUG(" ::GEMEventMaker (pre pop) m_dataque.size " << dataque.size() );
-    dataque.pop();
-    DEBUG(" ::GEMEventMaker (post pop)  m_dataque.size " << dataque.size() );
-  }// end queue
+bool gem::hw::glib::GLIBReadout::readVFATblock(gem::readout::GEMReadoutBuffer& buffer,
+                                               AMCVFATData& vfat, uint32_t const& source)
+{
+  // a block starts with the 1010 and 1100 markers followed by the 1110 marker,
+  // skip to the first one, complete or not
+  size_t skip = gem::readout::GEMVFATDecoder::findBlockStart(buffer.data(), buffer.size());
+  if (skip > 0) {
+    recordResync(source, skip);
+    buffer.consume(skip);
+  }
+
+  if (buffer.size() < 7) {
+    // the start of a block whose remaining words are still to be read stays in the buffer
+    return false;
+  }
+
+  // decode the block in place
+  gem::readout::GEMVFATDecoder::decode(buffer.data(), vfat);
+
+  buffer.consume(7);
+  return true;
 }
 
 
 
+void gem::hw::glib::GLIBReadout::recordResync(uint32_t const& source, size_t const& nSkipped)
+{
+  m_resyncCount  = m_resyncCount.value_ + 1;
+  m_skippedWords = m_skippedWords.value_ + nSkipped;
+
+  size_t link = (source >> 8)*HwGLIB::N_GTX + (source & 0xff);
+  if (link < m_resyncCountPerLink.size()) {
+    m_resyncCountPerLink[link]  = m_resyncCountPerLink[link].value_ + 1;
+    m_skippedWordsPerLink[link] = m_skippedWordsPerLink[link].value_ + nSkipped;
+  }
+  DEBUG("GLIBReadout::readVFATblock skipped " << nSkipped << " misaligned words on slot "
+        << (source >> 8) << " gtx " << (source & 0xff));
+}
+
+void gem::hw::glib::GLIBReadout::reportCRCMismatches()
+{
+  if (m_dataChecker.getMismatchCount() == 0)
+    return;
+
+  std::stringstream chips;
+  for (unsigned chipID = 0; chipID < gem::datachecker::GEMDataChecker::kN_CHIPIDS; ++chipID)
+    if (m_dataChecker.getMismatchCount(chipID) > 0)
+      chips << " 0x" << std::hex << chipID << std::dec << ":" << m_dataChecker.getMismatchCount(chipID);
+  WARN("GLIBReadout " << m_dataChecker.getMismatchCount() << " of " << m_dataChecker.getCheckedCount()
+       << " VFAT blocks had a CRC mismatch, per chip" << chips.str());
+}
+
 void gem::hw::glib::GLIBReadout::ScanRoutines(uint8_t latency, uint8_t VT1, uint8_t VT2)
 {
   m_latency = latency;
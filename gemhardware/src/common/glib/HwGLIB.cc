@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iomanip>
 
 #include "gem/hw/glib/HwGLIB.h"
@@ -433,9 +434,9 @@ std::string gem::hw::glib::HwGLIB::getUserFirmwareDate()
 
 bool gem::hw::glib::HwGLIB::linkCheck(uint8_t const& gtx, std::string const& opMsg)
 {
-  if (gtx > N_GTX) {
+  if (gtx >= N_GTX) {
     std::string msg = toolbox::toString("%s requested for gtx (%d): outside expectation (0-%d)",
-                                        opMsg.c_str(), gtx, N_GTX);
+                                        opMsg.c_str(), gtx, N_GTX-1);
     ERROR(msg);
     // XCEPT_RAISE(gem::hw::glib::exception::InvalidLink,msg);
     return false;
@@ -586,10 +587,8 @@ uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& gtx, uint32_t* da
 
   std::stringstream regName;
   regName << getDeviceBaseNode() << ".TRK_DATA.OptoHybrid_" << (int)gtx << ".FIFO";
-  // best way to read a real block? make getTrackingData ask for N blocks?
-  // can we return the memory another way, rather than a vector?
-  // readBlock(regName.str(),7*nBlocks);
-  return nBlocks;
+  // only complete VFAT blocks are returned to the caller
+  return readBlock(regName.str(), data, 7*nBlocks)/7;
 }
 
 uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& gtx, std::vector<toolbox::mem::Reference*>& data,
@@ -601,10 +600,138 @@ uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& gtx, std::vector<
 
   std::stringstream regName;
   regName << getDeviceBaseNode() << ".TRK_DATA.OptoHybrid_" << (int)gtx << ".FIFO";
-  // best way to read a real block? make getTrackingData ask for N blocks?
-  // can we return the memory another way, rather than a vector?
-  // readBlock(regName.str(),7*nBlocks);
-  return nBlocks;
+  // only whole VFAT blocks go into a frame, so that no block is split across two frames
+  uint32_t nRead = 0;
+  for (auto frame = data.begin(); frame != data.end() && nRead < nBlocks; ++frame) {
+    if (*frame == NULL)
+      continue;
+    size_t used   = (*frame)->getDataOffset() + (*frame)->getDataSize();
+    size_t space  = ((*frame)->getBuffer()->getSize() - used)/(7*sizeof(uint32_t));
+    size_t toRead = std::min(space, nBlocks - nRead);
+    if (toRead == 0)
+      continue;
+    uint32_t* dest = reinterpret_cast<uint32_t*>(static_cast<char*>((*frame)->getDataLocation())
+                                                 + (*frame)->getDataSize());
+    uint32_t got = readBlock(regName.str(), dest, 7*toRead)/7;
+    (*frame)->setDataSize((*frame)->getDataSize() + 7*got*sizeof(uint32_t));
+    nRead += got;
+    if (got < toRead)
+      break;
+  }
+  return nRead;
+}
+
+uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& gtx, uint32_t* data, size_t const& nBlocks,
+                                                uint32_t& remaining)
+{
+  remaining = 0;
+  if (data==NULL && nBlocks > 0) {
+    std::string msg = toolbox::toString("Block read requested for null pointer");
+    ERROR(msg);
+    XCEPT_RAISE(gem::hw::glib::exception::NULLReadoutPointer,msg);
+  } else if (!linkCheck(gtx, "Tracking data")) {
+    return 0;
+  }
+
+  std::stringstream regName;
+  regName << getDeviceBaseNode() << ".TRK_DATA.OptoHybrid_" << (int)gtx;
+  block_chunk_list chunks;
+  chunks.push_back(std::make_pair(data, 7*nBlocks));
+  uint32_t depth = 0;
+  uint32_t nRead = readBlockAndReg(regName.str()+".FIFO", chunks, regName.str()+".DEPTH", depth);
+  // the depth is in 32 bit words
+  remaining = depth/7;
+  return nRead/7;
+}
+
+uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& gtx, std::vector<toolbox::mem::Reference*>& data,
+                                                size_t const& nBlocks, uint32_t& remaining)
+{
+  remaining = 0;
+  if (!linkCheck(gtx, "Tracking data")) {
+    return 0;
+  }
+
+  block_chunk_list chunks;
+  std::vector<toolbox::mem::Reference*> filled;
+  frameChunks(data, nBlocks, chunks, filled);
+
+  std::stringstream regName;
+  regName << getDeviceBaseNode() << ".TRK_DATA.OptoHybrid_" << (int)gtx;
+  uint32_t depth = 0;
+  uint32_t nWords = readBlockAndReg(regName.str()+".FIFO", chunks, regName.str()+".DEPTH", depth);
+  remaining = depth/7;
+
+  // the read either succeeds completely or not at all
+  if (nWords == 0)
+    return 0;
+  auto chunk = chunks.begin();
+  for (auto frame = filled.begin(); frame != filled.end(); ++frame, ++chunk)
+    (*frame)->setDataSize((*frame)->getDataSize() + chunk->second*sizeof(uint32_t));
+  return nWords/7;
+}
+
+uint32_t gem::hw::glib::HwGLIB::getTrackingData(uint32_t const& gtxMask,
+                                                std::vector<std::vector<toolbox::mem::Reference*> >& data,
+                                                std::vector<uint32_t> const& nBlocks,
+                                                std::vector<uint32_t>& remaining)
+{
+  std::vector<block_chunk_list> chunks(N_GTX);
+  std::vector<std::vector<toolbox::mem::Reference*> > filled(N_GTX);
+  std::vector<GEMHwDevice::Batch::Handle> depths(N_GTX);
+
+  // the reads of every link are queued before the single dispatch
+  GEMHwDevice::Batch batch(*this);
+  for (uint8_t gtx = 0; gtx < N_GTX; ++gtx) {
+    if (!((gtxMask >> gtx) & 0x1) || !linkCheck(gtx, "Tracking data"))
+      continue;
+    if (gtx < data.size() && gtx < nBlocks.size())
+      frameChunks(data.at(gtx), nBlocks.at(gtx), chunks.at(gtx), filled.at(gtx));
+
+    std::stringstream regName;
+    regName << getDeviceBaseNode() << ".TRK_DATA.OptoHybrid_" << (int)gtx;
+    batch.readBlock(regName.str()+".FIFO", chunks.at(gtx));
+    depths.at(gtx) = batch.read(regName.str()+".DEPTH");
+  }
+
+  // the read either succeeds completely or not at all
+  bool const committed = batch.commit();
+  uint32_t nRead = 0;
+  for (uint8_t gtx = 0; gtx < N_GTX && gtx < remaining.size(); ++gtx) {
+    if (!((gtxMask >> gtx) & 0x1) || !isLinkActive(gtx))
+      continue;
+    // the depth is in 32 bit words
+    remaining.at(gtx) = depths.at(gtx).value()/7;
+    if (!committed)
+      continue;
+    auto chunk = chunks.at(gtx).begin();
+    for (auto frame = filled.at(gtx).begin(); frame != filled.at(gtx).end(); ++frame, ++chunk) {
+      (*frame)->setDataSize((*frame)->getDataSize() + chunk->second*sizeof(uint32_t));
+      nRead += chunk->second/7;
+    }
+  }
+  return nRead;
+}
+
+void gem::hw::glib::HwGLIB::frameChunks(std::vector<toolbox::mem::Reference*> const& data, size_t const& nBlocks,
+                                        block_chunk_list& chunks, std::vector<toolbox::mem::Reference*>& filled)
+{
+  // one chunk per frame, only whole VFAT blocks go into a frame
+  size_t nQueued = 0;
+  for (auto frame = data.begin(); frame != data.end() && nQueued < nBlocks; ++frame) {
+    if (*frame == NULL)
+      continue;
+    size_t used   = (*frame)->getDataOffset() + (*frame)->getDataSize();
+    size_t space  = ((*frame)->getBuffer()->getSize() - used)/(7*sizeof(uint32_t));
+    size_t toRead = std::min(space, nBlocks - nQueued);
+    if (toRead == 0)
+      continue;
+    uint32_t* dest = reinterpret_cast<uint32_t*>(static_cast<char*>((*frame)->getDataLocation())
+                                                 + (*frame)->getDataSize());
+    chunks.push_back(std::make_pair(dest, 7*toRead));
+    filled.push_back(*frame);
+    nQueued += toRead;
+  }
 }
 
 void gem::hw::glib::HwGLIB::flushFIFO(uint8_t const& gtx)
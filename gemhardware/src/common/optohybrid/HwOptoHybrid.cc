@@ -171,20 +171,27 @@ gem::hw::GEMHwDevice::OpticalLinkStatus gem::hw::optohybrid::HwOptoHybrid::LinkS
 {
   gem::hw::GEMHwDevice::OpticalLinkStatus linkStatus;
 
-  linkStatus.TRK_Errors   = readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.TRK_ERR"));
-  linkStatus.TRG_Errors   = readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.TRG_ERR"));
-  linkStatus.Data_Packets = readReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.DATA_Packets"));
+  Batch batch(*this);
+  Batch::Handle trkErrors   = batch.read(getDeviceBaseNode(),"COUNTERS.GTX.TRK_ERR");
+  Batch::Handle trgErrors   = batch.read(getDeviceBaseNode(),"COUNTERS.GTX.TRG_ERR");
+  Batch::Handle dataPackets = batch.read(getDeviceBaseNode(),"COUNTERS.GTX.DATA_Packets");
+  batch.commit();
+  linkStatus.TRK_Errors   = trkErrors.value();
+  linkStatus.TRG_Errors   = trgErrors.value();
+  linkStatus.Data_Packets = dataPackets.value();
   return linkStatus;
 }
 
 void gem::hw::optohybrid::HwOptoHybrid::LinkReset(uint8_t const& resets)
 {
+  Batch batch(*this);
   if (resets&0x1)
-    writeReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.TRK_ERR.Reset"),0x1);
+    batch.write(getDeviceBaseNode(),"COUNTERS.GTX.TRK_ERR.Reset",0x1);
   if (resets&0x2)
-    writeReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.TRG_ERR.Reset"),0x1);
+    batch.write(getDeviceBaseNode(),"COUNTERS.GTX.TRG_ERR.Reset",0x1);
   if (resets&0x4)
-    writeReg(getDeviceBaseNode(),toolbox::toString("COUNTERS.GTX.DATA_Packets.Reset"),0x1);
+    batch.write(getDeviceBaseNode(),"COUNTERS.GTX.DATA_Packets.Reset",0x1);
+  batch.commit();
 }
 
 //uint32_t gem::hw::optohybrid::HwOptoHybrid::readTriggerData() {
@@ -195,28 +202,40 @@ void gem::hw::optohybrid::HwOptoHybrid::updateWBMasterCounters()
 {
   std::stringstream regName;
   regName << "COUNTERS.WB.MASTER";
-  m_wbMasterCounters.GTX.first     = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.GTX"   );
-  m_wbMasterCounters.GTX.second    = readReg(getDeviceBaseNode(),regName.str() + ".Ack.GTX"      );
-  m_wbMasterCounters.ExtI2C.first  = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C");
-  m_wbMasterCounters.ExtI2C.second = readReg(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C"   );
-  m_wbMasterCounters.Scan.first    = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.Scan"  );
-  m_wbMasterCounters.Scan.second   = readReg(getDeviceBaseNode(),regName.str() + ".Ack.Scan"     );
-  m_wbMasterCounters.DAC.first     = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.DAC"   );
-  m_wbMasterCounters.DAC.second    = readReg(getDeviceBaseNode(),regName.str() + ".Ack.DAC"      );
+  Batch batch(*this);
+  Batch::Handle gtxStrobe    = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.GTX"   );
+  Batch::Handle gtxAck       = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.GTX"      );
+  Batch::Handle extI2CStrobe = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C");
+  Batch::Handle extI2CAck    = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C"   );
+  Batch::Handle scanStrobe   = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.Scan"  );
+  Batch::Handle scanAck      = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.Scan"     );
+  Batch::Handle dacStrobe    = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.DAC"   );
+  Batch::Handle dacAck       = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.DAC"      );
+  batch.commit();
+  m_wbMasterCounters.GTX.first     = gtxStrobe.value();
+  m_wbMasterCounters.GTX.second    = gtxAck.value();
+  m_wbMasterCounters.ExtI2C.first  = extI2CStrobe.value();
+  m_wbMasterCounters.ExtI2C.second = extI2CAck.value();
+  m_wbMasterCounters.Scan.first    = scanStrobe.value();
+  m_wbMasterCounters.Scan.second   = scanAck.value();
+  m_wbMasterCounters.DAC.first     = dacStrobe.value();
+  m_wbMasterCounters.DAC.second    = dacAck.value();
 }
 
 void gem::hw::optohybrid::HwOptoHybrid::resetWBMasterCounters()
 {
   std::stringstream regName;
   regName << "COUNTERS.WB.MASTER";
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.GTX.Reset",   0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.GTX.Reset",      0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C.Reset",0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C.Reset",   0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.Scan.Reset",  0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.Scan.Reset",     0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.DAC.Reset",   0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.DAC.Reset",      0x1);
+  Batch batch(*this);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.GTX.Reset",   0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.GTX.Reset",      0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C.Reset",0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C.Reset",   0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.Scan.Reset",  0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.Scan.Reset",     0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.DAC.Reset",   0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.DAC.Reset",      0x1);
+  batch.commit();
   m_wbMasterCounters.reset();
 }
 
@@ -224,59 +243,147 @@ void gem::hw::optohybrid::HwOptoHybrid::updateWBSlaveCounters()
 {
   std::stringstream regName;
   regName << "COUNTERS.WB.SLAVE";
-  for (unsigned i2c = 0; i2c < 6; ++i2c) {
-    m_wbSlaveCounters.I2C.at(i2c).first     = readReg(getDeviceBaseNode(),
-                                                      regName.str() +
-                                                      toolbox::toString(".Strobe.I2C%d.Reset",i2c));
-    m_wbSlaveCounters.I2C.at(i2c).second    = readReg(getDeviceBaseNode(),
-                                                      regName.str() +
-                                                      toolbox::toString(".Ack.I2C%d.Reset",i2c)   );
+  Batch batch(*this);
+  std::vector<std::pair<Batch::Handle, Batch::Handle> > i2c(6);
+  for (unsigned i = 0; i < i2c.size(); ++i) {
+    i2c.at(i).first  = batch.read(getDeviceBaseNode(),
+                                  regName.str() + toolbox::toString(".Strobe.I2C%d.Reset",i));
+    i2c.at(i).second = batch.read(getDeviceBaseNode(),
+                                  regName.str() + toolbox::toString(".Ack.I2C%d.Reset",i)   );
+  }
+  Batch::Handle extI2CStrobe   = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C"  );
+  Batch::Handle extI2CAck      = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C"     );
+  Batch::Handle scanStrobe     = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.Scan"    );
+  Batch::Handle scanAck        = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.Scan"       );
+  Batch::Handle t1Strobe       = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.T1"      );
+  Batch::Handle t1Ack          = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.T1"         );
+  Batch::Handle dacStrobe      = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.DAC"     );
+  Batch::Handle dacAck         = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.DAC"        );
+  Batch::Handle adcStrobe      = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.ADC"     );
+  Batch::Handle adcAck         = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.ADC"        );
+  Batch::Handle clockingStrobe = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.Clocking");
+  Batch::Handle clockingAck    = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.Clocking"   );
+  Batch::Handle countersStrobe = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.Counters");
+  Batch::Handle countersAck    = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.Counters"   );
+  Batch::Handle systemStrobe   = batch.read(getDeviceBaseNode(),regName.str() + ".Strobe.System"  );
+  Batch::Handle systemAck      = batch.read(getDeviceBaseNode(),regName.str() + ".Ack.System"     );
+  batch.commit();
+  for (unsigned i = 0; i < i2c.size(); ++i) {
+    m_wbSlaveCounters.I2C.at(i).first  = i2c.at(i).first.value();
+    m_wbSlaveCounters.I2C.at(i).second = i2c.at(i).second.value();
   }
-  m_wbSlaveCounters.ExtI2C.first    = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C"  );
-  m_wbSlaveCounters.ExtI2C.second   = readReg(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C"     );
-  m_wbSlaveCounters.Scan.first      = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.Scan"    );
-  m_wbSlaveCounters.Scan.second     = readReg(getDeviceBaseNode(),regName.str() + ".Ack.Scan"       );
-  m_wbSlaveCounters.T1.first        = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.T1"      );
-  m_wbSlaveCounters.T1.second       = readReg(getDeviceBaseNode(),regName.str() + ".Ack.T1"         );
-  m_wbSlaveCounters.DAC.first       = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.DAC"     );
-  m_wbSlaveCounters.DAC.second      = readReg(getDeviceBaseNode(),regName.str() + ".Ack.DAC"        );
-  m_wbSlaveCounters.ADC.first       = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.ADC"     );
-  m_wbSlaveCounters.ADC.second      = readReg(getDeviceBaseNode(),regName.str() + ".Ack.ADC"        );
-  m_wbSlaveCounters.Clocking.first  = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.Clocking");
-  m_wbSlaveCounters.Clocking.second = readReg(getDeviceBaseNode(),regName.str() + ".Ack.Clocking"   );
-  m_wbSlaveCounters.Counters.first  = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.Counters");
-  m_wbSlaveCounters.Counters.second = readReg(getDeviceBaseNode(),regName.str() + ".Ack.Counters"   );
-  m_wbSlaveCounters.System.first    = readReg(getDeviceBaseNode(),regName.str() + ".Strobe.System"  );
-  m_wbSlaveCounters.System.second   = readReg(getDeviceBaseNode(),regName.str() + ".Ack.System"     );
+  m_wbSlaveCounters.ExtI2C.first    = extI2CStrobe.value();
+  m_wbSlaveCounters.ExtI2C.second   = extI2CAck.value();
+  m_wbSlaveCounters.Scan.first      = scanStrobe.value();
+  m_wbSlaveCounters.Scan.second     = scanAck.value();
+  m_wbSlaveCounters.T1.first        = t1Strobe.value();
+  m_wbSlaveCounters.T1.second       = t1Ack.value();
+  m_wbSlaveCounters.DAC.first       = dacStrobe.value();
+  m_wbSlaveCounters.DAC.second      = dacAck.value();
+  m_wbSlaveCounters.ADC.first       = adcStrobe.value();
+  m_wbSlaveCounters.ADC.second      = adcAck.value();
+  m_wbSlaveCounters.Clocking.first  = clockingStrobe.value();
+  m_wbSlaveCounters.Clocking.second = clockingAck.value();
+  m_wbSlaveCounters.Counters.first  = countersStrobe.value();
+  m_wbSlaveCounters.Counters.second = countersAck.value();
+  m_wbSlaveCounters.System.first    = systemStrobe.value();
+  m_wbSlaveCounters.System.second   = systemAck.value();
 }
 
 void gem::hw::optohybrid::HwOptoHybrid::resetWBSlaveCounters()
 {
   std::stringstream regName;
   regName << "COUNTERS.WB.SLAVE";
+  Batch batch(*this);
   for (unsigned i2c = 0; i2c < 6; ++i2c) {
-    writeReg(getDeviceBaseNode(),regName.str() + toolbox::toString(".Strobe.GTX%d.Reset",i2c),0x1);
-    writeReg(getDeviceBaseNode(),regName.str() + toolbox::toString(".Ack.GTX%d.Reset",   i2c),0x1);
+    batch.write(getDeviceBaseNode(),regName.str() + toolbox::toString(".Strobe.GTX%d.Reset",i2c),0x1);
+    batch.write(getDeviceBaseNode(),regName.str() + toolbox::toString(".Ack.GTX%d.Reset",   i2c),0x1);
   }
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C.Reset",  0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C.Reset",     0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.Scan.Reset",    0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.Scan.Reset",       0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.T1.Reset",      0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.T1.Reset",         0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.DAC.Reset",     0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.DAC.Reset",        0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.ADC.Reset",     0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.ADC.Reset",        0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.Clocking.Reset",0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.Clocking.Reset",   0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.Counters.Reset",0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.Counters.Reset",   0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Strobe.System.Reset",  0x1);
-  writeReg(getDeviceBaseNode(),regName.str() + ".Ack.System.Reset",     0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.ExtI2C.Reset",  0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.ExtI2C.Reset",     0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.Scan.Reset",    0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.Scan.Reset",       0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.T1.Reset",      0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.T1.Reset",         0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.DAC.Reset",     0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.DAC.Reset",        0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.ADC.Reset",     0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.ADC.Reset",        0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.Clocking.Reset",0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.Clocking.Reset",   0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.Counters.Reset",0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.Counters.Reset",   0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Strobe.System.Reset",  0x1);
+  batch.write(getDeviceBaseNode(),regName.str() + ".Ack.System.Reset",     0x1);
+  batch.commit();
   m_wbSlaveCounters.reset();
 }
 
+std::pair<uint32_t,uint32_t> gem::hw::optohybrid::HwOptoHybrid::getVFATCRCCount(uint8_t const& chip)
+{
+  if (chip > 23) {
+    ERROR("HwOptoHybrid::No CRC counters for VFAT" << (int)chip);
+    return std::make_pair(0,0);
+  }
+
+  RegisterHandle const* valid     = NULL;
+  RegisterHandle const* incorrect = NULL;
+  {
+    // the lock only guards the cache, the commit takes it for each attempt
+    gem::utils::LockGuard<gem::utils::HwLock> guardedLock(*p_hwLock);
+    if (m_vfatCRCRegs.empty())
+      m_vfatCRCRegs.assign(2*24, NULL);
+    RegisterHandle const*& cachedValid     = m_vfatCRCRegs.at(2*chip);
+    RegisterHandle const*& cachedIncorrect = m_vfatCRCRegs.at(2*chip+1);
+    try {
+      if (cachedValid == NULL)
+        cachedValid     = &getRegisterHandle(getDeviceBaseNode(),toolbox::toString("COUNTERS.CRC.VALID.VFAT%d",    chip));
+      if (cachedIncorrect == NULL)
+        cachedIncorrect = &getRegisterHandle(getDeviceBaseNode(),toolbox::toString("COUNTERS.CRC.INCORRECT.VFAT%d",chip));
+    } catch (uhal::exception::exception const& err) {
+      ERROR("HwOptoHybrid::Unable to find the CRC counters of VFAT" << (int)chip << ": " << err.what());
+      return std::make_pair(0,0);
+    }
+    valid     = cachedValid;
+    incorrect = cachedIncorrect;
+  }
+
+  Batch batch(*this);
+  Batch::Handle validCount     = batch.read(*valid);
+  Batch::Handle incorrectCount = batch.read(*incorrect);
+  batch.commit();
+  return std::make_pair(validCount.value(),incorrectCount.value());
+}
+
+gem::hw::GEMHwDevice::RegisterHandle const& gem::hw::optohybrid::HwOptoHybrid::getT1CountRegister(uint8_t const& signal,
+                                                                                                  uint8_t const& mode)
+{
+  static const RegisterHandle noRegister;
+  static const char* signals[] = {"L1A", "CalPulse", "Resync", "BC0"};
+  static const char* sources[] = {"TTC", "INTERNAL", "EXTERNAL", "LOOPBACK", "SENT"};
+  if (signal > 0x3) {
+    ERROR("HwOptoHybrid::No T1 counter for signal " << (int)signal);
+    return noRegister;
+  }
+
+  // all unknown modes read the counters of the T1 signals sent along the GEB
+  unsigned const source = mode > 4 ? 4 : mode;
+  gem::utils::LockGuard<gem::utils::HwLock> guardedLock(*p_hwLock);
+  if (m_t1CountRegs.empty())
+    m_t1CountRegs.assign(4*5, NULL);
+  RegisterHandle const*& reg = m_t1CountRegs.at(4*source+signal);
+  if (reg == NULL) {
+    try {
+      reg = &getRegisterHandle(getDeviceBaseNode(),
+                               toolbox::toString("COUNTERS.T1.%s.%s", sources[source], signals[signal]));
+    } catch (uhal::exception::exception const& err) {
+      ERROR("HwOptoHybrid::Unable to find the T1 counter: " << err.what());
+      return noRegister;
+    }
+  }
+  return *reg;
+}
+
 
 void gem::hw::optohybrid::HwOptoHybrid::updateT1Counters()
 {
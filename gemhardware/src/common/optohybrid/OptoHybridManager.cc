@@ -8,6 +8,7 @@
 
 #include "gem/hw/optohybrid/OptoHybridManager.h"
 
+#include "gem/hw/GEMHwDispatcher.h"
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
 #include "gem/hw/optohybrid/OptoHybridMonitor.h"
 #include "gem/hw/optohybrid/OptoHybridManagerWeb.h"
@@ -349,6 +350,13 @@ void gem::hw::optohybrid::OptoHybridManager::initializeAction()
       }
     }
   }
+
+  // one thread per OptoHybrid, so that all of them can be configured at the same time
+  unsigned nOptoHybrids = 0;
+  for (unsigned index = 0; index < MAX_AMCS_PER_CRATE*MAX_OPTOHYBRIDS_PER_AMC; ++index)
+    if (m_optohybridInfo[index].bag.present)
+      ++nOptoHybrids;
+  p_dispatcher = std::make_shared<gem::hw::GEMHwDispatcher>("OptoHybridManager", nOptoHybrids);
   DEBUG("OptoHybridManager::initializeAction end");
 }
 
@@ -358,6 +366,8 @@ void gem::hw::optohybrid::OptoHybridManager::configureAction()
   DEBUG("OptoHybridManager::configureAction");
   //std::ofstream of
 
+  // the OptoHybrids are configured concurrently, each by its own dispatcher thread
+  std::vector<gem::hw::GEMHwDispatcher::request_ptr> requests;
   std::map<int,std::set<int> > hwMapping;
   //will the manager operate for all connected optohybrids, or only those connected to certain GLIBs?
   for (unsigned slot = 0; slot < MAX_AMCS_PER_CRATE; ++slot) {
@@ -377,111 +387,133 @@ void gem::hw::optohybrid::OptoHybridManager::configureAction()
 
       if (optohybrid->isHwConnected()) {
         hwMapping[slot+1].insert(link);
-
-        DEBUG("OptoHybridManager::configureAction::setting trigger source to 0x"
-             << std::hex << info.triggerSource.value_ << std::dec);
-        optohybrid->setTrigSource(info.triggerSource.value_);
-
-        // DEBUG("OptoHybridManager::configureAction::setting sbit source to 0x"
-        //      << std::hex << info.sbitSource.value_ << std::dec);
-        // optohybrid->setSBitSource(info.sbitSource.value_);
-        DEBUG("OptoHybridManager::setting reference clock source to 0x"
-             << std::hex << info.refClkSrc.value_ << std::dec);
-        optohybrid->setReferenceClock(info.refClkSrc.value_);
-
-        /*
-        DEBUG("OptoHybridManager::setting vfat clock source to 0x" << std::hex << info.vfatClkSrc.value_ << std::dec);
-        optohybrid->setVFATClock(info.vfatClkSrc.value_,);
-        DEBUG("OptoHybridManager::setting cdce clock source to 0x" << std::hex << info.cdceClkSrc.value_ << std::dec);
-        optohybrid->setSBitSource(info.cdceClkSrc.value_);
-        */
-        /*
-        for (unsigned olink = 0; olink < HwGLIB::N_GTX; ++olink) {
-        }
-        */
-
-        DEBUG("OptoHybridManager::configureAction Setting output s-bit configuration parameters");
-        optohybrid->setSBitMode(info.sbitConfig.bag.Mode.value_);
-
-        std::array<uint8_t, 6> sbitSources = {{
-            static_cast<uint8_t>(info.sbitConfig.bag.Output0Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output1Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output2Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output3Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output4Src.value_ & 0x1f),
-            static_cast<uint8_t>(info.sbitConfig.bag.Output5Src.value_ & 0x1f),
-          }};
-
-        optohybrid->setHDMISBitSource(sbitSources);
-
-        std::vector<std::pair<uint8_t,uint32_t> > chipIDs = optohybrid->getConnectedVFATs();
-
-        for (auto chip = chipIDs.begin(); chip != chipIDs.end(); ++chip)
-          if (chip->second)
-            INFO("VFAT found in GEB slot " << std::setw(2) << (int)chip->first << " has ChipID "
-                 << "0x" << std::hex << std::setw(4) << chip->second << std::dec);
-          else
-            INFO("No VFAT found in GEB slot " << std::setw(2) << (int)chip->first);
-
-        uint32_t vfatMask = m_broadcastList.at(slot).at(link);
-        INFO("Setting VFAT parameters with broadcast write using mask " << std::hex << vfatMask << std::dec);
-
-	if (m_scanType.value_ == 2) {
-	  INFO("OptoHybridManager::configureAction configureAction: FIRST Latency  " << m_scanMin.value_);
-	  optohybrid->setVFATsToDefaults(info.commonVFATSettings.bag.VThreshold1.value_,
-                                         info.commonVFATSettings.bag.VThreshold2.value_,
-                                         m_scanMin.value_, vfatMask);
-          // HACK
-          // have to enable the pulse to the channel if using cal pulse latency scan
-          // but shouldn't mess with other settings... not possible here, so just a hack
-          optohybrid->broadcastWrite("VFATChannels.ChanReg23",  0x40, vfatMask);
-          optohybrid->broadcastWrite("VFATChannels.ChanReg124", 0x40, vfatMask);
-          optohybrid->broadcastWrite("VFATChannels.ChanReg65",  0x40, vfatMask);
-          optohybrid->broadcastWrite("VCal",                    0xaf, vfatMask);
-	} else if (m_scanType.value_ == 3) {
-	  uint32_t initialVT1 = m_scanMin.value_;
-	  //	  uint32_t VT1 = (m_scanMax.value_ - m_scanMin.value_);
-	  uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
-	  INFO("OptoHybridManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
-	  optohybrid->setVFATsToDefaults( initialVT1, initialVT2, info.commonVFATSettings.bag.Latency.value_, vfatMask);
-	} else {
-	  optohybrid->setVFATsToDefaults(info.commonVFATSettings.bag.VThreshold1.value_,
-					 info.commonVFATSettings.bag.VThreshold2.value_,
-					 info.commonVFATSettings.bag.Latency.value_,
-					 vfatMask);
-	}
-
-	std::array<std::string, 11> setupregs = {{"ContReg0", "ContReg2", "IPreampIn", "IPreampFeed", "IPreampOut",
-						  "IShaper", "IShaperFeed", "IComp", "Latency",
-						  "VThreshold1", "VThreshold2"}};
-
-        INFO("Reading back values after setting defaults:");
-        for (auto reg = setupregs.begin(); reg != setupregs.end(); ++reg) {
-          std::vector<uint32_t> res = optohybrid->broadcastRead(*reg,vfatMask);
-          INFO(*reg);
-          for (auto r = res.begin(); r != res.end(); ++r) {
-            INFO(" 0x" << std::hex << std::setw(8) << std::setfill('0') << *r << std::dec);
-          }
-        }
-        //what else is required for configuring the OptoHybrid?
-        //need to reset optical links?
-        //reset counters?
-        uint32_t gtxMask = optohybrid->readReg("GLIB.DAQ.CONTROL.INPUT_ENABLE_MASK");
-        gtxMask |= (0x1<<link);
-        optohybrid->writeReg("GLIB.DAQ.CONTROL.INPUT_ENABLE_MASK", gtxMask);
+        requests.push_back(p_dispatcher->submit(*optohybrid,
+                                                std::make_shared<gem::hw::GEMHwDispatcher::MemberJob<OptoHybridManager> >(
+                                                  this, &OptoHybridManager::configureOptoHybrid, index)));
       } else {
         ERROR("configureAction::OptoHybrid connected on link " << (int)link << " to GLIB in slot " << (int)(slot+1)
               << " is not responding");
         //fireEvent("Fail");
+        // the OptoHybrids already being configured are waited for, as their jobs refer to this application
+        p_dispatcher->waitAll(requests);
         XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, "configureAction failed");
         //maybe raise exception so as to not continue with other cards?
       }
     }
   }
 
+  if (!p_dispatcher->waitAll(requests))
+    XCEPT_RAISE(gem::hw::optohybrid::exception::Exception, "configureAction failed");
+
+  // the links of one GLIB share its input mask, so it is updated once per GLIB, after all of them
+  for (auto glib = hwMapping.begin(); glib != hwMapping.end(); ++glib) {
+    optohybrid_shared_ptr optohybrid = m_optohybrids.at(glib->first-1).at(*(glib->second.begin()));
+    uint32_t gtxMask = optohybrid->readReg("GLIB.DAQ.CONTROL.INPUT_ENABLE_MASK");
+    for (auto link = glib->second.begin(); link != glib->second.end(); ++link)
+      gtxMask |= (0x1<<(*link));
+    optohybrid->writeReg("GLIB.DAQ.CONTROL.INPUT_ENABLE_MASK", gtxMask);
+  }
+
   DEBUG("OptoHybridManager::configureAction end");
 }
 
+void gem::hw::optohybrid::OptoHybridManager::configureOptoHybrid(unsigned const& index)
+{
+  unsigned const slot = index/MAX_OPTOHYBRIDS_PER_AMC;
+  unsigned const link = index%MAX_OPTOHYBRIDS_PER_AMC;
+  OptoHybridInfo& info = m_optohybridInfo[index].bag;
+  optohybrid_shared_ptr optohybrid = m_optohybrids.at(slot).at(link);
+
+  DEBUG("OptoHybridManager::configureAction::setting trigger source to 0x"
+        << std::hex << info.triggerSource.value_ << std::dec);
+  optohybrid->setTrigSource(info.triggerSource.value_);
+
+  // DEBUG("OptoHybridManager::configureAction::setting sbit source to 0x"
+  //      << std::hex << info.sbitSource.value_ << std::dec);
+  // optohybrid->setSBitSource(info.sbitSource.value_);
+  DEBUG("OptoHybridManager::setting reference clock source to 0x"
+        << std::hex << info.refClkSrc.value_ << std::dec);
+  optohybrid->setReferenceClock(info.refClkSrc.value_);
+
+  /*
+  DEBUG("OptoHybridManager::setting vfat clock source to 0x" << std::hex << info.vfatClkSrc.value_ << std::dec);
+  optohybrid->setVFATClock(info.vfatClkSrc.value_,);
+  DEBUG("OptoHybridManager::setting cdce clock source to 0x" << std::hex << info.cdceClkSrc.value_ << std::dec);
+  optohybrid->setSBitSource(info.cdceClkSrc.value_);
+  */
+  /*
+  for (unsigned olink = 0; olink < HwGLIB::N_GTX; ++olink) {
+  }
+  */
+
+  DEBUG("OptoHybridManager::configureAction Setting output s-bit configuration parameters");
+  optohybrid->setSBitMode(info.sbitConfig.bag.Mode.value_);
+
+  std::array<uint8_t, 6> sbitSources = {{
+      static_cast<uint8_t>(info.sbitConfig.bag.Output0Src.value_ & 0x1f),
+      static_cast<uint8_t>(info.sbitConfig.bag.Output1Src.value_ & 0x1f),
+      static_cast<uint8_t>(info.sbitConfig.bag.Output2Src.value_ & 0x1f),
+      static_cast<uint8_t>(info.sbitConfig.bag.Output3Src.value_ & 0x1f),
+      static_cast<uint8_t>(info.sbitConfig.bag.Output4Src.value_ & 0x1f),
+      static_cast<uint8_t>(info.sbitConfig.bag.Output5Src.value_ & 0x1f),
+    }};
+
+  optohybrid->setHDMISBitSource(sbitSources);
+
+  std::vector<std::pair<uint8_t,uint32_t> > chipIDs = optohybrid->getConnectedVFATs();
+
+  for (auto chip = chipIDs.begin(); chip != chipIDs.end(); ++chip)
+    if (chip->second)
+      INFO("VFAT found in GEB slot " << std::setw(2) << (int)chip->first << " has ChipID "
+           << "0x" << std::hex << std::setw(4) << chip->second << std::dec);
+    else
+      INFO("No VFAT found in GEB slot " << std::setw(2) << (int)chip->first);
+
+  uint32_t vfatMask = m_broadcastList.at(slot).at(link);
+  INFO("Setting VFAT parameters with broadcast write using mask " << std::hex << vfatMask << std::dec);
+
+  if (m_scanType.value_ == 2) {
+    INFO("OptoHybridManager::configureAction configureAction: FIRST Latency  " << m_scanMin.value_);
+    optohybrid->setVFATsToDefaults(info.commonVFATSettings.bag.VThreshold1.value_,
+                                   info.commonVFATSettings.bag.VThreshold2.value_,
+                                   m_scanMin.value_, vfatMask);
+    // HACK
+    // have to enable the pulse to the channel if using cal pulse latency scan
+    // but shouldn't mess with other settings... not possible here, so just a hack
+    optohybrid->broadcastWrite("VFATChannels.ChanReg23",  0x40, vfatMask);
+    optohybrid->broadcastWrite("VFATChannels.ChanReg124", 0x40, vfatMask);
+    optohybrid->broadcastWrite("VFATChannels.ChanReg65",  0x40, vfatMask);
+    optohybrid->broadcastWrite("VCal",                    0xaf, vfatMask);
+  } else if (m_scanType.value_ == 3) {
+    uint32_t initialVT1 = m_scanMin.value_;
+    //	  uint32_t VT1 = (m_scanMax.value_ - m_scanMin.value_);
+    uint32_t initialVT2 = 0; //std::max(0,(uint32_t)m_scanMax.value_);
+    INFO("OptoHybridManager::configureAction FIRST VT1 " << initialVT1 << " VT2 " << initialVT2);
+    optohybrid->setVFATsToDefaults( initialVT1, initialVT2, info.commonVFATSettings.bag.Latency.value_, vfatMask);
+  } else {
+    optohybrid->setVFATsToDefaults(info.commonVFATSettings.bag.VThreshold1.value_,
+                                   info.commonVFATSettings.bag.VThreshold2.value_,
+                                   info.commonVFATSettings.bag.Latency.value_,
+                                   vfatMask);
+  }
+
+  std::array<std::string, 11> setupregs = {{"ContReg0", "ContReg2", "IPreampIn", "IPreampFeed", "IPreampOut",
+                                             "IShaper", "IShaperFeed", "IComp", "Latency",
+                                             "VThreshold1", "VThreshold2"}};
+
+  INFO("Reading back values after setting defaults:");
+  for (auto reg = setupregs.begin(); reg != setupregs.end(); ++reg) {
+    std::vector<uint32_t> res = optohybrid->broadcastRead(*reg,vfatMask);
+    INFO(*reg);
+    for (auto r = res.begin(); r != res.end(); ++r) {
+      INFO(" 0x" << std::hex << std::setw(8) << std::setfill('0') << *r << std::dec);
+    }
+  }
+  //what else is required for configuring the OptoHybrid?
+  //need to reset optical links?
+  //reset counters?
+}
+
 void gem::hw::optohybrid::OptoHybridManager::startAction()
   throw (gem::hw::optohybrid::exception::Exception)
 {
@@ -820,6 +852,30 @@ void gem::hw::optohybrid::OptoHybridManager::createOptoHybridInfoSpaceItems(is_t
         is_optohybrid->createUInt32((*scan)+(*scanreg), optohybrid->getFirmware(), NULL, GEMUpdateType::HW32);
     }
   }
+
+  // contention of the lock serializing the access to the device, times in microseconds
+  is_optohybrid->createUInt64("LOCK_ACQUIRED",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_SHARED",       0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_CONTENDED",    0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_WAIT_READOUT", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_WAIT_CONTROL", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_WAIT_MONITOR", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_MAX_WAIT",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_HOLD",         0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("LOCK_MAX_HOLD",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+
+  // retries of the failed transactions, and whether the device is still accessed
+  is_optohybrid->createUInt32("DEVICE_HEALTHY",     1, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("RETRY_TRANSACTIONS", 0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("RETRY_RETRIED",      0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("RETRY_FAILED",       0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  is_optohybrid->createUInt64("RETRY_REJECTED",     0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  for (unsigned errClass = 0; errClass < gem::hw::GEMHwRetryPolicy::kN_ERROR_CLASSES; ++errClass)
+    is_optohybrid->createUInt64("RETRY_ERR_"+gem::hw::GEMHwRetryPolicy::errorClassName(errClass),
+                                0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
+  for (unsigned bin = 0; bin < gem::hw::GEMHwRetryPolicy::kN_LATENCY_BINS; ++bin)
+    is_optohybrid->createUInt64("RETRY_LATENCY_"+gem::hw::GEMHwRetryPolicy::latencyBinLabel(bin),
+                                0, NULL, GEMUpdateType::NOUPDATE, "docstring", "dec");
 }
 
 
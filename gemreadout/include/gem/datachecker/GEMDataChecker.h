@@ -4,12 +4,16 @@
 #define GEM_DATACHECKER_GEMDATACHECKER_H
 
 //#include "gem/utils/GEMLogging.h"
+#include <cstddef>
 #include <stdint.h>
 #include <boost/utility/binary.hpp>
 #include <bitset>
 #include <sstream>
 #include <vector>
 
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMVFATPayloads.h"
+
 namespace gem {
 //  namespace readout {
 //    struct VFATData;
@@ -19,11 +23,16 @@ namespace gem {
   namespace datachecker {
     class GEMDataChecker {
       public:
+        static const unsigned kN_CHIPIDS = 4096;  ///< 12 bit ChipID space
 
-        GEMDataChecker(){}
+        GEMDataChecker() { resetCounters(); }
         ~GEMDataChecker() {};
 
-        uint16_t checkCRC(uint16_t dataVFAT[11], bool OKprint)
+        /**
+         * Bitwise reference calculation of the VFAT CRC
+         * @param dataVFAT the 11 words covered by the CRC, fed from dataVFAT[11] down to dataVFAT[1]
+         */
+        uint16_t checkCRC(uint16_t dataVFAT[12], bool OKprint)
         {
           uint16_t crc_fin = 0xffff;
           for (int i = 11; i >= 1; i--)
@@ -33,6 +42,48 @@ namespace gem {
           return(crc_fin);
         }
 
+        /**
+         * Table driven calculation of the VFAT CRC of a raw block, as read from the tracking data FIFO
+         * @param block pointer to the 7 words of the block, the CRC covers everything from the
+         *        BC word up to the last data word
+         */
+        static uint16_t vfatCRC(uint32_t const* block);
+
+        /**
+         * Table driven calculation of the VFAT CRC of a decoded block
+         */
+        static uint16_t vfatCRC(gem::readout::GEMDataAMCformat::VFATData const& vfat) {
+          return vfatCRC(vfat.BC, vfat.EC, vfat.ChipID, vfat.msData, vfat.lsData); };
+
+        /**
+         * Table driven calculation of the VFAT CRC from the fields of a decoded block
+         */
+        static uint16_t vfatCRC(uint16_t const& BC, uint16_t const& EC, uint16_t const& ChipID,
+                                uint64_t const& msData, uint64_t const& lsData);
+
+        /**
+         * Verify the CRC of consecutive decoded blocks, counting the mismatches per ChipID
+         * @param vfats pointer to the first block
+         * @param nVFATs number of blocks to check
+         * @param crcOK if not NULL, set to true or false for each block
+         * @returns the number of blocks with a CRC mismatch
+         */
+        size_t checkCRC(gem::readout::GEMDataAMCformat::VFATData const* vfats, size_t const& nVFATs,
+                        bool* crcOK=NULL);
+
+        /**
+         * Verify the CRC of all blocks of an event, counting the mismatches per ChipID
+         * @param crcOK if not NULL, set to true or false for each block
+         * @returns the number of blocks with a CRC mismatch
+         */
+        size_t checkCRC(gem::readout::GEMVFATPayloads const& vfats, bool* crcOK=NULL);
+
+        void resetCounters();
+
+        uint64_t getCheckedCount()  const { return m_checked; };
+        uint64_t getMismatchCount() const { return m_mismatches; };
+        uint32_t getMismatchCount(uint16_t const& chipID) const { return m_chipMismatches[chipID & 0x0fff]; };
+
       private:
 
         uint16_t crc_calc(uint16_t crc_in, uint16_t dato)
@@ -52,8 +103,68 @@ namespace gem {
           }
           return(crc_temp);
         }
+
+        /**
+         * Feed two 16 bit words at once, the first one in the low half of the argument
+         */
+        static uint16_t crcStep32(uint16_t const& crc, uint32_t const& words) {
+          uint32_t const x = crc ^ words;
+          return s_crcTable[3][x & 0xff] ^ s_crcTable[2][(x >> 8) & 0xff]
+            ^ s_crcTable[1][(x >> 16) & 0xff] ^ s_crcTable[0][x >> 24]; };
+
+        /**
+         * Feed a single 16 bit word
+         */
+        static uint16_t crcStep16(uint16_t const& crc, uint16_t const& word) {
+          uint16_t const x = crc ^ word;
+          return s_crcTable[1][x & 0xff] ^ s_crcTable[0][x >> 8]; };
+
+        /**
+         * The FIFO words hold the CRC words high half first, swap them into feeding order
+         */
+        static uint32_t swapHalves(uint32_t const& word) {
+          return (word >> 16) | (word << 16); };
+
+        /**
+         * s_crcTable[n][i] is the CRC register after feeding the byte i followed by n zero bytes
+         * (slice-by-4 for the reflected polynomial 0x8408, LSB first like crc_calc)
+         */
+        static uint16_t s_crcTable[4][256];
+        static bool     s_crcTableFilled;
+        static bool     fillCRCTable();
+
+        uint64_t m_checked;
+        uint64_t m_mismatches;
+        uint32_t m_chipMismatches[kN_CHIPIDS];
       };
    }  // namespace gem::datachecker
 }  // namespace gem
 
+inline uint16_t gem::datachecker::GEMDataChecker::vfatCRC(uint32_t const* block)
+{
+  // 11 words: BC, EC, ChipID and the 128 data bits, i.e. everything before the CRC field
+  uint16_t crc = 0xffff;
+  crc = crcStep32(crc, swapHalves(block[0]));
+  crc = crcStep32(crc, swapHalves(block[1]));
+  crc = crcStep32(crc, swapHalves(block[2]));
+  crc = crcStep32(crc, swapHalves(block[3]));
+  crc = crcStep32(crc, swapHalves(block[4]));
+  return crcStep16(crc, block[5] >> 16);
+}
+
+inline uint16_t gem::datachecker::GEMDataChecker::vfatCRC(uint16_t const& BC, uint16_t const& EC,
+                                                         uint16_t const& ChipID,
+                                                         uint64_t const& msData, uint64_t const& lsData)
+{
+  // rebuild the FIFO words the block was decoded from
+  uint32_t block[6];
+  block[0] = (static_cast<uint32_t>(BC) << 16) | EC;
+  block[1] = (static_cast<uint32_t>(ChipID) << 16) | static_cast<uint32_t>(msData >> 48);
+  block[2] = static_cast<uint32_t>(msData >> 16);
+  block[3] = static_cast<uint32_t>(msData << 16) | static_cast<uint32_t>(lsData >> 48);
+  block[4] = static_cast<uint32_t>(lsData >> 16);
+  block[5] = static_cast<uint32_t>(lsData << 16);
+  return vfatCRC(block);
+}
+
 #endif  // GEM_DATACHECKER_GEMDATACHECKER_H
@@ -3,6 +3,7 @@
 #ifndef GEM_READOUT_GEMDATAAMCFORMAT_H
 #define GEM_READOUT_GEMDATAAMCFORMAT_H
 
+#include <cstdio>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -10,10 +11,13 @@
 #include <vector>
 
 #include "gem/readout/GEMslotContents.h"
+#include "gem/readout/GEMHexCodec.h"
 
 namespace gem {
   namespace readout {
 
+    class GEMEventWriter;
+
     struct GEMDataAMCformat {
       struct VFATData {
         uint16_t BC;          // 1010:4,   BC:12
@@ -48,29 +52,9 @@ namespace gem {
        * GEM Data
        */
 
-      static bool writeGEMhd1(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << gem.header1 << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd1(GEMEventWriter& outf, int event, const GEMData& gem);
 
-      static bool writeGEMhd1Binary(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if (event < 0) return false;
-        if (!outf.is_open()) return false;
-        uint64_t cdfHeader = 0x5fffffffffffffff;
-        uint64_t amc13Header1 = 0xff1ffffffffffff0;
-        uint64_t amc13Header2 = 0xffffffffffffffff;
-        outf.write( (char*)&cdfHeader, sizeof(cdfHeader));
-        outf.write( (char*)&amc13Header1, sizeof(amc13Header1));
-        outf.write( (char*)&amc13Header2, sizeof(amc13Header2));
-        outf.write( (char*)&gem.header1, sizeof(gem.header1));
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd1Binary(GEMEventWriter& outf, int event, const GEMData& gem);
 
       static bool readGEMhd1Binary(std::ifstream& inpf, const GEMData& gem) {
         inpf.read( (char*)&gem.header1, sizeof(gem.header1));
@@ -80,28 +64,14 @@ namespace gem {
       };
 
       static bool readGEMhd1(std::ifstream& inpf, GEMData& gem) {
-        inpf >> std::hex >> gem.header1;
+        GEMHexCodec::read(inpf, gem.header1);
         if(inpf.eof()) return false;
         return true;
       };
 
-      static bool writeGEMhd2(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << gem.header2 << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd2(GEMEventWriter& outf, int event, const GEMData& gem);
 
-      static bool writeGEMhd2Binary(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&gem.header2, sizeof(gem.header2));
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd2Binary(GEMEventWriter& outf, int event, const GEMData& gem);
 
       static bool readGEMhd2Binary(std::ifstream& inpf, const GEMData& gem) {
         inpf.read( (char*)&gem.header2, sizeof(gem.header2));
@@ -111,28 +81,14 @@ namespace gem {
       };
 
       static bool readGEMhd2(std::ifstream& inpf, GEMData& gem) {
-        inpf >> std::hex >> gem.header2;
+        GEMHexCodec::read(inpf, gem.header2);
         if(inpf.eof()) return false;
         return true;
       };
 
-      static bool writeGEMhd3(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << gem.header3 << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd3(GEMEventWriter& outf, int event, const GEMData& gem);
 
-      static bool writeGEMhd3Binary(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&gem.header3, sizeof(gem.header3));
-        outf.close();
-        return true;
-      };
+      static bool writeGEMhd3Binary(GEMEventWriter& outf, int event, const GEMData& gem);
 
       static bool readGEMhd3Binary(std::ifstream& inpf, const GEMData& gem) {
         inpf.read( (char*)&gem.header3, sizeof(gem.header3));
@@ -142,7 +98,7 @@ namespace gem {
       };
 
       static bool readGEMhd3(std::ifstream& inpf, GEMData& gem) {
-        inpf >> std::hex >> gem.header3;
+        GEMHexCodec::read(inpf, gem.header3);
         if(inpf.eof()) return false;
         return true;
       };
@@ -151,23 +107,9 @@ namespace gem {
        * GEB Data (One GEB board, 24 VFATs)
        */
 
-      static bool writeGEBheader(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << geb.header << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEBheader(GEMEventWriter& outf, int event, const GEBData& geb);
 
-      static bool writeGEBheaderBinary(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&geb.header, sizeof(geb.header));
-        outf.close();
-        return true;
-      };
+      static bool writeGEBheaderBinary(GEMEventWriter& outf, int event, const GEBData& geb);
 
       static bool readGEBheaderBinary(std::ifstream& inpf, const GEBData& geb) {
         inpf.read( (char*)&geb.header, sizeof(geb.header));
@@ -177,7 +119,7 @@ namespace gem {
       };
 
       static bool readGEBheader(std::ifstream& inpf, GEBData& geb) {
-        inpf >> std::hex >> geb.header;
+        GEMHexCodec::read(inpf, geb.header);
         if(inpf.eof()) return false;
         return true;
       };
@@ -190,23 +132,9 @@ namespace gem {
         return true;
       };
 
-      static bool writeGEBrunhed(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << geb.runhed << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEBrunhed(GEMEventWriter& outf, int event, const GEBData& geb);
 
-      static bool writeGEBrunhedBinary(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&geb.runhed, sizeof(geb.runhed));
-        outf.close();
-        return true;
-      };
+      static bool writeGEBrunhedBinary(GEMEventWriter& outf, int event, const GEBData& geb);
 
       static bool readGEBrunhedBinary(std::ifstream& inpf, const GEBData& geb) {
         inpf.read( (char*)&geb.runhed, sizeof(geb.runhed));
@@ -216,28 +144,14 @@ namespace gem {
       };
 
       static bool readGEBrunhed(std::ifstream& inpf, GEBData& geb) {
-        inpf >> std::hex >> geb.runhed;
+        GEMHexCodec::read(inpf, geb.runhed);
         if(inpf.eof()) return false;
         return true;
       };
 
-      static bool writeGEBtrailer(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << geb.trailer << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEBtrailer(GEMEventWriter& outf, int event, const GEBData& geb);
 
-      static bool writeGEBtrailerBinary(std::string file, int event, const GEBData& geb) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&geb.trailer, sizeof(geb.trailer));
-        outf.close();
-        return true;
-      };
+      static bool writeGEBtrailerBinary(GEMEventWriter& outf, int event, const GEBData& geb);
 
       static bool readGEBtrailerBinary(std::ifstream& inpf, const GEBData& geb) {
         inpf.read( (char*)&geb.trailer, sizeof(geb.trailer));
@@ -247,7 +161,7 @@ namespace gem {
       };
 
       static bool readGEBtrailer(std::ifstream& inpf, GEBData& geb) {
-        inpf >> std::hex >> geb.trailer;
+        GEMHexCodec::read(inpf, geb.trailer);
         if(inpf.eof()) return false;
         return true;
       };
@@ -262,23 +176,9 @@ namespace gem {
         return true;
       };
 
-      static bool writeGEMtr2(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << gem.trailer2 << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEMtr2(GEMEventWriter& outf, int event, const GEMData& gem);
 
-      static bool writeGEMtr2Binary(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf.write( (char*)&gem.trailer2, sizeof(gem.trailer2));
-        outf.close();
-        return true;
-      };
+      static bool writeGEMtr2Binary(GEMEventWriter& outf, int event, const GEMData& gem);
 
       static bool readGEMtr2Binary(std::ifstream& inpf, const GEMData& gem) {
         inpf.read( (char*)&gem.trailer2, sizeof(gem.trailer2));
@@ -288,32 +188,14 @@ namespace gem {
       };
 
       static bool readGEMtr2(std::ifstream& inpf, GEMData& gem) {
-        inpf >> std::hex >> gem.trailer2;
+        GEMHexCodec::read(inpf, gem.trailer2);
         if(inpf.eof()) return false;
         return true;
       };
 
-      static bool writeGEMtr1(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        outf << std::hex << std::setw(16) << std::setfill('0') << gem.trailer1 << std::dec << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeGEMtr1(GEMEventWriter& outf, int event, const GEMData& gem);
 
-      static bool writeGEMtr1Binary(std::string file, int event, const GEMData& gem) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        uint64_t amc13Trailer = 0xbadc0ffeebadcafe;
-        uint64_t cdfTrailer = 0xafffffffffffffff;
-        outf.write( (char*)&gem.trailer1, sizeof(gem.trailer1));
-        outf.write( (char*)&amc13Trailer, sizeof(amc13Trailer));
-        outf.write( (char*)&cdfTrailer, sizeof(cdfTrailer));
-        outf.close();
-        return true;
-      };
+      static bool writeGEMtr1Binary(GEMEventWriter& outf, int event, const GEMData& gem);
 
       static bool readGEMtr1Binary(std::ifstream& inpf, const GEMData& gem) {
         inpf.read( (char*)&gem.trailer1, sizeof(gem.trailer1));
@@ -323,28 +205,12 @@ namespace gem {
       };
 
       static bool readGEMtr1(std::ifstream& inpf, GEMData& gem) {
-        inpf >> std::hex >> gem.trailer1;
+        GEMHexCodec::read(inpf, gem.trailer1);
         if(inpf.eof()) return false;
         return true;
       };
 
-      static bool writeVFATdata(std::string file, int event, const VFATData& vfat) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        // have to have 64 bit word lengths
-        outf << std::hex << std::setw(16) << std::setfill('0')
-             << ((((((uint64_t)vfat.BC<<16)+vfat.EC)<<16)+vfat.ChipID)<<16)+(vfat.msData>>48) << std::endl;
-        outf << std::hex << std::setw(16) << std::setfill('0')
-             << (((vfat.msData&0x0000ffffffffffff)<<16)+(vfat.lsData>>48)) << std::endl;
-        outf << std::hex << std::setw(16) << std::setfill('0')
-             << (((vfat.lsData&0x0000ffffffffffff)<<16)+vfat.crc)          << std::endl;
-        outf << std::hex << std::setw(16) << std::setfill('0')
-             << vfat.BXfrOH << std::dec << std::endl;
-        //writeZEROline(file);
-        outf.close();
-        return true;
-      };
+      static bool writeVFATdata(GEMEventWriter& outf, int event, const VFATData& vfat);
 
       static bool printVFATdata(int event, const VFATData& vfat) {
         if ( event<0) return false;
@@ -359,32 +225,7 @@ namespace gem {
         return true;
       };
 
-      static bool writeVFATdataBinary(std::string file, int event, const VFATData& vfat) {
-        std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
-        if ( event<0) return false;
-        if (!outf.is_open()) return false;
-        uint64_t w1;
-        uint64_t w2;
-        uint64_t w3;
-        uint64_t bc = vfat.BC;
-        uint64_t ec = vfat.EC;
-        uint64_t ci = vfat.ChipID;
-        w1 = 0xffffffffffffffff & ((bc <<48) | (ec << 32) | (ci << 16) | (vfat.msData >> 48));
-        w2 = 0xffffffffffffffff & ((vfat.msData <<16) | (vfat.lsData >> 48));
-        w3 = 0xffffffffffffffff & ((vfat.lsData <<16) | (vfat.crc ));
-        outf.write( (char*)&w1,     sizeof(w1));
-        outf.write( (char*)&w2,     sizeof(w2));
-        outf.write( (char*)&w3,     sizeof(w3));
-        //outf.write( (char*)&vfat.BC,     sizeof(vfat.BC));
-        //outf.write( (char*)&vfat.EC,     sizeof(vfat.EC));
-        //outf.write( (char*)&vfat.ChipID, sizeof(vfat.ChipID));
-        //outf.write( (char*)&vfat.msData, sizeof(vfat.msData));
-        //outf.write( (char*)&vfat.lsData, sizeof(vfat.lsData));
-        //outf.write( (char*)&vfat.crc,    sizeof(vfat.crc));
-        //outf.write( (char*)&vfat.BXfrOH, sizeof(vfat.BXfrOH));
-        outf.close();
-        return true;
-      };
+      static bool writeVFATdataBinary(GEMEventWriter& outf, int event, const VFATData& vfat);
 
       static bool readVFATdataBinary(std::ifstream& inpf, int event, VFATData& vfat) {
         if (event<0) return false;
@@ -402,15 +243,19 @@ namespace gem {
 
       static bool readVFATdata(std::ifstream& inpf, int event, VFATData& vfat) {
         if (event<0) return false;
-        uint16_t msTmpUp, lsTmpUp;
-        uint16_t msTmpMid, lsTmpMid;
-        uint32_t msTmpLow, lsTmpLow;
-        inpf >> std::hex >> vfat.BC  >> vfat.EC >> vfat.ChipID >> msTmpUp;
-        inpf >> std::hex >> msTmpMid >> msTmpLow >> lsTmpUp;
-        inpf >> std::hex >> lsTmpMid >> lsTmpLow >> vfat.crc;
-        inpf >> std::hex >> vfat.BXfrOH;
-        vfat.msData = ((((uint64_t)msTmpUp<<16)+msTmpMid)<<32)+msTmpLow;
-        vfat.lsData = ((((uint64_t)lsTmpUp<<16)+lsTmpMid)<<32)+lsTmpLow;
+        // the four lines of writeVFATdata
+        uint64_t w1 = 0, w2 = 0, w3 = 0, bx = 0;
+        GEMHexCodec::read(inpf, w1);
+        GEMHexCodec::read(inpf, w2);
+        GEMHexCodec::read(inpf, w3);
+        GEMHexCodec::read(inpf, bx);
+        vfat.BC     = w1 >> 48;
+        vfat.EC     = w1 >> 32;
+        vfat.ChipID = w1 >> 16;
+        vfat.msData = (w1 << 48) | (w2 >> 16);
+        vfat.lsData = (w2 << 48) | (w3 >> 16);
+        vfat.crc    = w3;
+        vfat.BXfrOH = bx;
         if(inpf.eof()) return false;
         return true;
       };
@@ -418,44 +263,37 @@ namespace gem {
       //
       // Useful printouts
       //
+      /**
+       * Print the lowest nBits bits of x, most significant first, in a single write
+       */
+      static void showBits(uint64_t x, int nBits, bool newline) {
+        char bits[66];
+        for (int i = 0; i < nBits; ++i)
+          bits[i] = '0' + ((x >> (nBits-1-i)) & 0x1);
+        int len = nBits;
+        if (newline)
+          bits[len++] = '\n';
+        fwrite(bits, 1, len, stdout);
+      }
+
       static void show4bits(uint8_t x) {
-        int i;
-        const unsigned long unit = 1;
-        for(i=(sizeof(uint8_t)*4)-1; i>=0; i--)
-          (x & ((unit)<<i))?putchar('1'):putchar('0');
-        //printf("\n");
+        showBits(x, 4, false);
       }
 
       static void show16bits(uint16_t x) {
-        int i;
-        const unsigned long unit = 1;
-        for(i=(sizeof(uint16_t)*8)-1; i>=0; i--)
-          (x & ((unit)<<i))?putchar('1'):putchar('0');
-        printf("\n");
+        showBits(x, 16, true);
       }
 
       static void show24bits(uint32_t x) {
-        int i;
-        const unsigned long unit = 1;
-        for(i=(sizeof(uint32_t)*8)-8-1; i>=0; i--)
-          (x & ((unit)<<i))?putchar('1'):putchar('0');
-        printf("\n");
+        showBits(x, 24, true);
       }
 
       static void show32bits(uint32_t x) {
-        int i;
-        const unsigned long unit = 1;
-        for(i=(sizeof(uint32_t)*8)-1; i>=0; i--)
-          (x & ((unit)<<i))?putchar('1'):putchar('0');
-        printf("\n");
+        showBits(x, 32, true);
       }
 
       static void show64bits(uint64_t x) {
-        int i;
-        const unsigned long unit = 1;
-        for(i=(sizeof(uint64_t)*8)-1; i>=0; i--)
-          (x & ((unit)<<i))?putchar('1'):putchar('0');
-        printf("\n");
+        showBits(x, 64, true);
       }
 
       static bool printVFATdataBits(int event, const VFATData& vfat) {
@@ -489,13 +327,7 @@ namespace gem {
         return true;
       };
 
-      static bool writeZEROline(std::string file) {
-        std::ofstream outf(file.c_str(), std::ios_base::app );
-        if (!outf.is_open()) return false;
-        outf << "\n" << std::endl;
-        outf.close();
-        return true;
-      };
+      static bool writeZEROline(GEMEventWriter& outf);
     };  // struct GEMDataAMCformat
   }  // namespace gem::readout
   typedef gem::readout::GEMDataAMCformat::GEMData  AMCGEMData;
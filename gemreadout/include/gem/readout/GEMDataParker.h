@@ -4,7 +4,6 @@
 #define GEM_READOUT_GEMDATAPARKER_H
 
 #include <string>
-#include <queue>
 
 #include "i2o/i2o.h"
 #include "toolbox/Task.h"
@@ -21,6 +20,11 @@
 #include "gem/utils/LockGuard.h"
 
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMEventBuilder.h"
+#include "gem/readout/GEMEventSerializer.h"
+#include "gem/readout/GEMEventWriter.h"
+#include "gem/readout/GEMReadoutBuffer.h"
+#include "gem/datachecker/GEMDataChecker.h"
 
 namespace gem {
   namespace hw {
@@ -57,7 +61,7 @@ namespace gem {
                             std::string const& slotFileName="slot_table.csv",
                             GEMRunType  const& runType=DATA
                             );
-      ~GEMDataParker() {};
+      ~GEMDataParker();
 
       uint32_t* dumpData   ( uint8_t const& mask );
       uint32_t* selectData ( uint32_t counter[5]
@@ -67,7 +71,11 @@ namespace gem {
                            );
       uint32_t* GEMEventMaker( uint32_t counter[5]
                              );
-      void GEMevSelector   ( const  uint32_t& ES
+      /**
+       * Write out the events closed by the event builder, in the order they were opened
+       */
+      void writeClosedEvents();
+      void GEMevSelector   ( GEMEventBuilder::Event const& event
                            );
       void GEMfillHeaders  ( uint32_t const& BC,
                              uint32_t const& BX,
@@ -75,19 +83,33 @@ namespace gem {
                              gem::readout::GEMDataAMCformat::GEBData& geb
                            );
       bool VFATfillData    ( int const& islot,
-                             gem::readout::GEMDataAMCformat::GEBData& geb
+                             gem::readout::GEMDataAMCformat::GEBData& geb,
+                             size_t const& nVFATs
                            );
       void GEMfillTrailers ( gem::readout::GEMDataAMCformat::GEMData& gem,
                              gem::readout::GEMDataAMCformat::GEBData& geb
                            );
-      void writeGEMevent   ( std::string outFile,
+      void writeGEMevent   ( GEMEventWriter& outFile,
                              bool const& OKprint,
                              std::string const& TypeDataFlag,
                              gem::readout::GEMDataAMCformat::GEMData& gem,
                              gem::readout::GEMDataAMCformat::GEBData& geb,
-                             gem::readout::GEMDataAMCformat::VFATData& vfat
+                             GEMVFATPayloads const& vfats
                            );
-      int queueDepth       () {return m_dataque.size();}
+      int queueDepth       () {return m_dataBuffer.size();}
+
+      /**
+       * Write out all buffered data to the output files, e.g., at the end of a run
+       */
+      void flush           ();
+
+      /**
+       * @param window number of events built at the same time, to collect out of order blocks
+       * @param timeoutMsec write out an event this long after its first block, 0 for no timeout
+       */
+      void configureEventBuilder(size_t const& window, uint32_t const& timeoutMsec) {
+        m_eventBuilder.setWindow(window);
+        m_eventBuilder.setTimeout(timeoutMsec); };
 
 
       void ScanRoutines(uint8_t latency, uint8_t VT1, uint8_t VT2);
@@ -101,6 +123,17 @@ namespace gem {
       xoap::MessageReference updateScanParameters(xoap::MessageReference message)
         throw (xoap::exception::Exception);
 
+      /**
+       * CRC mismatch counters of the blocks read so far
+       */
+      gem::datachecker::GEMDataChecker const& getDataChecker() const { return m_dataChecker; };
+
+      /**
+       * Drop the VFAT blocks without hits from the events written, see GEMEventSerializer
+       */
+      void setZeroSuppression(bool const& suppress, unsigned const& sparseMaxStrips=0) {
+        m_serializer.setZeroSuppression(suppress, sparseMaxStrips); };
+
 
     private:
       // moved from globals...
@@ -108,20 +141,19 @@ namespace gem {
       bool     m_isFirst;
       //uint64_t m_ZSFlag;
       uint32_t m_contvfats;
+      int      m_rvent;
 
-      void readVFATblock(std::queue<uint32_t>& dataque);
+      // the events being built, keyed by event selector
+      GEMEventBuilder m_eventBuilder;
 
-      uint32_t dat10,dat11, dat20,dat21, dat30,dat31, dat40,dat41;
-      uint32_t BX;
-      uint16_t bcn, evn, chipid, vfatcrc;
-      uint16_t b1010, b1100, b1110;
-      uint8_t  flags;
+      /**
+       * Decode the next complete VFAT block from the buffer, skipping any misaligned words
+       * @returns false if the buffer does not contain a complete block
+       */
+      bool readVFATblock(gem::readout::GEMReadoutBuffer& buffer, AMCVFATData& vfat);
 
       uint8_t m_latency, m_VT1, m_VT2;
 
-      static const int MaxVFATS = 24; // was 32 ???
-      static const int MaxERRS  = 4095; // should this also be 24? Or we can accomodate full GLIB FIFO of bad blocks belonging to the same event?
-
       std::unique_ptr<GEMslotContents> slotInfo;
 
       log4cplus::Logger m_gemLogger;
@@ -130,11 +162,19 @@ namespace gem {
       std::string m_slotFileName;
       std::string m_errFileName;
       std::string m_outputType;
+      GEMEventSerializer m_serializer;  ///< lays out the events in the output type
+
+      // output files, kept open for the lifetime of the parker
+      std::unique_ptr<GEMEventWriter> m_outWriter;
+      std::unique_ptr<GEMEventWriter> m_errWriter;
 
       // queue safety
       mutable gem::utils::Lock m_queueLock;
-      // The main data flow
-      std::queue<uint32_t> m_dataque;
+      // The main data flow, raw FIFO words waiting to be built into events
+      gem::readout::GEMReadoutBuffer m_dataBuffer;
+
+      // CRC of every VFAT block, checked once per built event
+      gem::datachecker::GEMDataChecker m_dataChecker;
 
       //type of run
       GEMRunType m_runType;
@@ -0,0 +1,131 @@
+/** @file GEMEventBuilder.h */
+
+#ifndef GEM_READOUT_GEMEVENTBUILDER_H
+#define GEM_READOUT_GEMEVENTBUILDER_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/unordered_map.hpp>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMVFATPayloads.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMEventBuilder
+     * @brief Collects the VFAT blocks of the events being built, keyed by their event selector
+     *
+     * Each block goes to the open event with the same (EC << 12) | BC event
+     * selector, found with a single hash lookup, so the blocks of an event are
+     * never searched for again when the event is written out. Up to window
+     * events are kept open at the same time, so blocks arriving out of order
+     * among those of other events still end up in the right event.
+     *
+     * An event is closed when it has the expected number of blocks, when a new
+     * event would exceed the window (the oldest open event is closed), when it
+     * has been open for longer than the timeout, or on flush. Closed events are
+     * handed out in the order they were opened, and their storage is reused.
+     *
+     * With a window of 1 an event is closed as soon as a block of another event
+     * is seen, which is how the events were built before.
+     */
+    class GEMEventBuilder
+    {
+    public:
+      static const size_t kDEFAULT_MAX_VFATS = 24;    ///< blocks kept for an event, one per GEB slot
+      static const size_t kDEFAULT_MAX_ERRS  = 4095;  ///< blocks of unknown chips kept for an event
+
+      struct Event {
+        uint32_t ES;        ///< (EC << 12) | BC event selector
+        uint64_t openUsec;  ///< time the first block was added
+        bool     closed;
+        bool     timedOut;  ///< closed by the timeout rather than being complete or pushed out of the window
+        GEMVFATPayloads vfats;  ///< blocks of chips in the slot map
+        GEMVFATPayloads erros;  ///< blocks of chips not in the slot map
+      };
+
+      /**
+       * GEMEventBuilder constructor
+       * @param window number of events that can be open at the same time
+       * @param timeoutMsec close an event this long after its first block, 0 for no timeout
+       * @param expectedVFATs close an event as soon as it has this many blocks, 0 if unknown
+       */
+      GEMEventBuilder(size_t const& window=1, uint32_t const& timeoutMsec=0, size_t const& expectedVFATs=0);
+
+      ~GEMEventBuilder();
+
+      void setWindow(size_t const& window) { m_window = window > 0 ? window : 1; };
+      void setTimeout(uint32_t const& timeoutMsec) { m_timeoutUsec = 1000*static_cast<uint64_t>(timeoutMsec); };
+      void setExpectedVFATs(size_t const& nVFATs) { m_expectedVFATs = nVFATs; };
+
+      /**
+       * Add a block to its event, opening a new event if there is none for it
+       * @param isError true if the chip is not in the slot map
+       */
+      void add(GEMDataAMCformat::VFATData const& vfat, bool const& isError=false);
+
+      /**
+       * Take the oldest event, if it is closed
+       * @param event set to the event, which must be handed back with recycle once written
+       * @returns false if there is no event to take
+       */
+      bool pop(Event*& event);
+
+      /**
+       * Hand back an event taken with pop, for its storage to be reused
+       */
+      void recycle(Event* event);
+
+      /**
+       * Close the events that have been open for longer than the timeout
+       */
+      void expire();
+
+      /**
+       * Close all open events
+       */
+      void flush();
+
+      /**
+       * Drop all events, open or closed
+       */
+      void clear();
+
+      size_t   getOpenEvents()  const { return m_open.size(); };
+      size_t   getOpenVFATs()   const;  ///< blocks of chips in the slot map in the open events
+      size_t   getOpenErrors()  const;  ///< blocks of unknown chips in the open events
+      uint64_t getTimeoutCount()  const { return m_timeoutCount; };   ///< events closed by the timeout
+      uint64_t getOverflowCount() const { return m_overflowCount; };  ///< blocks dropped from full events
+
+    private:
+      Event* newEvent(uint32_t const& ES);
+      void   close(Event* event, bool const& timedOut);
+
+      static uint64_t nowUsec();
+
+      size_t   m_window;
+      uint64_t m_timeoutUsec;
+      size_t   m_expectedVFATs;
+
+      boost::unordered_map<uint32_t, Event*> m_open;  ///< open events by event selector
+      std::deque<Event*>  m_order;   ///< open and closed events not taken yet, oldest first
+      std::vector<Event*> m_free;    ///< events that can be reused
+      std::vector<Event*> m_events;  ///< all events, owned by the builder
+
+      uint64_t m_timeoutCount;
+      uint64_t m_overflowCount;
+
+      // Prevent copying.
+      GEMEventBuilder(GEMEventBuilder const&);
+      GEMEventBuilder& operator=(GEMEventBuilder const&);
+    };  // class GEMEventBuilder
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMEVENTBUILDER_H
@@ -0,0 +1,211 @@
+/** @file GEMEventReader.h */
+
+#ifndef GEM_READOUT_GEMEVENTREADER_H
+#define GEM_READOUT_GEMEVENTREADER_H
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/utils/GEMLogging.h"
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMVFATPayloads.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMEventReader
+     * @brief Random access to the events of a binary run file, mapped in memory
+     *
+     * The file is mapped read only and indexed once, on open, by walking the
+     * CDF framing of the events written by GEMEventSerializer, so events can
+     * then be taken in any order by their number without reading the file
+     * again. Nothing is copied or decoded while indexing: an Event only points
+     * into the mapping, and its VFAT blocks are decoded when asked for.
+     *
+     * The index is kept in a sidecar file, fileName + ".idx", which is used
+     * instead of walking the file again as long as the file has not changed
+     * size. Data that cannot be framed as an event is skipped up to the next
+     * CDF header, and counted.
+     *
+     * Only the binary output type can be read, the hex files have no framing.
+     * Zero suppressed and sparse encoded events are read as written: the
+     * blocks that were dropped are only known from the ZSFlag, and the strip
+     * lists are expanded back to full hit maps.
+     */
+    class GEMEventReader
+    {
+    public:
+      static const uint64_t kINDEX_MAGIC;  ///< "GEMIDX01", first word of the sidecar index
+
+      /**
+       * @class Event
+       * @brief View of an event in the mapped file, valid while the file is open
+       */
+      class Event
+      {
+      public:
+        Event() : p_words(NULL), m_nWords(0) {};
+        Event(uint64_t const* words, size_t const& nWords) : p_words(words), m_nWords(nWords) {};
+
+        uint64_t const* words()  const { return p_words; };
+        size_t          nWords() const { return m_nWords; };
+
+        uint64_t cdfHeader()  const { return p_words[0]; };
+        uint64_t cdfTrailer() const { return p_words[m_nWords-1]; };
+        uint32_t LV1ID()      const { return (p_words[0] >> 32) & 0xffffff; };
+        uint16_t BXID()       const { return (p_words[0] >> 20) & 0xfff; };
+
+        uint64_t header1()    const { return p_words[3]; };
+        uint64_t header2()    const { return p_words[4]; };
+        uint64_t header3()    const { return p_words[5]; };
+        uint64_t gebHeader()  const { return p_words[6]; };
+        uint64_t gebTrailer() const { return p_words[m_nWords-5]; };
+        uint64_t trailer2()   const { return p_words[m_nWords-4]; };
+        uint64_t trailer1()   const { return p_words[m_nWords-3]; };
+
+        uint32_t zsFlag()      const { return (gebHeader() >> 40) & 0xffffff; };  ///< blocks dropped as empty
+        size_t   nSuppressed() const { return __builtin_popcount(zsFlag()); };
+        bool     isSparse()    const;  ///< blocks with few hits are strip lists
+
+        /**
+         * @returns the number of VFAT blocks in the event, the suppressed ones excluded
+         */
+        size_t nVFATs() const;
+
+        /**
+         * Decode a single VFAT block, the OH BX is not in the binary format and is left 0
+         * @param i index of the block in the event
+         */
+        void getVFAT(size_t const& i, GEMDataAMCformat::VFATData& vfat) const;
+
+        /**
+         * Decode all VFAT blocks of the event
+         */
+        void getVFATs(GEMVFATPayloads& vfats) const;
+
+        /**
+         * Fill the GEM and GEB headers and trailers, without the VFAT blocks
+         */
+        void getHeaders(GEMDataAMCformat::GEMData& gem, GEMDataAMCformat::GEBData& geb) const;
+
+      private:
+        /**
+         * @returns the first word of the i-th block of a sparse encoded event, or the end of the blocks
+         */
+        uint64_t const* sparseBlock(size_t const& i) const;
+
+        uint64_t const* blocksEnd() const { return p_words + m_nWords-5; };
+
+        static void decodeSparse(uint64_t const* block, GEMDataAMCformat::VFATData& vfat);
+
+        uint64_t const* p_words;
+        size_t          m_nWords;
+      };  // class Event
+
+      /**
+       * @class const_iterator
+       * @brief Walks the events of the file in order
+       */
+      class const_iterator : public std::iterator<std::input_iterator_tag, Event>
+      {
+      public:
+        const_iterator() : p_reader(NULL), m_event(0) {};
+        const_iterator(GEMEventReader const* reader, size_t const& event) : p_reader(reader), m_event(event) {};
+
+        Event operator*() const { return p_reader->event(m_event); };
+        size_t eventNumber() const { return m_event; };
+
+        const_iterator& operator++() { ++m_event; return *this; };
+        const_iterator  operator++(int) { const_iterator it(*this); ++m_event; return it; };
+        const_iterator& operator--() { --m_event; return *this; };
+        const_iterator& operator+=(ptrdiff_t const& n) { m_event += n; return *this; };
+        const_iterator  operator+(ptrdiff_t const& n) const { return const_iterator(p_reader, m_event + n); };
+        ptrdiff_t operator-(const_iterator const& other) const { return m_event - other.m_event; };
+
+        bool operator==(const_iterator const& other) const { return m_event == other.m_event; };
+        bool operator!=(const_iterator const& other) const { return m_event != other.m_event; };
+        bool operator<(const_iterator const& other)  const { return m_event <  other.m_event; };
+
+      private:
+        GEMEventReader const* p_reader;
+        size_t                m_event;
+      };  // class const_iterator
+
+      GEMEventReader();
+
+      ~GEMEventReader();
+
+      /**
+       * Map a run file and index its events, closing any file that is already open
+       * @param fileName name of the binary run file
+       * @param useIndexFile load the sidecar index if it matches the file, and write it if not
+       * @returns true if the file was mapped, even if it holds no events
+       */
+      bool open(std::string const& fileName, bool const& useIndexFile=true);
+
+      /**
+       * Unmap the file, the events taken from it are no longer valid
+       */
+      void close();
+
+      bool isOpen() const { return m_fd >= 0; };
+
+      std::string const& getFileName() const { return m_fileName; };
+
+      size_t size()  const { return m_offsets.size(); };
+      bool   empty() const { return m_offsets.empty(); };
+
+      /**
+       * @param n event number, counted from 0 in the order of the file
+       */
+      Event event(size_t const& n) const {
+        return Event(p_data + m_offsets[n], m_lengths[n]); };
+      Event operator[](size_t const& n) const { return event(n); };
+
+      const_iterator begin() const { return const_iterator(this, 0); };
+      const_iterator end()   const { return const_iterator(this, m_offsets.size()); };
+
+      uint64_t getSkippedWords() const { return m_skippedWords; };  ///< words that could not be framed as an event
+      bool     isIndexLoaded()   const { return m_indexLoaded; };   ///< the sidecar index was used
+
+    private:
+      /**
+       * Walk the framing of the whole file
+       */
+      void buildIndex();
+
+      /**
+       * @returns the length in words of an event starting at the given word, 0 if it is not framed as one
+       */
+      size_t eventLength(size_t const& offset) const;
+
+      bool loadIndex(std::string const& indexName);
+      bool saveIndex(std::string const& indexName) const;
+
+      log4cplus::Logger m_gemLogger;
+
+      std::string m_fileName;
+      int         m_fd;
+      size_t      m_fileSize;  ///< in bytes
+      uint64_t const* p_data;
+      size_t      m_nWords;    ///< whole words in the file
+
+      std::vector<uint64_t> m_offsets;  ///< first word of each event
+      std::vector<uint32_t> m_lengths;  ///< words of each event
+
+      uint64_t m_skippedWords;
+      bool     m_indexLoaded;
+
+      // Prevent copying.
+      GEMEventReader(GEMEventReader const&);
+      GEMEventReader& operator=(GEMEventReader const&);
+    };  // class GEMEventReader
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMEVENTREADER_H
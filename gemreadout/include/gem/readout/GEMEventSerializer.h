@@ -0,0 +1,180 @@
+/** @file GEMEventSerializer.h */
+
+#ifndef GEM_READOUT_GEMEVENTSERIALIZER_H
+#define GEM_READOUT_GEMEVENTSERIALIZER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMEventWriter.h"
+#include "gem/readout/GEMVFATPayloads.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMEventSerializer
+     * @brief Lays out a whole event in a contiguous buffer and hands it to the writer in one go
+     *
+     * Binary events are framed as a single AMC in an AMC13 block inside a CDF
+     * (FED) envelope:
+     *   CDF header        5:4 Evt_ty:4 LV1_id:24 BX_id:12 Source_id:12 FOV:4 H:1 x:3
+     *   AMC13 header      uFOV:4 CalTyp:4 nAMC:4 0:16 OrN:32 0:4
+     *   AMC header        LMSEPVC0:8 AMC_size:24 0:4 Blk_no:8 AmcNo:4 BoardID:16
+     *   GEM AMC payload   header1-3, GEB header, 3 words per VFAT, GEB trailer, trailer2, trailer1
+     *   AMC13 trailer     CRC32:32 0:4 Blk_no:8 LV1_id:8 BX_id:12
+     *   CDF trailer       a:4 0:4 Evt_lgth:24 CRC16:16 0:4 Evt_stat:4 TTS:4 0:4
+     * The DataLgth fields of the GEM header1 and trailer1 and the LV1IDT and crc
+     * of trailer1 are filled from the payload as it is laid out. Lengths are in
+     * 64 bit words; the AMC13 CRC32 covers the AMC payload, and the CDF CRC16 is
+     * the FED CRC (x^16+x^15+x^2+1) of the whole event with its own field zero.
+     *
+     * Hex events hold the same GEM payload as the binary ones, without the
+     * AMC13 and CDF framing, plus the GEB run header and the OH BX of each VFAT,
+     * one 16 character line per word as before.
+     *
+     * The output type is chosen once, with setOutputType, rather than for every word.
+     *
+     * With zero suppression on, VFAT blocks without any hit are dropped and
+     * flagged in the ZSFlag:24 of the GEB header, bit 23-i for the i-th block
+     * of the event, so only the first 24 blocks can be suppressed. Binary
+     * events can also carry the hits of the blocks with few of them as strip
+     * lists, in which case bit 22 of the GEB header is set and every block is
+     *   BC:16 EC:16 ChipID:16 crc:16
+     *   nStrips:8 strip:8 ..., further words of 8 strips:8 as needed
+     * or, for a block with more hits than the sparse limit, nStrips 0xff
+     * followed by msData and lsData. An event is only sparse encoded when it
+     * is smaller that way. In both cases sumVFAT:11 of the GEB header is the
+     * number of binary words of the VFAT blocks.
+     */
+    class GEMEventSerializer
+    {
+    public:
+      static const size_t kN_FRAME_HEADERS  = 3;  ///< CDF header, AMC13 header, AMC header
+      static const size_t kN_FRAME_TRAILERS = 2;  ///< AMC13 trailer, CDF trailer
+      static const size_t kN_PAYLOAD_WORDS  = 7;  ///< GEM AMC payload words besides the VFAT blocks
+      static const size_t kN_VFAT_WORDS     = 3;  ///< binary words of a VFAT block
+      static const size_t kN_ZS_SLOTS       = 24; ///< blocks that can be flagged in the ZSFlag
+      static const uint64_t kGEB_SPARSE;          ///< GEB header bit of the sparse encoded events
+      static const unsigned kDENSE_STRIPS   = 0xff;  ///< nStrips of a block with its full hit map in a sparse event
+
+      enum OutputType {
+        BINARY = 0,
+        HEX    = 1
+      };
+
+      GEMEventSerializer(OutputType const& outputType=BINARY);
+
+      /**
+       * @returns HEX for "Hex", as the output type is spelled in the readout settings, BINARY otherwise
+       */
+      static OutputType parseOutputType(std::string const& outputType) {
+        return outputType == "Hex" ? HEX : BINARY; };
+
+      void setOutputType(OutputType const& outputType);
+      OutputType getOutputType() const { return m_outputType; };
+
+      /**
+       * @param sourceID FED id written in the CDF header
+       */
+      void setSourceID(uint16_t const& sourceID) { m_sourceID = sourceID & 0x0fff; };
+
+      /**
+       * @param suppress drop the VFAT blocks without hits
+       * @param sparseMaxStrips largest number of hits of a block written as a strip list, 0 for none
+       */
+      void setZeroSuppression(bool const& suppress, unsigned const& sparseMaxStrips=0) {
+        m_zeroSuppress    = suppress;
+        m_sparseMaxStrips = sparseMaxStrips < kDENSE_STRIPS ? sparseMaxStrips : kDENSE_STRIPS-1; };
+
+      /**
+       * @returns the binary words of a block with nStrips hits, as a strip list
+       */
+      static size_t sparseBlockWords(unsigned const& nStrips) { return 2 + nStrips/8; };
+
+      /**
+       * Lay out an event and write it
+       * @param gem GEM AMC headers and trailers, the lengths and crc are filled in here
+       * @param geb chamber header and trailer
+       * @param vfats the VFAT blocks of the chamber
+       * @returns false if the event could not be written
+       */
+      bool write(GEMEventWriter& outFile, GEMDataAMCformat::GEMData& gem,
+                 GEMDataAMCformat::GEBData const& geb, GEMVFATPayloads const& vfats);
+
+      /**
+       * Lay out an event without writing it, the event is then found at data()
+       * @returns the size of the event in bytes
+       */
+      size_t serialize(GEMDataAMCformat::GEMData& gem, GEMDataAMCformat::GEBData const& geb,
+                       GEMVFATPayloads const& vfats) {
+        (this->*m_serialize)(gem, geb, vfats);
+        return m_nBytes; };
+
+      /**
+       * @returns the last event laid out, valid until the next one
+       */
+      char const* data() const { return p_data; };
+
+      /**
+       * CRC32 (IEEE 802.3) of 64 bit words, as used for the AMC13 block
+       */
+      static uint32_t crc32(uint64_t const* words, size_t const& nWords);
+
+      /**
+       * CRC16 of 64 bit words, as used for the CDF trailer
+       */
+      static uint16_t crc16(uint64_t const* words, size_t const& nWords);
+
+    private:
+      typedef void (GEMEventSerializer::*SerializeFunction)(GEMDataAMCformat::GEMData&,
+                                                            GEMDataAMCformat::GEBData const&,
+                                                            GEMVFATPayloads const&);
+
+      void serializeBinary(GEMDataAMCformat::GEMData& gem, GEMDataAMCformat::GEBData const& geb,
+                           GEMVFATPayloads const& vfats);
+      void serializeHex(GEMDataAMCformat::GEMData& gem, GEMDataAMCformat::GEBData const& geb,
+                        GEMVFATPayloads const& vfats);
+
+      /**
+       * Lay out the GEM AMC payload in m_words from the given position, filling in the lengths and crc
+       * @param hex include the GEB run header and the OH BX words of the hex format
+       * @returns the number of words of the payload
+       */
+      size_t layoutPayload(size_t const& start, bool const& hex, GEMDataAMCformat::GEMData& gem,
+                           GEMDataAMCformat::GEBData const& geb, GEMVFATPayloads const& vfats);
+
+      /**
+       * Write a block as a strip list in sparse encoded events
+       * @returns the position after the block
+       */
+      static uint64_t* layoutSparse(uint64_t* word, unsigned const& nStrips,
+                                    uint64_t const& msData, uint64_t const& lsData);
+
+      static bool fillCRCTables();
+
+      static uint32_t s_crc32Table[256];
+      static uint16_t s_crc16Table[256];
+      static bool     s_crcTablesFilled;
+
+      OutputType        m_outputType;
+      SerializeFunction m_serialize;
+      uint16_t          m_sourceID;
+      bool              m_zeroSuppress;
+      unsigned          m_sparseMaxStrips;
+
+      std::vector<uint32_t> m_kept;    ///< blocks of the event that are written
+      std::vector<uint8_t>  m_nStrips; ///< hits of the blocks that are written
+
+      std::vector<uint64_t> m_words;  ///< the event being laid out
+      std::vector<char>     m_hex;    ///< the event as hex lines
+      char const* p_data;             ///< the event as written, in m_words or m_hex
+      size_t      m_nBytes;
+    };  // class GEMEventSerializer
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMEVENTSERIALIZER_H
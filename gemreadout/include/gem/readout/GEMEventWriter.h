@@ -0,0 +1,372 @@
+/** @file GEMEventWriter.h */
+
+#ifndef GEM_READOUT_GEMEVENTWRITER_H
+#define GEM_READOUT_GEMEVENTWRITER_H
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "toolbox/Task.h"
+
+#include "gem/utils/GEMLogging.h"
+#include "gem/utils/SPSCQueue.h"
+
+#include "gem/readout/GEMFrameCodec.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMEventWriter
+     * @brief Keeps a single output file open for the duration of a run and
+     *        accumulates the data into a large aligned buffer, which is only
+     *        written to disk when full, on an explicit flush, or on close
+     *
+     * Optionally the writes to disk are done by a dedicated writer thread, in
+     * which case full buffers are handed over to that thread and filling
+     * continues in a spare buffer, so the caller never waits on the disk
+     * unless all buffers are in use.
+     *
+     * With compression on, each buffer is compressed into a GEMFrameCodec
+     * frame before being written, by the writer thread if there is one. The
+     * buffers are then handed over on event boundaries, so that every frame
+     * can be decompressed into whole events on its own. A buffer is grown to
+     * hold an event larger than itself, which is written as one oversized frame.
+     *
+     * The output can be split in segments, a new file being started after a
+     * number of events, bytes or seconds. Segments always end on an event
+     * boundary and are switched by the thread writing the buffers out, which
+     * also opens and preallocates the next segment ahead of time. A .meta
+     * file is written next to each segment when it is closed.
+     *
+     * With direct I/O the file is opened with O_DIRECT and only whole, aligned
+     * blocks are written through it, bypassing the page cache. What is left of
+     * a buffer past the last whole block is kept at the front of the next
+     * write, so up to a block of data stays in memory until the segment or the
+     * file is closed, when it is written through the page cache. Filesystems
+     * that do not support O_DIRECT fall back to normal writes.
+     */
+    class GEMEventWriter
+    {
+    public:
+      static const size_t   kDEFAULT_BUFFER_SIZE; ///< 4MB, size of the in-memory buffer
+      static const size_t   kBUFFER_ALIGNMENT;    ///< alignment of the in-memory buffer (page size)
+      static const unsigned kN_BUFFERS;           ///< number of buffers when using the writer thread
+      static const unsigned kIDLE_USEC;           ///< sleep while waiting for the other thread
+      static const unsigned kN_LATENCY_BINS = 24; ///< bins of the write latency histogram
+
+      enum FsyncPolicy {
+        FSYNC_NEVER   = 0,  ///< leave the data to the kernel
+        FSYNC_SEGMENT = 1,  ///< when a segment is closed
+        FSYNC_BUFFER  = 2   ///< after every buffer written
+      };
+
+      /**
+       * GEMEventWriter constructor
+       * @param bufferSize size in bytes of the in-memory buffer
+       * @param writerThread do the writing to disk in a dedicated thread
+       */
+      GEMEventWriter(size_t const& bufferSize=kDEFAULT_BUFFER_SIZE, bool const& writerThread=false);
+
+      ~GEMEventWriter();
+
+      /**
+       * Open a file for appending, closing (and flushing) any file that is already open
+       * @param fileName name of the file to write to
+       * @returns true if the file was successfully opened
+       */
+      bool open(std::string const& fileName);
+
+      /**
+       * Flush the buffer and close the file
+       */
+      void close();
+
+      /**
+       * Write the buffer contents to the file, and wait for the writer thread to finish with them
+       * @returns false if any data could not be written since the last flush
+       */
+      bool flush();
+
+      bool isOpen() const { return m_fd >= 0; };
+
+      /**
+       * Compress the data written from the next open on
+       * @param level zlib compression level, 0 to write the data as is
+       * @returns false if a file is open, the compression is then left unchanged
+       */
+      bool setCompression(int const& level);
+
+      bool isCompressed() const { return m_codec.get() != NULL; };
+
+      /**
+       * Bypass the page cache from the next open on
+       * @returns false if a file is open, the setting is then left unchanged
+       */
+      bool setDirectIO(bool const& directIO);
+
+      bool isDirectIO() const { return m_directIO; };
+
+      /**
+       * Split the data written from the next open on in segments, a segment is
+       * closed at the end of the event that reaches any of the limits
+       * @param maxEvents events per segment, 0 for no limit
+       * @param maxBytes bytes per segment, before compression, 0 for no limit
+       * @param maxSeconds seconds per segment, 0 for no limit
+       * @returns false if a file is open, the segmentation is then left unchanged
+       */
+      bool setRotation(uint64_t const& maxEvents, uint64_t const& maxBytes, uint32_t const& maxSeconds);
+
+      /**
+       * With no limits the data goes to a single file, with the name given to open
+       */
+      bool isRotating() const {
+        return m_segmentMaxEvents > 0 || m_segmentMaxBytes > 0 || m_segmentMaxSeconds > 0; };
+
+      void setFsyncPolicy(FsyncPolicy const& policy) { m_fsyncPolicy = policy; };
+
+      /**
+       * @returns FSYNC_SEGMENT for "segment", FSYNC_BUFFER for "buffer", FSYNC_NEVER otherwise
+       */
+      static FsyncPolicy parseFsyncPolicy(std::string const& policy);
+
+      /**
+       * @returns the name of a segment, the file name with the segment number before the extension
+       */
+      static std::string segmentName(std::string const& fileName, uint32_t const& segment);
+
+      /**
+       * Append raw bytes to the buffer, flushing when the buffer is full
+       * @param data pointer to the bytes to write
+       * @param nBytes number of bytes to write
+       */
+      bool write(char const* data, size_t const& nBytes);
+
+      /**
+       * Append a single 64 bit word to the buffer in binary format
+       */
+      bool write(uint64_t const& word) {
+        return write(reinterpret_cast<char const*>(&word), sizeof(word)); };
+
+      /**
+       * Append a single 64 bit word to the buffer as a line of 16 hex characters
+       */
+      bool writeHex(uint64_t const& word);
+
+      /**
+       * Mark the end of an event, all the data of the event has been passed to the writer
+       */
+      void endEvent() {
+        if (p_current) {
+          p_current->eventEnd = p_current->used;
+          ++p_current->events;
+        }
+        ++m_eventsWritten;
+        ++m_segmentEvents;
+        if (isRotating())
+          checkRotation(); };
+
+      /**
+       * Body of the writer thread, writes out the buffers handed over by the caller
+       */
+      int writerTask();
+
+      std::string const& getFileName() const { return m_fileName; };
+
+      uint64_t getBytesWritten()  const { return m_bytesWritten; };  ///< bytes written to disk
+      uint64_t getRawBytes()      const { return m_rawBytes; };      ///< bytes written before compression
+      uint64_t getCompressUsec()  const { return m_compressUsec; };  ///< total time spent compressing
+      uint64_t getEventsWritten() const { return m_eventsWritten; };
+      uint64_t getFlushCount()    const { return m_flushCount; };
+      uint64_t getWriteUsec()     const { return m_writeUsec; };    ///< total time spent in write calls
+      uint64_t getMaxWriteUsec()  const { return m_maxWriteUsec; }; ///< longest single buffer write
+      uint64_t getStallCount()    const { return m_stallCount; };   ///< times the caller waited for a free buffer
+      uint32_t getSegment()       const { return m_segment; };      ///< segment being written, counted from 0
+
+      /**
+       * Latency of the single write calls, bin i counts the writes taking
+       * from 2^i to 2^(i+1) usec, the first bin also those under 1 usec and
+       * the last one everything longer
+       */
+      void getWriteLatency(std::vector<uint64_t>& histogram) const;
+
+    private:
+      struct OutputBuffer {
+        char*    data;
+        size_t   size;      ///< capacity, larger than the buffer size once grown for a large event
+        size_t   used;
+        size_t   eventEnd;  ///< end of the last complete event
+        uint32_t events;    ///< events completed in the buffer
+        bool     lastOfSegment;  ///< start the next segment once the buffer is written
+      };
+
+      void resetBuffer(OutputBuffer& buffer) {
+        buffer.used          = 0;
+        buffer.eventEnd      = 0;
+        buffer.events        = 0;
+        buffer.lastOfSegment = false; };
+
+      /**
+       * Hand the current buffer to be written, and continue in an empty one
+       */
+      bool submit();
+
+      /**
+       * Hand the complete events of the current buffer to be written, and move
+       * the start of the event being written to the next buffer
+       */
+      bool submitEvents();
+
+      /**
+       * Reallocate a buffer with room for at least size bytes, keeping its contents
+       */
+      bool growBuffer(OutputBuffer& buffer, size_t const& size);
+
+      /**
+       * Reallocate the staging buffer with room for at least size bytes, keeping the partial block in front
+       */
+      bool growStaging(size_t const& size);
+
+      /**
+       * Write the contents of a buffer to the file
+       */
+      bool writeOut(OutputBuffer& buffer);
+
+      /**
+       * Write bytes to the file, timing the write
+       */
+      bool writeBytes(char const* data, size_t const& nBytes);
+
+      /**
+       * Write the whole blocks of data with direct I/O, and keep the rest in the staging buffer
+       */
+      bool writeDirect(char const* data, size_t const& nBytes);
+
+      /**
+       * Write the partial block kept back by direct I/O through the page cache,
+       * before the current segment is closed
+       */
+      bool writeCarry();
+
+      /**
+       * Stop bypassing the page cache for a file
+       */
+      void clearDirectIO(int const fd);
+
+      /**
+       * Close the segment at the end of this event if it has reached a limit
+       */
+      void checkRotation();
+
+      /**
+       * Open the file of a segment, the file name itself when not rotating
+       * @returns the file descriptor, negative on failure
+       */
+      int openSegment(uint32_t const& segment);
+
+      /**
+       * Switch to the next segment, by the thread writing the buffers out
+       */
+      void nextSegment();
+
+      /**
+       * Reset the counters of the segment that was just started
+       */
+      void startSegment();
+
+      /**
+       * Open and preallocate the file of the segment after the current one
+       */
+      void prepareSpare();
+
+      /**
+       * Release the unused preallocated space, sync according to the policy, close and describe a segment
+       */
+      void closeSegment(int const fd);
+
+      /**
+       * Write the .meta file of the current segment
+       */
+      void writeSegmentMeta();
+
+      log4cplus::Logger m_gemLogger;
+
+      std::string m_fileName;
+      volatile int m_fd;  ///< current segment, switched by the thread writing the buffers out
+
+      size_t m_bufferSize;
+      std::vector<OutputBuffer> m_buffers;
+      OutputBuffer* p_current;
+
+      // used only with compression, by the thread writing the buffers out
+      std::unique_ptr<GEMFrameCodec> m_codec;
+
+      // aligned buffer for the compressed frames and the partial block of direct I/O,
+      // used by the thread writing the buffers out
+      bool   m_directIO;
+      char*  p_staging;
+      size_t m_stagingSize;
+      size_t m_carry;  ///< bytes at the front of the staging buffer not yet written
+
+      // segmentation limits, set while closed
+      uint64_t    m_segmentMaxEvents;
+      uint64_t    m_segmentMaxBytes;
+      uint32_t    m_segmentMaxSeconds;
+      FsyncPolicy m_fsyncPolicy;
+      // the segment being filled, by the caller
+      uint64_t    m_segmentEvents;
+      uint64_t    m_segmentBytes;
+      time_t      m_segmentStart;
+      // the segment being written, by the thread writing the buffers out
+      uint32_t    m_segment;
+      int         m_spareFd;           ///< next segment, opened ahead of time
+      uint64_t    m_segmentWritten;    ///< bytes on disk
+      uint64_t    m_segmentRaw;        ///< bytes before compression
+      uint64_t    m_segmentEventsOut;
+      uint64_t    m_segmentFirstEvent;
+      time_t      m_segmentOpened;
+      uint64_t    m_lastSegmentSize;   ///< bytes on disk of the previous segment, to preallocate the next one
+      uint64_t    m_eventsOut;         ///< events written out
+
+      // used only with the writer thread
+      std::unique_ptr<gem::utils::SPSCQueue<OutputBuffer*> > m_fullQueue;  ///< to the writer thread
+      std::unique_ptr<gem::utils::SPSCQueue<OutputBuffer*> > m_freeQueue;  ///< back from the writer thread
+      std::shared_ptr<toolbox::Task> m_writerTask;
+      volatile bool     m_writerExit;
+      volatile bool     m_writerRunning;
+      volatile bool     m_writeFailed;
+      volatile uint64_t m_submitted;  ///< buffers handed to the writer thread
+      volatile uint64_t m_completed;  ///< buffers written by the writer thread
+
+      volatile uint64_t m_bytesWritten;
+      volatile uint64_t m_rawBytes;
+      volatile uint64_t m_compressUsec;
+      uint64_t          m_eventsWritten;
+      volatile uint64_t m_flushCount;
+      volatile uint64_t m_writeUsec;
+      volatile uint64_t m_maxWriteUsec;
+      volatile uint64_t m_writeLatency[kN_LATENCY_BINS];
+      uint64_t          m_stallCount;
+
+      // Prevent copying.
+      GEMEventWriter(GEMEventWriter const&);
+      GEMEventWriter& operator=(GEMEventWriter const&);
+    };  // class GEMEventWriter
+
+    class GEMEventWriterTask : public toolbox::Task {
+    public:
+    GEMEventWriterTask(GEMEventWriter* writer) : toolbox::Task("GEMEventWriterTask")
+        {
+          p_writer = writer;
+        }
+      virtual int svc() { return p_writer->writerTask(); }
+    private:
+      GEMEventWriter* p_writer;
+    };
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMEVENTWRITER_H
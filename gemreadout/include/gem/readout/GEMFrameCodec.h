@@ -0,0 +1,85 @@
+/** @file GEMFrameCodec.h */
+
+#ifndef GEM_READOUT_GEMFRAMECODEC_H
+#define GEM_READOUT_GEMFRAMECODEC_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMFrameCodec
+     * @brief Compresses the output buffers into independently decodable frames
+     *
+     * Each frame is a 16 byte header followed by a complete deflate (zlib)
+     * stream of the buffer, so a frame can be decompressed on its own without
+     * any of the frames before it:
+     *   magic:32 ("GEMZ")  compressedSize:32  rawSize:32  nEvents:32
+     * Frames hold whole events only, unless a single event is larger than a
+     * buffer, in which case nEvents is 0 for the frames holding its first parts.
+     *
+     * The compression state is allocated once and reused for every frame.
+     */
+    class GEMFrameCodec
+    {
+    public:
+      static const uint32_t kFRAME_MAGIC;      ///< "GEMZ" as the file bytes
+      static const size_t   kHEADER_SIZE = 16;
+
+      struct FrameHeader {
+        uint32_t magic;
+        uint32_t compressedSize;  ///< bytes of the deflate stream after the header
+        uint32_t rawSize;         ///< bytes once decompressed
+        uint32_t nEvents;         ///< events completed in the frame
+      };
+
+      /**
+       * @param level zlib compression level, 1 (fastest) to 9 (smallest)
+       */
+      explicit GEMFrameCodec(int const& level=1);
+
+      ~GEMFrameCodec();
+
+      /**
+       * @returns the largest frame a buffer of rawSize bytes can compress to, header included
+       */
+      static size_t maxFrameSize(size_t const& rawSize);
+
+      /**
+       * Compress a buffer into a frame
+       * @param frame output, with room for maxFrameSize(rawSize) bytes
+       * @returns the size of the frame, header included, 0 on failure
+       */
+      size_t compress(char const* raw, size_t const& rawSize, uint32_t const& nEvents, char* frame);
+
+      /**
+       * Read the header of the frame at the start of data
+       * @returns false if there is no complete frame header
+       */
+      static bool readHeader(char const* data, size_t const& size, FrameHeader& header);
+
+      /**
+       * Decompress a single frame
+       * @param frame the frame, header included
+       * @param raw set to the decompressed data
+       * @returns false if the frame is incomplete or corrupt
+       */
+      static bool decompress(char const* frame, size_t const& size, std::vector<char>& raw);
+
+      int getLevel() const { return m_level; };
+
+    private:
+      int   m_level;
+      void* p_stream;  ///< z_stream, kept out of the header
+
+      // Prevent copying.
+      GEMFrameCodec(GEMFrameCodec const&);
+      GEMFrameCodec& operator=(GEMFrameCodec const&);
+    };  // class GEMFrameCodec
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMFRAMECODEC_H
@@ -0,0 +1,72 @@
+/** @file GEMHexCodec.h */
+
+#ifndef GEM_READOUT_GEMHEXCODEC_H
+#define GEM_READOUT_GEMHEXCODEC_H
+
+#include <cstddef>
+#include <istream>
+#include <stdint.h>
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMHexCodec
+     * @brief Formats and parses the 64 bit words of the "Hex" output type
+     *
+     * Each word is a line of 16 lower case hex digits, most significant
+     * first, and a newline. Words are formatted a byte at a time from a table
+     * of digit pairs, and parsed from a table of digit values, rather than
+     * through printf or iostream manipulators.
+     */
+    class GEMHexCodec
+    {
+    public:
+      static const size_t kLINE_SIZE = 17;  ///< 16 digits and the newline
+
+      /**
+       * Format a word as a line
+       * @param line output, with room for kLINE_SIZE characters
+       * @returns the position after the line
+       */
+      static char* encode(uint64_t const& word, char* line) {
+        for (int byte = 7; byte >= 0; --byte, line += 2) {
+          char const* digits = s_digitPairs + 2*((word >> (8*byte)) & 0xff);
+          line[0] = digits[0];
+          line[1] = digits[1];
+        }
+        *line++ = '\n';
+        return line; };
+
+      /**
+       * Format words as consecutive lines
+       * @param text output, with room for kLINE_SIZE*nWords characters
+       * @returns the number of characters written
+       */
+      static size_t encode(uint64_t const* words, size_t const& nWords, char* text);
+
+      /**
+       * Parse exactly 16 hex digits, in either case
+       * @returns false if any of them is not a hex digit
+       */
+      static bool decode(char const* digits, uint64_t& word);
+
+      /**
+       * Read the next word from a stream, skipping any white space before it
+       * and taking up to 16 hex digits, as the word was written
+       * @returns false, and sets the stream state, at the end of the stream or
+       *          if the next characters are not hex digits
+       */
+      static bool read(std::istream& in, uint64_t& word);
+
+    private:
+      static bool fillTables();
+
+      static char   s_digitPairs[2*256];  ///< the two digits of every byte
+      static int8_t s_digitValues[256];   ///< the value of every hex digit character, -1 for the others
+      static bool   s_tablesFilled;
+    };  // class GEMHexCodec
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMHEXCODEC_H
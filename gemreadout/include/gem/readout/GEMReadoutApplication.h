@@ -20,11 +20,15 @@
 #include "gem/utils/GEMLogging.h"
 #include "gem/utils/Lock.h"
 #include "gem/utils/LockGuard.h"
+#include "gem/utils/SPSCQueue.h"
+
+#include "gem/readout/GEMEventWriter.h"
 
 namespace gem {
   namespace readout {
 
     class GEMReadoutTask;
+    class GEMBuilderTask;
 
     class GEMReadoutApplication : public gem::base::GEMFSMApplication
       {
@@ -32,6 +36,9 @@ namespace gem {
         static const int I2O_READOUT_NOTIFY;
         static const int I2O_READOUT_CONFIRM;
 
+        static const unsigned kBUILDER_IDLE_USEC;  ///< builder sleep when there is no data
+        static const unsigned kDRAIN_TIMEOUT_MSEC; ///< maximum wait for the pipeline to empty
+
         struct ReadoutCommands {
           enum EReadoutCommands {
             CMD_STOP   = 1,
@@ -60,8 +67,18 @@ namespace gem {
          xoap::MessageReference updateScanParameters(xoap::MessageReference message) throw (xoap::exception::Exception);
         */
 
+        /**
+         * Body of the readout thread, polls the hardware into pool frames
+         * and queues them for the builder thread
+         */
         int readoutTask();
 
+        /**
+         * Body of the builder thread, passes the queued frames to processData
+         * and releases them back to the pool
+         */
+        int builderTask();
+
       protected:
 
         // inspired by HCAL readout application
@@ -88,11 +105,60 @@ namespace gem {
 
         virtual int readout(unsigned int expected, unsigned int* eventNumbers, std::vector< ::toolbox::mem::Reference* >& data) = 0;
 
+        /**
+         * Consumer of the data read out, called by the readout task with the frames
+         * filled by readout, which are released back to the pool once this returns
+         * @param data frames filled by the last call to readout
+         */
+        virtual void processData(std::vector< ::toolbox::mem::Reference* >& data) {};
+
+        /**
+         * Wait until the readout thread is idle and the builder thread has processed all queued frames
+         */
+        void drainPipeline();
+
+        /**
+         * Stop the readout and builder threads and wait for them to exit, the frames still
+         * queued go back to the pool. The threads call readout and processData, so the derived
+         * applications call this first thing in their destructors.
+         */
+        void stopThreads();
+
+        /**
+         * Allocate a frame of the configured frame size from the readout memory pool
+         * @returns the frame, or NULL if the pool is exhausted
+         */
+        ::toolbox::mem::Reference* allocateFrame();
+
+        /**
+         * Release all frames back to the readout memory pool and clear the vector
+         */
+        void releaseFrames(std::vector< ::toolbox::mem::Reference* >& data);
+
+        /**
+         * Update the pool usage counters in the application InfoSpace
+         */
+        void updatePoolCounters();
+
+        /**
+         * Update the writer stage counters in the application InfoSpace
+         */
+        void updateWriterCounters(GEMEventWriter const& writer);
+
         std::string m_outFileName;
         std::shared_ptr<toolbox::Task> m_task;
+        std::shared_ptr<toolbox::Task> m_builder;
         toolbox::mem::Pool*            m_pool;
         toolbox::SyncQueue<int>        m_cmdQueue;
 
+        // frames passed from the readout thread to the builder thread
+        std::unique_ptr<gem::utils::SPSCQueue< ::toolbox::mem::Reference*> > m_frameQueue;
+        volatile bool m_readoutIdle;
+        volatile bool m_builderIdle;
+        volatile bool m_readoutDone;  ///< the readout thread has exited
+        volatile bool m_builderExit;  ///< tells the builder thread to exit
+        volatile bool m_builderDone;  ///< the builder thread has exited
+
         class GEMReadoutSettings {
         public:
           GEMReadoutSettings();
@@ -102,9 +168,23 @@ namespace gem {
           xdata::String runType;
           xdata::String runPeriod;
           xdata::String fileName;
-          xdata::String outputType;
+          xdata::String outputType;  ///< "Hex", "Bin" or "BinZ", compressed binary
           xdata::String outputLocation;
           xdata::String setupLocation;
+
+          xdata::UnsignedInteger64 poolSize;   ///< size in bytes of the committed heap readout pool
+          xdata::UnsignedInteger32 frameSize;  ///< size in bytes of a single readout frame
+          xdata::UnsignedInteger32 compressionLevel;  ///< zlib level of the "BinZ" compressed binary output type
+
+          // output segmentation, a new file is started when any limit is reached, 0 for no limit
+          xdata::UnsignedInteger64 segmentEvents;   ///< events per output file
+          xdata::UnsignedInteger64 segmentBytes;    ///< bytes per output file, before compression
+          xdata::UnsignedInteger32 segmentSeconds;  ///< seconds per output file
+          xdata::String            fsyncPolicy;     ///< "never", "segment" or "buffer"
+          xdata::Boolean           directIO;        ///< write the output files bypassing the page cache
+
+          xdata::Boolean           zeroSuppress;     ///< drop the VFAT blocks without hits
+          xdata::UnsignedInteger32 sparseMaxStrips;  ///< hits up to which a block is written as a strip list, 0 for never
         };
 
         xdata::Bag<GEMReadoutSettings> m_readoutSettings;
@@ -116,6 +196,26 @@ namespace gem {
 
         double m_usecUsed;
 
+        xdata::UnsignedInteger64 m_poolUsed;       ///< bytes of the readout pool currently allocated
+        xdata::UnsignedInteger64 m_poolHighWater;  ///< maximum bytes of the readout pool allocated at once
+        xdata::UnsignedInteger64 m_poolExhausted;  ///< number of frame requests that failed because the pool was full
+
+        // pipeline stage counters
+        xdata::UnsignedInteger64 m_framesQueued;       ///< frames handed from the readout to the builder
+        xdata::UnsignedInteger64 m_framesBuilt;        ///< frames processed by the builder
+        xdata::UnsignedInteger32 m_frameQueueDepth;    ///< frames waiting for the builder
+        xdata::Double            m_usecPerFrameBuilt;  ///< average builder time per frame
+        xdata::UnsignedInteger64 m_bytesWritten;       ///< bytes written by the writer thread
+        xdata::Double            m_usecPerMBWritten;   ///< average writer time per MB
+        xdata::UnsignedInteger64 m_maxWriteUsec;       ///< longest single write by the writer thread
+        xdata::UnsignedInteger64 m_writerStalls;       ///< times the builder waited for the writer
+        xdata::Double            m_compressionRatio;   ///< bytes before over bytes after compression, this run
+        xdata::Double            m_compressMBPerSec;   ///< compression throughput of the writer thread, this run
+        xdata::UnsignedInteger32 m_outputSegment;      ///< output file being written, counted from 0
+        xdata::Vector<xdata::UnsignedInteger64> m_writeLatency;  ///< writes per log2 usec bin, this run
+
+        double m_usecBuilt;
+
       private:
 
       };
@@ -133,6 +233,17 @@ namespace gem {
       GEMReadoutApplication* p_readoutApp;
     };
 
+    class GEMBuilderTask : public toolbox::Task {
+    public:
+    GEMBuilderTask(GEMReadoutApplication* app) : toolbox::Task("GEMBuilderTask")
+        {
+          p_readoutApp = app;
+        }
+      virtual int svc() { return p_readoutApp->builderTask(); }
+    private:
+      GEMReadoutApplication* p_readoutApp;
+    };
+
   }  // namespace gem::readout
 }  // namespace gem
 
@@ -0,0 +1,89 @@
+/** @file GEMReadoutBuffer.h */
+
+#ifndef GEM_READOUT_GEMREADOUTBUFFER_H
+#define GEM_READOUT_GEMREADOUTBUFFER_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMReadoutBuffer
+     * @brief Contiguous buffer of raw 32 bit FIFO words
+     *
+     * The hardware block read lands directly in the free space at the end of
+     * the buffer (reserve/commit), and the event builder walks the unread
+     * words in place with a cursor (data/consume), so each word is copied
+     * exactly once on the way in.
+     * Consumed words are reclaimed by moving the unread tail back to the
+     * start of the storage when more space is needed.
+     */
+    class GEMReadoutBuffer
+    {
+    public:
+      static const size_t kDEFAULT_CAPACITY; ///< initial capacity in 32 bit words
+
+      /**
+       * GEMReadoutBuffer constructor
+       * @param capacity initial number of 32 bit words that can be stored
+       */
+      GEMReadoutBuffer(size_t const& capacity=kDEFAULT_CAPACITY);
+
+      /**
+       * Provide space for at least nWords at the end of the buffer
+       * @param nWords number of words the caller intends to write
+       * @returns pointer to the first free word, valid until the next call to reserve
+       */
+      uint32_t* reserve(size_t const& nWords);
+
+      /**
+       * Mark nWords of the previously reserved space as containing valid data
+       * @param nWords number of words actually written, must not exceed the reserved size
+       */
+      void commit(size_t const& nWords) { m_tail += nWords; };
+
+      /**
+       * @returns pointer to the first unread word
+       */
+      uint32_t const* data() const { return &m_store[0] + m_head; };
+
+      /**
+       * @returns the first unread word, the buffer must not be empty
+       */
+      uint32_t front() const { return m_store[m_head]; };
+
+      /**
+       * Advance the read cursor past nWords, must not exceed size()
+       */
+      void consume(size_t const& nWords) {
+        m_head += nWords;
+        if (m_head == m_tail)
+          m_head = m_tail = 0;
+      };
+
+      /**
+       * @returns the number of unread words
+       */
+      size_t size()  const { return m_tail - m_head; };
+      bool   empty() const { return m_tail == m_head; };
+
+      size_t capacity() const { return m_store.size(); };
+
+      /**
+       * Drop all unread words
+       */
+      void clear() { m_head = m_tail = 0; };
+
+    private:
+      std::vector<uint32_t> m_store;
+
+      size_t m_head; ///< index of the first unread word
+      size_t m_tail; ///< index one past the last valid word
+    };  // class GEMReadoutBuffer
+  }  // namespace gem::readout
+}  // namespace gem
+
+#endif  // GEM_READOUT_GEMREADOUTBUFFER_H
@@ -0,0 +1,106 @@
+/** @file GEMVFATDecoder.h */
+
+#ifndef GEM_READOUT_GEMVFATDECODER_H
+#define GEM_READOUT_GEMVFATDECODER_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMVFATDecoder
+     * @brief Unpacks the 7x32 bit VFAT blocks of the GLIB tracking data FIFO
+     *
+     * Block layout, as read from the FIFO:
+     *   [0] 1010:4  BC:12     1100:4  EC:8  Flags:4
+     *   [1] 1110:4  ChipID:12 data[127:112]
+     *   [2] data[111:80]
+     *   [3] data[79:48]
+     *   [4] data[47:16]
+     *   [5] data[15:0]        CRC:16
+     *   [6] BX from the OptoHybrid
+     * Every field is a fixed shift and mask of the words, so a block is
+     * decoded in one pass without any branching on the word position.
+     */
+    class GEMVFATDecoder
+    {
+    public:
+      static const size_t kBLOCK_WORDS = 7;  ///< 32 bit words in one VFAT block
+
+      /**
+       * @returns true if the word carries the 1010 and 1100 markers of the first word of a block
+       */
+      static bool isBlockStart(uint32_t const& word) {
+        return (word & 0xf000f000) == 0xa000c000; };
+
+      /**
+       * Find the start of the next block, a word with the 1010 and 1100 markers followed
+       * by one with the 1110 marker, for realigning after a link glitch. The block found
+       * may be incomplete, its remaining words are still to be read, and a last word
+       * with the first markers counts as a block start.
+       * @param words pointer to the first word to search
+       * @param nWords number of words available
+       * @returns the number of words before the block start, or nWords if there is none
+       */
+      static size_t findBlockStart(uint32_t const* words, size_t const& nWords);
+
+      /**
+       * @returns the (EC << 12) | BC event selector of a block from its first word
+       */
+      static uint32_t eventSelector(uint32_t const& word) {
+        return (((0x00000ff0 & word) >> 4) << 12) | ((0x0fff0000 & word) >> 16); };
+
+      /**
+       * @returns the (EC << 12) | BC event selector of a decoded block
+       */
+      static uint32_t eventSelector(GEMDataAMCformat::VFATData const& vfat) {
+        return (((0x0ff0 & vfat.EC) >> 4) << 12) | (0x0fff & vfat.BC); };
+
+      /**
+       * Decode a single block
+       * @param block pointer to 7 contiguous words, the first being the block start
+       * @param vfat decoded block
+       */
+      static void decode(uint32_t const* block, GEMDataAMCformat::VFATData& vfat);
+
+      /**
+       * Decode consecutive blocks, no check is made on the block markers
+       * @param words pointer to the first word of the first block
+       * @param nWords number of words available, any incomplete block at the end is ignored
+       * @param out destination, must have space for nWords/7 blocks
+       * @returns the number of blocks decoded
+       */
+      static size_t decode(uint32_t const* words, size_t const& nWords, GEMDataAMCformat::VFATData* out);
+
+    private:
+      /**
+       * @returns 1 if the two words can be the first two words of a block, 0 otherwise
+       */
+      static unsigned isBlockHeader(uint32_t const& first, uint32_t const& second) {
+        return ((first & 0xf000f000) == 0xa000c000) & ((second & 0xf0000000) == 0xe0000000); };
+    };  // class GEMVFATDecoder
+  }  // namespace gem::readout
+}  // namespace gem
+
+inline void gem::readout::GEMVFATDecoder::decode(uint32_t const* block, GEMDataAMCformat::VFATData& vfat)
+{
+  uint32_t const w0 = block[0], w1 = block[1], w2 = block[2], w3 = block[3];
+  uint32_t const w4 = block[4], w5 = block[5], w6 = block[6];
+
+  // the markers are kept in the top nibble of each field
+  vfat.BC     = w0 >> 16;                                // 1010:4   BC:12
+  vfat.EC     = w0 & 0xffff;                             // 1100:4   EC:8    Flags:4
+  vfat.ChipID = w1 >> 16;                                // 1110:4   ChipID:12
+  vfat.msData = (static_cast<uint64_t>(w1 & 0xffff) << 48)
+    | (static_cast<uint64_t>(w2) << 16) | (w3 >> 16);    // channels 65-128
+  vfat.lsData = (static_cast<uint64_t>(w3 & 0xffff) << 48)
+    | (static_cast<uint64_t>(w4) << 16) | (w5 >> 16);    // channels 1-64
+  vfat.crc    = w5 & 0xffff;
+  vfat.BXfrOH = w6;
+}
+
+#endif  // GEM_READOUT_GEMVFATDECODER_H
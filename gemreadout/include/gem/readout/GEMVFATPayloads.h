@@ -0,0 +1,121 @@
+/** @file GEMVFATPayloads.h */
+
+#ifndef GEM_READOUT_GEMVFATPAYLOADS_H
+#define GEM_READOUT_GEMVFATPAYLOADS_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+namespace gem {
+  namespace readout {
+
+    /**
+     * @class GEMVFATPayloads
+     * @brief The VFAT blocks of an event, stored field by field
+     *
+     * Every field of the blocks is kept in its own contiguous array, so a pass
+     * over one field, e.g. counting the hits in the channel words or checking
+     * the CRCs, streams through tightly packed data rather than striding over
+     * padded VFATData structures. The arrays are allocated for the given
+     * capacity up front and keep their storage when cleared, so an object
+     * reused for event after event does not reallocate unless an event has
+     * more blocks than any before.
+     */
+    class GEMVFATPayloads
+    {
+    public:
+      static const size_t kDEFAULT_CAPACITY = 24;  ///< one block per GEB slot
+
+      explicit GEMVFATPayloads(size_t const& capacity=kDEFAULT_CAPACITY);
+
+      size_t size()     const { return m_size; };
+      bool   empty()    const { return m_size == 0; };
+      size_t capacity() const { return m_BC.size(); };
+
+      /**
+       * Forget the blocks, keeping the storage
+       */
+      void clear() { m_size = 0; };
+
+      /**
+       * Make room for at least capacity blocks
+       */
+      void reserve(size_t const& capacity);
+
+      /**
+       * Append a block, growing the storage only if it is full
+       */
+      void push_back(GEMDataAMCformat::VFATData const& vfat);
+
+      /**
+       * Replace the contents with nVFATs blocks
+       */
+      void assign(GEMDataAMCformat::VFATData const* vfats, size_t const& nVFATs);
+
+      /**
+       * Reassemble a single block
+       */
+      void get(size_t const& index, GEMDataAMCformat::VFATData& vfat) const;
+
+      GEMDataAMCformat::VFATData operator[](size_t const& index) const {
+        GEMDataAMCformat::VFATData vfat;
+        get(index, vfat);
+        return vfat; };
+
+      /**
+       * Number of channels hit, summed over all blocks
+       */
+      size_t countHits() const;
+
+      // the arrays of each field, valid for size() blocks
+      uint16_t const* BC()     const { return &m_BC[0]; };
+      uint16_t const* EC()     const { return &m_EC[0]; };
+      uint16_t const* ChipID() const { return &m_ChipID[0]; };
+      uint64_t const* lsData() const { return &m_lsData[0]; };
+      uint64_t const* msData() const { return &m_msData[0]; };
+      uint32_t const* BXfrOH() const { return &m_BXfrOH[0]; };
+      uint16_t const* crc()    const { return &m_crc[0]; };
+
+    private:
+      size_t m_size;
+
+      std::vector<uint16_t> m_BC;      ///< 1010:4,   BC:12
+      std::vector<uint16_t> m_EC;      ///< 1100:4,   EC:8,      Flags:4
+      std::vector<uint16_t> m_ChipID;  ///< 1110,     ChipID:12
+      std::vector<uint64_t> m_lsData;  ///< channels from 1to64
+      std::vector<uint64_t> m_msData;  ///< channels from 65to128
+      std::vector<uint32_t> m_BXfrOH;  ///< BX from OH
+      std::vector<uint16_t> m_crc;     ///< CRC
+    };  // class GEMVFATPayloads
+  }  // namespace gem::readout
+}  // namespace gem
+
+inline void gem::readout::GEMVFATPayloads::push_back(GEMDataAMCformat::VFATData const& vfat)
+{
+  if (m_size == capacity())
+    reserve(m_size > 0 ? 2*m_size : kDEFAULT_CAPACITY);
+  m_BC[m_size]     = vfat.BC;
+  m_EC[m_size]     = vfat.EC;
+  m_ChipID[m_size] = vfat.ChipID;
+  m_lsData[m_size] = vfat.lsData;
+  m_msData[m_size] = vfat.msData;
+  m_BXfrOH[m_size] = vfat.BXfrOH;
+  m_crc[m_size]    = vfat.crc;
+  ++m_size;
+}
+
+inline void gem::readout::GEMVFATPayloads::get(size_t const& index, GEMDataAMCformat::VFATData& vfat) const
+{
+  vfat.BC     = m_BC[index];
+  vfat.EC     = m_EC[index];
+  vfat.ChipID = m_ChipID[index];
+  vfat.lsData = m_lsData[index];
+  vfat.msData = m_msData[index];
+  vfat.BXfrOH = m_BXfrOH[index];
+  vfat.crc    = m_crc[index];
+}
+
+#endif  // GEM_READOUT_GEMVFATPAYLOADS_H
@@ -7,83 +7,157 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <string>
+#include <stdint.h>
 
 namespace gem {
   namespace readout {
 
+    /**
+     * @class GEMslotContents
+     * @brief Map between the GEB slots and the ChipIDs of the VFATs plugged into them
+     *
+     * The slot map is read once, from a slot file or from an in-memory copy of
+     * its contents, and a dense table over the whole 12 bit ChipID space is
+     * built from it, so looking up the slot of a chip does not depend on the
+     * number of slots. The object can be copied or shared between links once
+     * it is loaded, the lookups do not modify it.
+     */
     class GEMslotContents {
       //struct is a class with all members public by default
     public:
+      static const int      kN_SLOTS    = 24;     ///< slots on a GEB
+      static const unsigned kN_CHIPIDS  = 4096;   ///< 12 bit ChipID space
+      static const uint16_t kEMPTY_SLOT = 0xfff;  ///< ChipID of an unused slot
+
+      /**
+       * Empty slot map, to be filled with loadSlotCfg or setSlotCfg
+       */
+      GEMslotContents() {
+        initSlots();
+      };
+
+      /**
+       * Read the slot map from $BUILD_HOME/$GEM_OS_PROJECT/gemreadout/data/slotFile
+       */
       GEMslotContents(const std::string& slotFile) {
         slotFile_ = slotFile;
+        initSlots();
         getSlotCfg();
       };
+
+      /**
+       * Take the slot map from the ChipIDs of the 24 slots, kEMPTY_SLOT for an unused slot
+       */
+      GEMslotContents(uint16_t const chipIDs[kN_SLOTS]) {
+        initSlots();
+        setSlotCfg(chipIDs);
+      };
+
+      /**
+       * Parse the slot map in the slot file format, 3 lines of 8 comma separated hex ChipIDs
+       * @param config stream with the slot file contents, e.g. a std::istringstream on a copy kept in memory
+       * @returns false if the map is incomplete, the slots that were read are still used
+       */
+      bool loadSlotCfg(std::istream& config) {
+        uint16_t chipIDs[kN_SLOTS];
+        for (int islot = 0; islot < kN_SLOTS; ++islot)
+          chipIDs[islot] = kEMPTY_SLOT;
+
+        bool complete = true;
+        for (int row = 0; row < 3 && complete; row++) {
+          std::string line;
+          if (!std::getline(config, line)) {
+            complete = false;
+            break;
+          }
+          std::istringstream iss(line);
+          for (int col = 0; col < 8; col++) {
+            std::string val;
+            std::getline(iss,val,',');
+            std::stringstream convertor(val);
+            if (!(convertor >> std::hex >> chipIDs[8*row+col])) {
+              chipIDs[8*row+col] = kEMPTY_SLOT;
+              complete = false;
+            }
+          }
+        }
+        setSlotCfg(chipIDs);
+        isFileRead = complete;
+        return complete;
+      };
+
+      /**
+       * Set the ChipIDs of the 24 slots, kEMPTY_SLOT for an unused slot, and rebuild the lookup table
+       */
+      void setSlotCfg(uint16_t const chipIDs[kN_SLOTS]) {
+        for (unsigned chip = 0; chip < kN_CHIPIDS; ++chip)
+          slotOfChip_[chip] = -1;
+        nSlots_ = 0;
+        // a ChipID listed twice resolves to the last slot, as the old linear scan did
+        for (int islot = 0; islot < kN_SLOTS; ++islot) {
+          slot[islot] = chipIDs[islot] & 0x0fff;
+          if (slot[islot] == kEMPTY_SLOT)
+            continue;
+          slotOfChip_[slot[islot]] = islot;
+          ++nSlots_;
+        }
+        isFileRead = true;
+      };
+
+      bool isSlotCfgRead() const { return isFileRead; };
+
     private:
-      uint16_t slot[24];
+      uint16_t slot[kN_SLOTS];         ///< slot -> ChipID
+      int8_t   slotOfChip_[kN_CHIPIDS];  ///< ChipID -> slot, -1 if the chip is not on the GEB
+      uint32_t nSlots_;
       bool isFileRead;
       std::string slotFile_;
 
        void initSlots() {
-        for (int i = 0; i < 24; ++i)
-          slot[i] = 0xfff;
+        for (int i = 0; i < kN_SLOTS; ++i)
+          slot[i] = kEMPTY_SLOT;
+        for (unsigned chip = 0; chip < kN_CHIPIDS; ++chip)
+          slotOfChip_[chip] = -1;
+        nSlots_ = 0;
         isFileRead = false;
         return;
       };
 
       void getSlotCfg() {
         std::ifstream ifile;
-        std::string build_home     = std::getenv("BUILD_HOME");
-        std::string gem_os_project = std::getenv("GEM_OS_PROJECT");
-        std::string path           = build_home + "/" + gem_os_project;
+        char const* build_home     = std::getenv("BUILD_HOME");
+        char const* gem_os_project = std::getenv("GEM_OS_PROJECT");
+        std::string path           = std::string(build_home ? build_home : "") + "/"
+          + (gem_os_project ? gem_os_project : "");
         path += "/gemreadout/data/";
         path += slotFile_;
-        ifile.open(path);
+        ifile.open(path.c_str());
 
         if(!ifile.is_open()) {
-          std::cout << "[GEMslotContents]: The file: " << ifile << " is missing.\n" << std::endl;
+          std::cout << "[GEMslotContents]: The file: " << path << " is missing.\n" << std::endl;
           isFileRead = false;
           return;
         };
 
-        for (int row = 0; row < 3; row++) {
-          std::string line;
-          std::getline(ifile, line);
-          std::istringstream iss(line);
-          if ( !ifile.good() ) break;
-          for (int col = 0; col < 8; col++) {
-            std::string val;
-            std::getline(iss,val,',');
-            std::stringstream convertor(val);
-            convertor >> std::hex >> slot[8*row+col];
-          }
-        }
+        loadSlotCfg(ifile);
         ifile.close();
-        isFileRead = true;
       };
 
     public:
       /*
        *  Slot Index converter from Hex ChipID
        */
-      int GEBslotIndex(const uint32_t& GEBChipID) {
-        int indxslot = -1;
-        //std::cout << "\nUsing slot file: " << slotFile_ << std::endl;
-        for (int islot = 0; islot < 24; islot++) {
-          if ( (GEBChipID & 0x0fff ) == slot[islot] ) indxslot = islot;
-        }//end for slot
-
-        return (indxslot);
+      int GEBslotIndex(const uint32_t& GEBChipID) const {
+        return slotOfChip_[GEBChipID & 0x0fff];
       };
-      uint32_t GEBChipIdFromSlot(int slotindex){
-            return slot[slotindex];
+      uint32_t GEBChipIdFromSlot(int slotindex) const {
+        if (slotindex < 0 || slotindex >= kN_SLOTS)
+          return kEMPTY_SLOT;
+        return slot[slotindex];
       };
-      uint32_t GEBNumberOfSlots(){
-        uint32_t count=0;
-        for (int islot = 0; islot < 24; islot++) {
-            if(slot[islot]==0xfff) continue;
-            count++;
-        }
-        return count;
+      uint32_t GEBNumberOfSlots() const {
+        return nSlots_;
       };
 
     };  // class GEMslotContents
@@ -73,6 +73,7 @@ namespace gem {
         std::map<int,int> strip_maps[NVFAT];
         std::map<int, GEMStripCollection> allstrips;
         std::string slot_file;
+        std::unique_ptr<gem::readout::GEMslotContents> slotInfo_;
         TH1F* hiVFATsn;
         TH1F* hiClusterMult;
         TH1F* hiClusterSize;
@@ -81,6 +82,7 @@ namespace gem {
 //=================================================================================================================
         void init(std::string slotFile_){
           slot_file = slotFile_;
+          slotInfo_ = std::unique_ptr<gem::readout::GEMslotContents> (new gem::readout::GEMslotContents(slot_file));
           std::string type[NVFAT] = {"Slot0" , "Slot1" , "Slot2" , "Slot3" , "Slot4" , "Slot5" , "Slot6" , "Slot7",
                                      "Slot8" , "Slot9" , "Slot10", "Slot11", "Slot12", "Slot13", "Slot14", "Slot15",
                                      "Slot16", "Slot17", "Slot18", "Slot19", "Slot20", "Slot21", "Slot22", "Slot23"};
@@ -122,7 +124,6 @@ namespace gem {
           allstrips.clear();
         }
         int sn(const gem::readout::GEMDataAMCformat::VFATData& vfat){
-          std::unique_ptr<gem::readout::GEMslotContents> slotInfo_ = std::unique_ptr<gem::readout::GEMslotContents> (new gem::readout::GEMslotContents(slot_file));
           uint32_t t_chipID = static_cast<uint32_t>(0x0fff & vfat.ChipID);
           return slotInfo_->GEBslotIndex(t_chipID);
         }
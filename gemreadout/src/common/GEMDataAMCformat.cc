@@ -0,0 +1,174 @@
+/**
+ * class: GEMDataAMCformat
+ * description: Writing of the AMC data format to a GEMEventWriter
+ */
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+#include "gem/readout/GEMEventWriter.h"
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd1(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(gem.header1);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd1Binary(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if (event < 0) return false;
+  if (!outf.isOpen()) return false;
+  uint64_t cdfHeader = 0x5fffffffffffffff;
+  uint64_t amc13Header1 = 0xff1ffffffffffff0;
+  uint64_t amc13Header2 = 0xffffffffffffffff;
+  outf.write(cdfHeader);
+  outf.write(amc13Header1);
+  outf.write(amc13Header2);
+  return outf.write(gem.header1);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd2(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(gem.header2);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd2Binary(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(gem.header2);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd3(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(gem.header3);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMhd3Binary(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(gem.header3);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBheader(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(geb.header);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBheaderBinary(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(geb.header);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBrunhed(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(geb.runhed);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBrunhedBinary(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(geb.runhed);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBtrailer(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(geb.trailer);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEBtrailerBinary(GEMEventWriter& outf, int event, const GEBData& geb)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(geb.trailer);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMtr2(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(gem.trailer2);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMtr2Binary(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.write(gem.trailer2);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMtr1(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  return outf.writeHex(gem.trailer1);
+}
+
+bool gem::readout::GEMDataAMCformat::writeGEMtr1Binary(GEMEventWriter& outf, int event, const GEMData& gem)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  uint64_t amc13Trailer = 0xbadc0ffeebadcafe;
+  uint64_t cdfTrailer = 0xafffffffffffffff;
+  outf.write(gem.trailer1);
+  outf.write(amc13Trailer);
+  return outf.write(cdfTrailer);
+}
+
+bool gem::readout::GEMDataAMCformat::writeVFATdata(GEMEventWriter& outf, int event, const VFATData& vfat)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  // have to have 64 bit word lengths
+  outf.writeHex(((((((uint64_t)vfat.BC<<16)+vfat.EC)<<16)+vfat.ChipID)<<16)+(vfat.msData>>48));
+  outf.writeHex(((vfat.msData&0x0000ffffffffffff)<<16)+(vfat.lsData>>48));
+  outf.writeHex(((vfat.lsData&0x0000ffffffffffff)<<16)+vfat.crc);
+  //writeZEROline(outf);
+  return outf.writeHex(vfat.BXfrOH);
+}
+
+bool gem::readout::GEMDataAMCformat::writeVFATdataBinary(GEMEventWriter& outf, int event, const VFATData& vfat)
+{
+  if ( event<0) return false;
+  if (!outf.isOpen()) return false;
+  uint64_t w1;
+  uint64_t w2;
+  uint64_t w3;
+  uint64_t bc = vfat.BC;
+  uint64_t ec = vfat.EC;
+  uint64_t ci = vfat.ChipID;
+  w1 = 0xffffffffffffffff & ((bc <<48) | (ec << 32) | (ci << 16) | (vfat.msData >> 48));
+  w2 = 0xffffffffffffffff & ((vfat.msData <<16) | (vfat.lsData >> 48));
+  w3 = 0xffffffffffffffff & ((vfat.lsData <<16) | (vfat.crc ));
+  outf.write(w1);
+  outf.write(w2);
+  outf.write(w3);
+  //outf.write( (char*)&vfat.BC,     sizeof(vfat.BC));
+  //outf.write( (char*)&vfat.EC,     sizeof(vfat.EC));
+  //outf.write( (char*)&vfat.ChipID, sizeof(vfat.ChipID));
+  //outf.write( (char*)&vfat.msData, sizeof(vfat.msData));
+  //outf.write( (char*)&vfat.lsData, sizeof(vfat.lsData));
+  //outf.write( (char*)&vfat.crc,    sizeof(vfat.crc));
+  //outf.write( (char*)&vfat.BXfrOH, sizeof(vfat.BXfrOH));
+  return true;
+}
+
+bool gem::readout::GEMDataAMCformat::writeZEROline(GEMEventWriter& outf)
+{
+  if (!outf.isOpen()) return false;
+  return outf.write("\n\n", 2);
+}
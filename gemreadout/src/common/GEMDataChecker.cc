@@ -0,0 +1,79 @@
+/**
+ * class: GEMDataChecker
+ * description: Checks of the VFAT data integrity, table driven CRC of the
+ *              VFAT blocks with mismatch counters per chip
+ */
+
+#include "gem/datachecker/GEMDataChecker.h"
+
+#include <cstring>
+
+const unsigned gem::datachecker::GEMDataChecker::kN_CHIPIDS;
+
+uint16_t gem::datachecker::GEMDataChecker::s_crcTable[4][256];
+bool     gem::datachecker::GEMDataChecker::s_crcTableFilled = gem::datachecker::GEMDataChecker::fillCRCTable();
+
+bool gem::datachecker::GEMDataChecker::fillCRCTable()
+{
+  for (unsigned byte = 0; byte < 256; ++byte) {
+    uint16_t crc = byte;
+    for (unsigned bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x1) ? ((crc >> 1) ^ 0x8408) : (crc >> 1);
+    s_crcTable[0][byte] = crc;
+  }
+  // each further table appends a zero byte
+  for (unsigned n = 1; n < 4; ++n)
+    for (unsigned byte = 0; byte < 256; ++byte)
+      s_crcTable[n][byte] = (s_crcTable[n-1][byte] >> 8) ^ s_crcTable[0][s_crcTable[n-1][byte] & 0xff];
+  return true;
+}
+
+void gem::datachecker::GEMDataChecker::resetCounters()
+{
+  m_checked    = 0;
+  m_mismatches = 0;
+  memset(m_chipMismatches, 0, sizeof(m_chipMismatches));
+}
+
+size_t gem::datachecker::GEMDataChecker::checkCRC(gem::readout::GEMDataAMCformat::VFATData const* vfats,
+                                                  size_t const& nVFATs, bool* crcOK)
+{
+  size_t nBad = 0;
+  for (size_t i = 0; i < nVFATs; ++i) {
+    bool const ok = vfatCRC(vfats[i]) == vfats[i].crc;
+    if (!ok) {
+      ++m_chipMismatches[vfats[i].ChipID & 0x0fff];
+      ++nBad;
+    }
+    if (crcOK)
+      crcOK[i] = ok;
+  }
+  m_checked    += nVFATs;
+  m_mismatches += nBad;
+  return nBad;
+}
+
+size_t gem::datachecker::GEMDataChecker::checkCRC(gem::readout::GEMVFATPayloads const& vfats, bool* crcOK)
+{
+  uint16_t const* BC     = vfats.BC();
+  uint16_t const* EC     = vfats.EC();
+  uint16_t const* ChipID = vfats.ChipID();
+  uint64_t const* msData = vfats.msData();
+  uint64_t const* lsData = vfats.lsData();
+  uint16_t const* crc    = vfats.crc();
+
+  size_t const nVFATs = vfats.size();
+  size_t nBad = 0;
+  for (size_t i = 0; i < nVFATs; ++i) {
+    bool const ok = vfatCRC(BC[i], EC[i], ChipID[i], msData[i], lsData[i]) == crc[i];
+    if (!ok) {
+      ++m_chipMismatches[ChipID[i] & 0x0fff];
+      ++nBad;
+    }
+    if (crcOK)
+      crcOK[i] = ok;
+  }
+  m_checked    += nVFATs;
+  m_mismatches += nBad;
+  return nBad;
+}
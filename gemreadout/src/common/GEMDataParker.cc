@@ -5,6 +5,8 @@
 #include <sstream>
 #include <vector>
 
+#include <sys/time.h>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <boost/utility/binary.hpp>
@@ -22,8 +24,8 @@
 #include "xercesc/dom/DOMNodeList.hpp"
 #include "xercesc/util/XercesDefs.hpp"
 
-#include "TStopwatch.h"
 #include "gem/readout/GEMDataParker.h"
+#include "gem/readout/GEMVFATDecoder.h"
 #include "gem/readout/exception/Exception.h"
 #include "gem/hw/glib/HwGLIB.h"
 
@@ -33,20 +35,21 @@ typedef std::shared_ptr<int*> link_shared_ptr;
 typedef gem::readout::GEMDataAMCformat::GEMData  AMCGEMData;
 typedef gem::readout::GEMDataAMCformat::GEBData  AMCGEBData;
 typedef gem::readout::GEMDataAMCformat::VFATData AMCVFATData;
-//
-//why are these global and not part of the header???
-std::vector<AMCVFATData> vfats;
-std::vector<AMCVFATData> erros;
 
 const uint32_t gem::readout::GEMDataParker::kUPDATE = 5000;
 const uint32_t gem::readout::GEMDataParker::kUPDATE7 = 7;
 
-// I have no idea what this is for
-int rvent_ = 0;
-
 const int gem::readout::GEMDataParker::I2O_READOUT_NOTIFY=0x84;
 const int gem::readout::GEMDataParker::I2O_READOUT_CONFIRM=0x85;
 
+// seconds since the epoch, for the timing printouts
+static double wallTime()
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
 // Main constructor
 gem::readout::GEMDataParker::GEMDataParker(gem::hw::glib::HwGLIB& glibDevice,
                                            std::string const& outFileName,
@@ -57,6 +60,7 @@ gem::readout::GEMDataParker::GEMDataParker(gem::hw::glib::HwGLIB& glibDevice,
   m_ESexp(-1),
   m_isFirst(true),
   m_contvfats(0),
+  m_rvent(0),
   m_gemLogger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMDataParker"))),
   m_queueLock(toolbox::BSem::FULL, true),
   m_runType(runType)
@@ -71,12 +75,35 @@ gem::readout::GEMDataParker::GEMDataParker(gem::hw::glib::HwGLIB& glibDevice,
   m_errFileName  = errFileName;
   m_slotFileName = slotFileName;
   m_outputType   = outputType;
-  m_counter = {0,0,0,0,0};
+  m_serializer.setOutputType(GEMEventSerializer::parseOutputType(m_outputType));
+  for (unsigned count = 0; count < 5; ++count) m_counter[count] = 0;
   m_vfat = 0;
   m_event = 0;
-  rvent_ = 0;
   m_sumVFAT = 0;
   slotInfo = std::unique_ptr<gem::readout::GEMslotContents>(new gem::readout::GEMslotContents(m_slotFileName));
+  // an event is complete once every chip in the slot map has been seen
+  m_eventBuilder.setExpectedVFATs(slotInfo->GEBNumberOfSlots());
+
+  m_outWriter = std::unique_ptr<gem::readout::GEMEventWriter>(new gem::readout::GEMEventWriter());
+  m_errWriter = std::unique_ptr<gem::readout::GEMEventWriter>(new gem::readout::GEMEventWriter());
+  if (!m_outWriter->open(m_outFileName))
+    ERROR("GEMDataParker::unable to open output file " << m_outFileName);
+  if (!m_errWriter->open(m_errFileName))
+    ERROR("GEMDataParker::unable to open error file " << m_errFileName);
+}
+
+gem::readout::GEMDataParker::~GEMDataParker()
+{
+  // writers flush and close their files on destruction
+  DEBUG("GEMDataParker::destructor called");
+}
+
+void gem::readout::GEMDataParker::flush()
+{
+  m_eventBuilder.flush();
+  writeClosedEvents();
+  m_outWriter->flush();
+  m_errWriter->flush();
 }
 
 uint32_t* gem::readout::GEMDataParker::dumpData(uint8_t const& readout_mask)
@@ -154,61 +181,38 @@ xoap::MessageReference gem::readout::GEMDataParker::updateScanParameters(xoap::M
 uint32_t* gem::readout::GEMDataParker::getGLIBData(uint8_t const& gtx, uint32_t counter[5])
 {
   uint32_t *point = &counter[0];
-  TStopwatch timer;
-
-  timer.Start();
-  Float_t whileStart = (Float_t)timer.RealTime();
+  double const timerStart = wallTime();
+  double whileStart = 0.;
+  // each read also returns the occupancy left behind, so after the first poll
+  // every iteration is a single dispatch
+  uint32_t nBlocks = p_glibDevice->getFIFOVFATBlockOccupancy(gtx);
   DEBUG(" ::getGLIBData Starting while loop readout " << whileStart
-        << std::endl << "FIFO VFAT block depth 0x" << std::hex
-        << p_glibDevice->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl << "FIFO depth 0x" << std::hex
-        << p_glibDevice->getFIFOOccupancy(gtx)
-        );
-  while ( p_glibDevice->getFIFOVFATBlockOccupancy(gtx) ) {
-    //timer.Start();
-    Float_t getTrackingStart = (Float_t)timer.RealTime();
+        << " FIFO VFAT block depth 0x" << std::hex << nBlocks << std::dec);
+  while (nBlocks) {
+    double getTrackingStart = wallTime() - timerStart;
     DEBUG(" ::getGLIBData initiating call to getTrackingData(gtx,"
-          << p_glibDevice->getFIFOVFATBlockOccupancy(gtx) << ") "
+          << nBlocks << ") "
           << getTrackingStart);
-    std::vector<uint32_t> data = p_glibDevice->getTrackingData(gtx,
-                                                               p_glibDevice->getFIFOVFATBlockOccupancy(gtx));
-    Float_t getTrackingFinish = (Float_t)timer.RealTime();
-    DEBUG(" ::getGLIBData The time for one call of getTrackingData(gtx) " << getTrackingFinish
-          << std::endl << "FIFO VFAT block depth 0x" << std::hex
-          << p_glibDevice->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl << "FIFO depth 0x" << std::hex
-          << p_glibDevice->getFIFOOccupancy(gtx)
-          );
-
-    uint32_t contqueue = 0;
-    for (auto iword = data.begin(); iword != data.end(); ++iword) {
-      contqueue++;
-      //gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
-      DEBUG(" ::getGLIBData pushing into queue 0x"
-            << std::setfill('0') << std::setw(8) << std::hex << *iword << std::dec );
-      m_dataque.push(*iword);
-      if (contqueue%kUPDATE7 == 0 &&  contqueue != 0) {
-        m_contvfats++;
-        DEBUG(" ::getGLIBData counter " << contqueue << " contvfats " << m_contvfats
-              << " m_dataque.size " << m_dataque.size());
-      }
+    uint32_t nRead = 0, remaining = 0;
+    {
+      // the block read lands directly in the readout buffer
+      gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+      uint32_t* dest = m_dataBuffer.reserve(7*nBlocks);
+      nRead = p_glibDevice->getTrackingData(gtx, dest, nBlocks, remaining);
+      m_dataBuffer.commit(7*nRead);
     }
-    DEBUG(" ::getGLIBData end of while loop do we go again?" << std::endl
-          << " FIFO VFAT block occupancy  0x" << std::hex << p_glibDevice->getFIFOVFATBlockOccupancy(gtx)
-          << std::endl
-          << " FIFO occupancy             0x" << std::hex << p_glibDevice->getFIFOOccupancy(gtx) << std::endl
-          << " hasTrackingData            0x" << std::hex << p_glibDevice->hasTrackingData(gtx)  << std::endl
-          );
-  }// while(p_glibDevice->getFIFOVFATBlockOccupancy(gtx))
-  timer.Stop();
-  Float_t whileFinish = (Float_t)timer.RealTime();
-  DEBUG(" ::getGLIBData The time for while loop execution " << whileFinish
-        << std::endl
-        << " FIFO VFAT block occupancy  0x" << std::hex << p_glibDevice->getFIFOVFATBlockOccupancy(gtx)
-        << std::endl
-        << " FIFO occupancy             0x" << std::hex << p_glibDevice->getFIFOOccupancy(gtx) << std::endl
-        << " hasTrackingData            0x" << std::hex << p_glibDevice->hasTrackingData(gtx)  << std::endl
-        );
+    nBlocks = remaining;
+    m_contvfats += nRead;
+    double getTrackingFinish = wallTime() - timerStart;
+    DEBUG(" ::getGLIBData The time for one call of getTrackingData(gtx) " << getTrackingFinish
+          << " read " << nRead << " blocks, contvfats " << m_contvfats
+          << " buffer size " << m_dataBuffer.size()
+          << " FIFO VFAT block occupancy 0x" << std::hex << nBlocks << std::dec);
+    if (nRead == 0)
+      break;
+  }// while(nBlocks)
+  double whileFinish = wallTime() - timerStart;
+  DEBUG(" ::getGLIBData The time for while loop execution " << whileFinish);
   return point;
 }
 
@@ -234,184 +238,119 @@ uint32_t* gem::readout::GEMDataParker::GEMEventMaker(uint32_t counter[5])
 
   int islot = -1;
 
-  // Booking FIFO variables
-  uint64_t msVFAT, lsVFAT;
   uint32_t ES;
 
   DEBUG("GEMDataParker::GEMEventMaker  " << std::hex << point );
-  if (m_dataque.empty()) return point;
-  DEBUG(" ::GEMEventMaker m_dataque.size " << m_dataque.size() );
-
-  this->readVFATblock(m_dataque);
-
-  uint64_t data1  = dat10 | dat11;
-  uint64_t data2  = dat20 | dat21;
-  uint64_t data3  = dat30 | dat31;
-  uint64_t data4  = dat40 | dat41;
+  {
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(m_queueLock);
+    DEBUG(" ::GEMEventMaker buffer size " << m_dataBuffer.size() );
+    if (!this->readVFATblock(m_dataBuffer, vfat)) return point;
+  }
 
   m_vfat++;
 
-  islot = slotInfo->GEBslotIndex( (uint32_t)chipid);
+  islot = slotInfo->GEBslotIndex( (uint32_t)(0x0fff & vfat.ChipID));
 
   // GEM Event selector
-  ES = ( evn << 12 ) | bcn;
-  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << " evn 0x"<< evn <<
-        " bcn 0x" << std::hex << bcn << std::dec << " vftas.size " <<
-        vfats.size() << " erros.size " << erros.size() << " chip ID 0x" <<
-        std::hex << (int)chipid << std::dec <<
-        " slot number " << islot << " m_isFirst " << m_isFirst << " event " << m_event);
-
-  lsVFAT = (data3 << 32) | (data4);
-  msVFAT = (data1 << 32) | (data2);
-
-  vfat.BC     = ( b1010 << 12 ) | (bcn);                // 1010     | bcn:12
-  vfat.EC     = ( b1100 << 12 ) | (evn << 4) | (flags); // 1100     | EC:8      | Flag:4
-  vfat.ChipID = ( b1110 << 12 ) | (chipid);             // 1110     | ChipID:12
-  vfat.lsData = lsVFAT;                                 // lsData:64
-  vfat.msData = msVFAT;                                 // msData:64
-  vfat.BXfrOH = BX;                                     // BXfrOH:32
-  vfat.crc    = vfatcrc;                                // crc:16
-
-  if ( ES == m_ESexp ) {
-    m_isFirst = false;
-  } else {
-    m_isFirst = true;
-
-    if ( vfats.size() != 0 || erros.size() != 0 ) {
-      DEBUG(" ::GEMEventMaker m_isFirst GEMevSelector ");
-      gem::readout::GEMDataParker::GEMevSelector(m_ESexp);
-    }
-
-    m_event++;
-    // VFATS dimensions have limits
-    vfats.reserve(MaxVFATS);
-    erros.reserve(MaxERRS);
-    m_ESexp = ES;
-  }
-  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << std::dec << " bool " << m_isFirst );
-  if (islot < 0 || islot > 23) {
-    if ( int(erros.size()) <MaxERRS ) erros.push_back(vfat);
-    DEBUG(" ::GEMEventMaker warning !!! islot is undefined " << islot << " erros.size " << int(erros.size()) );
-  } else {
-    // VFATs Pay Load
-    if ( int(vfats.size()) <= MaxVFATS ) vfats.push_back(vfat);
-    DEBUG(" ::GEMEventMaker m_event " << m_event << " vfats.size " << vfats.size() << std::hex << " ES 0x" << ES << std::dec );
-  }//end of event selection
+  ES = gem::readout::GEMVFATDecoder::eventSelector(vfat);
+  DEBUG(" ::GEMEventMaker ES 0x" << std::hex << ES << " EC 0x" << ((0x0ff0 & vfat.EC) >> 4) <<
+        " BC 0x" << std::hex << (0x0fff & vfat.BC) << std::dec << " open events " <<
+        m_eventBuilder.getOpenEvents() << " chip ID 0x" <<
+        std::hex << (0x0fff & vfat.ChipID) << std::dec <<
+        " slot number " << islot << " event " << m_event);
+
+  if (islot < 0 || islot > 23)
+    DEBUG(" ::GEMEventMaker warning !!! islot is undefined " << islot);
+  m_eventBuilder.add(vfat, islot < 0 || islot > 23);
+  m_ESexp = ES;
+
+  // write out whatever the new block completed, or pushed out of the window
+  m_eventBuilder.expire();
+  writeClosedEvents();
 
   counter[0] = m_vfat;
   counter[1] = m_event;
-  counter[2] = vfats.size() + erros.size();
-  counter[3] = vfats.size();
-  counter[4] = erros.size();
+  counter[2] = m_eventBuilder.getOpenVFATs() + m_eventBuilder.getOpenErrors();
+  counter[3] = m_eventBuilder.getOpenVFATs();
+  counter[4] = m_eventBuilder.getOpenErrors();
 
   return point;
 }
 
-void gem::readout::GEMDataParker::GEMevSelector(const  uint32_t& ES)
+void gem::readout::GEMDataParker::writeClosedEvents()
+{
+  GEMEventBuilder::Event* event = NULL;
+  while (m_eventBuilder.pop(event)) {
+    m_event++;
+    GEMevSelector(*event);
+    m_eventBuilder.recycle(event);
+  }
+}
+
+void gem::readout::GEMDataParker::GEMevSelector(GEMEventBuilder::Event const& event)
 {
   //  GEM Event Data Format definition
   AMCGEMData  gem;
   AMCGEBData  geb;
-  AMCVFATData vfat;
 
-  DEBUG(" ::GEMEventMaker vfats.size " << int(vfats.size()) << " rvent_ " << rvent_ << " event " << m_event);
+  DEBUG(" ::GEMevSelector ES 0x" << std::hex << event.ES << std::dec << " vfats.size " << event.vfats.size()
+        << " erros.size " << event.erros.size() << " m_rvent " << m_rvent << " event " << m_event
+        << (event.timedOut ? " timed out" : ""));
 
-  uint32_t locEvent = 0;
-  uint32_t locError = 0;
   std::string TypeDataFlag = "PayLoad";
 
-  // contents all local events (one buffer, all links):
-  locEvent++;
-  uint32_t nChip = 0;
-  for (auto iVFAT=vfats.begin(); iVFAT != vfats.end(); ++iVFAT) {//try auto
-
-    uint8_t ECff = ( (0x0ff0 & (*iVFAT).EC ) >> 4);
-    uint32_t localEvent = ( ECff << 12 ) | ( 0x0fff & (*iVFAT).BC );
-
-    DEBUG(" ::GEMEventMaker vfats ES 0x" << std::hex << ( 0x00ffffff & ES) << " and from vfat 0x" <<
-          ( 0x00ffffff & localEvent ) << " EC 0x" << (int)ECff << " BC 0x" << ( 0x0fff & (*iVFAT).BC ) << std::dec );
-
-    if ( ES == localEvent ) {
-      nChip++;
-      // VFATs Pay Load
-      geb.vfats.push_back(*iVFAT);
-      int islot = slotInfo->GEBslotIndex((uint32_t)(*iVFAT).ChipID);
-      DEBUG(" ::GEMevSelector slot number " << islot );
-
-      if ( gem::readout::GEMDataParker::VFATfillData( islot, geb) ) {
-        if ( vfats.size() == nChip ) {
-
-          gem::readout::GEMDataParker::GEMfillHeaders(m_event, 1, gem, geb);
-          gem::readout::GEMDataParker::GEMfillTrailers(gem, geb);
-          // GEM Event Writing
-          DEBUG(" ::GEMEventMaker writing...  geb.vfats.size " << int(geb.vfats.size()) );
-          TypeDataFlag = "PayLoad";
-          if(int(geb.vfats.size()) != 0) gem::readout::GEMDataParker::writeGEMevent(m_outFileName, false, TypeDataFlag,
-                                                                                    gem, geb, vfat);
-          geb.vfats.clear();
-        }// end of writing event
-      }// if slot correct
-    }// if localEvent
-  }// end of GEB PayLoad Data
-
-  geb.vfats.clear();
-  TypeDataFlag = "Errors";
-
-  // contents all local events (one buffer, all links):
-  DEBUG(" ::GEMEventMaker END ES 0x" << std::hex << ES << std::dec << " errES " <<  erros.size() <<
-        " rvent_ " << rvent_ );
-
-  uint32_t nErro = 0;
-  for (auto iErr=erros.begin(); iErr != erros.end(); ++iErr) {
-
-    uint8_t ECff = ( (0x0ff0 & (*iErr).EC ) >> 4);
-    uint32_t localErr = ( ECff << 12 ) | ( 0x0fff & (*iErr).BC );
-    DEBUG(" ::GEMEventMaker ERROR vfats ES 0x" << ES << " EC " << localErr );
-
-    if( ES == localErr ) {
-      nErro++;
-      DEBUG(" ::GEMEventMaker " << " nErro " << nErro << " ES 0x" << std::hex << ES << std::dec );
-      // VFATs Errors
-      geb.vfats.push_back(*iErr);
-      if ( erros.size() == nErro ) {
-        // GEMDataAMCformat::printVFATdataBits(nErro, vfat);
-        int islot = -1;
-        gem::readout::GEMDataParker::VFATfillData( islot, geb);
-        gem::readout::GEMDataParker::GEMfillHeaders(rvent_, nErro, gem, geb);
-        gem::readout::GEMDataParker::GEMfillTrailers(gem, geb);
-        // GEM ERRORS Event Writing
-        TypeDataFlag = "Errors";
-        if(int(geb.vfats.size()) != 0) gem::readout::GEMDataParker::writeGEMevent(m_errFileName, false, TypeDataFlag,
-                                                                                  gem, geb, vfat);
-        geb.vfats.clear();
-      }// if localErr
-    }// if localErr
-  }// end of GEB PayLoad Data
-
-  geb.vfats.clear();
+  // CRC check all blocks of the event in one go
+  if (!event.vfats.empty()) {
+    size_t nBad = m_dataChecker.checkCRC(event.vfats);
+    if (nBad > 0)
+      DEBUG(" ::GEMevSelector " << nBad << " of " << event.vfats.size() << " VFAT blocks with a CRC mismatch, "
+            << m_dataChecker.getMismatchCount() << " in total");
+  }
+
+  // all blocks of the event were collected by the event builder, the chips are in known slots,
+  // and are written from there
+  if (!event.vfats.empty()) {
+    int islot = slotInfo->GEBslotIndex((uint32_t)event.vfats.ChipID()[event.vfats.size()-1]);
+    DEBUG(" ::GEMevSelector slot number " << islot );
+
+    if ( gem::readout::GEMDataParker::VFATfillData( islot, geb, event.vfats.size()) ) {
+      gem::readout::GEMDataParker::GEMfillHeaders(m_event, 1, gem, geb);
+      gem::readout::GEMDataParker::GEMfillTrailers(gem, geb);
+      // GEM Event Writing
+      DEBUG(" ::GEMevSelector writing...  vfats.size " << int(event.vfats.size()) );
+      gem::readout::GEMDataParker::writeGEMevent(*m_outWriter, false, TypeDataFlag,
+                                                 gem, geb, event.vfats);
+    }// if slot correct
+  }
+
+  if (!event.erros.empty()) {
+    // GEMDataAMCformat::printVFATdataBits(nErro, vfat);
+    TypeDataFlag = "Errors";
+    int islot = -1;
+    gem::readout::GEMDataParker::VFATfillData( islot, geb, event.erros.size());
+    gem::readout::GEMDataParker::GEMfillHeaders(m_rvent, event.erros.size(), gem, geb);
+    gem::readout::GEMDataParker::GEMfillTrailers(gem, geb);
+    // GEM ERRORS Event Writing
+    gem::readout::GEMDataParker::writeGEMevent(*m_errWriter, false, TypeDataFlag,
+                                               gem, geb, event.erros);
+  }
 
   if (m_event%kUPDATE == 0 &&  m_event != 0) {
-    DEBUG(" ::GEMEventMaker vfats.size " << std::setfill(' ') << std::setw(7) << int(vfats.size()) <<
-          " erros.size " << std::setfill(' ') << std::setw(3) << int(erros.size()) <<
-          " locEvent   " << std::setfill(' ') << std::setw(6) << locEvent <<
-          " locError   " << std::setfill(' ') << std::setw(3) << locError << " event " << m_event
+    DEBUG(" ::GEMevSelector vfats.size " << std::setfill(' ') << std::setw(7) << int(event.vfats.size()) <<
+          " erros.size " << std::setfill(' ') << std::setw(3) << int(event.erros.size()) <<
+          " open events " << m_eventBuilder.getOpenEvents() << " timed out " << m_eventBuilder.getTimeoutCount() <<
+          " event " << m_event
           );
   }
-
-  locEvent = 0;
-
-  vfats.clear();
-  erros.clear();
-  // reset event logic
-  m_isFirst = true;
 }
 
-bool gem::readout::GEMDataParker::VFATfillData(int const& islot, AMCGEBData&  geb)
+bool gem::readout::GEMDataParker::VFATfillData(int const& islot, AMCGEBData&  geb, size_t const& nVFATs)
 {
   // Chamber Header, Zero Suppression flags, Chamber ID
+  // the ZSFlag and sumVFAT are filled in by the serializer when zero suppressing
   uint64_t ZSFlag  = 0x0;                    // :24
   uint64_t ChamID  = 0xffffffffffffffff & (0b00011111);                  // :5
-  uint64_t sumVFAT = int(3*int(geb.vfats.size()));  // :11
+  uint64_t sumVFAT = int(3*int(nVFATs));     // :11
   geb.header  = (ZSFlag << 40)|(ChamID << 35)|(sumVFAT << 23);
   ZSFlag =  (0xffffff0000000000 & geb.header) >> 40;
   ChamID =  (0x000000fff0000000 & geb.header) >> 28;
@@ -428,57 +367,19 @@ bool gem::readout::GEMDataParker::VFATfillData(int const& islot, AMCGEBData&  ge
 }// end VFATfillData
 
 
-void gem::readout::GEMDataParker::writeGEMevent(std::string  outFile, bool const&  OKprint,
+void gem::readout::GEMDataParker::writeGEMevent(gem::readout::GEMEventWriter& outFile, bool const&  OKprint,
                                                 std::string const& TypeDataFlag,
-                                                AMCGEMData&  gem, AMCGEBData&  geb, AMCVFATData& vfat)
+                                                AMCGEMData&  gem, AMCGEBData&  geb,
+                                                GEMVFATPayloads const& vfats)
 {
   if(OKprint) {
     DEBUG(" ::writeGEMevent m_vfat " << m_vfat << " event " << m_event << " sumVFAT " << (0x000000000fffffff & geb.header) <<
-          " geb.vfats.size " << int(geb.vfats.size()) );
-  }
-  // GEM Chamber's Data
-  if (m_outputType == "Hex") {
-    GEMDataAMCformat::writeGEMhd1 (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMhd2 (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMhd3 (outFile, m_event, gem);
-  } else {
-    GEMDataAMCformat::writeGEMhd1Binary (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMhd2Binary (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMhd3Binary (outFile, m_event, gem);
-  }
-  //  GEB Headers Data
-  if (m_outputType == "Hex") {
-    GEMDataAMCformat::writeGEBheader (outFile, m_event, geb);
-    GEMDataAMCformat::writeGEBrunhed (outFile, m_event, geb);
-  } else {
-    GEMDataAMCformat::writeGEBheaderBinary (outFile, m_event, geb);
-    //GEMDataAMCformat::writeGEBrunhedBinary (outFile, m_event, geb);
-  } // GEMDataAMCformat::printGEBheader (m_event, geb);
-  //  GEB PayLoad Data
-  int nChip=0;
-  for (auto iVFAT=geb.vfats.begin(); iVFAT != geb.vfats.end(); ++iVFAT) {
-    nChip++;
-
-    if (m_outputType == "Hex") {
-      GEMDataAMCformat::writeVFATdata (outFile, nChip, *iVFAT);
-    } else {
-      GEMDataAMCformat::writeVFATdataBinary (outFile, nChip, *iVFAT);
-    };
-  }//end of GEB PayLoad Data
-  //  GEB Trailers Data
-  if (m_outputType == "Hex") {
-    GEMDataAMCformat::writeGEBtrailer (outFile, m_event, geb);
-  } else {
-    GEMDataAMCformat::writeGEBtrailerBinary (outFile, m_event, geb);
-  }
-  //  GEM Trailers Data
-  if (m_outputType == "Hex") {
-    GEMDataAMCformat::writeGEMtr2 (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMtr1 (outFile, m_event, gem);
-  } else {
-    GEMDataAMCformat::writeGEMtr2Binary (outFile, m_event, gem);
-    GEMDataAMCformat::writeGEMtr1Binary (outFile, m_event, gem);
+          " vfats.size " << int(vfats.size()) );
   }
+  // the whole event is laid out and written in one go, in the format chosen at construction
+  if (!m_serializer.write(outFile, gem, geb, vfats))
+    WARN(" ::writeGEMevent unable to write " << TypeDataFlag << " event " << m_event
+         << " to " << outFile.getFileName());
 }
 
 void gem::readout::GEMDataParker::GEMfillHeaders(uint32_t const& event, uint32_t const& DAVCount_,
@@ -518,6 +419,8 @@ void gem::readout::GEMDataParker::GEMfillHeaders(uint32_t const& event, uint32_t
   OrN      =  (0x00000000ffff0000 & gem.header2) >> 16;
   BoardID  =  (0x000000000000ffff & gem.header2);
 
+  DEBUG(" ::GEMfillHeaders User 0x" << std::hex << User << " OrN 0x" << OrN << " BoardID 0x" << BoardID << std::dec);
+
   // GEM Event Headers [3]
   uint64_t DAVList     = BOOST_BINARY( 1 );    // :24
   uint64_t BufStat     = BOOST_BINARY( 1 );    // :24
@@ -578,69 +481,27 @@ void gem::readout::GEMDataParker::GEMfillTrailers(AMCGEMData&  gem,AMCGEBData&
   DEBUG(" OHcrc 0x" << std::hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << std::dec);
 }
 
-void gem::readout::GEMDataParker::readVFATblock(std::queue<uint32_t>& dataque)
+bool gem::readout::GEMDataParker::readVFATblock(gem::readout::GEMReadoutBuffer& buffer,
+                                                AMCVFATData& vfat)
 {
-  uint32_t datafront = 0;
-  for (int iQue = 0; iQue < 7; iQue++){
-    datafront = dataque.front();
-    DEBUG(" ::GEMEventMaker iQue " << iQue << " 0x"
-          << std::setfill('0') << std::setw(8) << std::hex << datafront << std::dec );
-    //this never seems to get reset? maybe iQue%7 to read the words after the first block?
-    if ((iQue%7) == 5 ) {
-      dat41   = ((0xffff0000 & datafront) >> 16 );
-      vfatcrc = (0x0000ffff & datafront);
-    } else if ( (iQue%7) == 4 ) {
-      dat40   = ((0x0000ffff & datafront) << 16 );
-      dat31   = ((0xffff0000 & datafront) >> 16 );
-    } else if ( (iQue%7) == 3 ) {
-      dat21   = ((0xffff0000 & datafront) >> 16 );
-      dat30   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 2 ) {
-      dat11   = ((0xffff0000 & datafront) >> 16 );
-      dat20   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 1 ) {
-      b1110   = ((0xf0000000 & datafront) >> 28 );
-      chipid  = ((0x0fff0000 & datafront) >> 16 );
-      dat10   = ((0x0000ffff & datafront) << 16 );
-    } else if ( (iQue%7) == 0 ) {
-      b1010   = ((0xf0000000 & datafront) >> 28 );
-      b1100   = ((0x0000f000 & datafront) >> 12 );
-      bcn     = ((0x0fff0000 & datafront) >> 16 );
-      evn     = ((0x00000ff0 & datafront) >>  4 );
-      flags   = (0x0000000f & datafront);
-
-      if (!(b1010 == 0xa && b1100 == 0xc)) {
-        bool misAligned_ = true;
-        while ((misAligned_) && (dataque.size()>7)){
-          /* we have a misaligned word, increment misalignment counter, pop queue,
-             push bad value into some form of storage for later analysis?
-             then continue with the loop, but without incrementing iQue so we hopefully
-             eventually align again
-
-             Do not go through all the loop with condition statements
-             since iQue stays the same and we removed 7 blocks
-             -MD
-          */
-          INFO(" ::GEMEventMaker found misaligned word 0x"
-               << std::setfill('0') << std::hex << datafront << std::dec
-               << " queue m_dataque.size " << dataque.size() );
-          dataque.pop();
-          datafront = dataque.front();
-          b1010   = ((0xf0000000 & datafront) >> 28 );
-          b1100   = ((0x0000f000 & datafront) >> 12 );
-          bcn     = ((0x0fff0000 & datafront) >> 16 );
-          evn     = ((0x00000ff0 & datafront) >>  4 );
-          flags   = (0x0000000f & datafront);
-          if ((b1010 == 0xa && b1100 == 0xc)) { misAligned_ = false;}
-        }// end of while misaligned
-      }
-    } else if ( (iQue%7) == 6 ) {
-      BX      = datafront;
-    }
-    DEBUG(" ::GEMEventMaker (pre pop) m_dataque.size " << dataque.size() );
-    dataque.pop();
-    DEBUG(" ::GEMEventMaker (post pop)  m_dataque.size " << dataque.size() );
-  }// end queue
+  // a block starts with the 1010 and 1100 markers followed by the 1110 marker,
+  // skip to the first one, complete or not
+  size_t skip = gem::readout::GEMVFATDecoder::findBlockStart(buffer.data(), buffer.size());
+  if (skip > 0) {
+    DEBUG(" ::readVFATblock skipped " << skip << " misaligned words, buffer size " << buffer.size());
+    buffer.consume(skip);
+  }
+
+  if (buffer.size() < 7) {
+    // the start of a block whose remaining words are still to be read stays in the buffer
+    return false;
+  }
+
+  // decode the block in place
+  gem::readout::GEMVFATDecoder::decode(buffer.data(), vfat);
+
+  buffer.consume(7);
+  return true;
 }
 
 
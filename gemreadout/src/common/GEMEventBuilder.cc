@@ -0,0 +1,170 @@
+/**
+ * class: GEMEventBuilder
+ * description: Groups the VFAT blocks read from the links into events by
+ *              their event selector, tolerating out of order blocks
+ */
+
+#include "gem/readout/GEMEventBuilder.h"
+
+#include <sys/time.h>
+
+#include "gem/readout/GEMVFATDecoder.h"
+
+const size_t gem::readout::GEMEventBuilder::kDEFAULT_MAX_VFATS;
+const size_t gem::readout::GEMEventBuilder::kDEFAULT_MAX_ERRS;
+
+gem::readout::GEMEventBuilder::GEMEventBuilder(size_t const& window, uint32_t const& timeoutMsec,
+                                               size_t const& expectedVFATs) :
+  m_window(1),
+  m_timeoutUsec(0),
+  m_expectedVFATs(expectedVFATs),
+  m_timeoutCount(0),
+  m_overflowCount(0)
+{
+  setWindow(window);
+  setTimeout(timeoutMsec);
+}
+
+gem::readout::GEMEventBuilder::~GEMEventBuilder()
+{
+  for (auto event = m_events.begin(); event != m_events.end(); ++event)
+    delete *event;
+  m_events.clear();
+}
+
+void gem::readout::GEMEventBuilder::add(GEMDataAMCformat::VFATData const& vfat, bool const& isError)
+{
+  uint32_t const ES = GEMVFATDecoder::eventSelector(vfat);
+
+  Event* event = NULL;
+  auto open = m_open.find(ES);
+  if (open != m_open.end()) {
+    event = open->second;
+  } else {
+    // make room first, so the window is never exceeded
+    if (m_open.size() >= m_window)
+      for (auto oldest = m_order.begin(); oldest != m_order.end(); ++oldest)
+        if (!(*oldest)->closed) {
+          close(*oldest, false);
+          break;
+        }
+    event = newEvent(ES);
+  }
+
+  if (isError) {
+    if (event->erros.size() < kDEFAULT_MAX_ERRS)
+      event->erros.push_back(vfat);
+    else
+      ++m_overflowCount;
+  } else {
+    if (event->vfats.size() < kDEFAULT_MAX_VFATS)
+      event->vfats.push_back(vfat);
+    else
+      ++m_overflowCount;
+    if (m_expectedVFATs > 0 && event->vfats.size() >= m_expectedVFATs)
+      close(event, false);
+  }
+}
+
+bool gem::readout::GEMEventBuilder::pop(Event*& event)
+{
+  if (m_order.empty() || !m_order.front()->closed)
+    return false;
+  event = m_order.front();
+  m_order.pop_front();
+  return true;
+}
+
+void gem::readout::GEMEventBuilder::recycle(Event* event)
+{
+  if (event == NULL)
+    return;
+  event->vfats.clear();
+  event->erros.clear();
+  m_free.push_back(event);
+}
+
+void gem::readout::GEMEventBuilder::expire()
+{
+  if (m_timeoutUsec == 0 || m_open.empty())
+    return;
+
+  // events are opened in order, so only the oldest ones can have timed out
+  uint64_t const now = nowUsec();
+  for (auto event = m_order.begin(); event != m_order.end(); ++event) {
+    if ((*event)->closed)
+      continue;
+    if (now - (*event)->openUsec < m_timeoutUsec)
+      break;
+    close(*event, true);
+  }
+}
+
+void gem::readout::GEMEventBuilder::flush()
+{
+  for (auto event = m_order.begin(); event != m_order.end(); ++event)
+    if (!(*event)->closed)
+      close(*event, false);
+}
+
+void gem::readout::GEMEventBuilder::clear()
+{
+  while (!m_order.empty()) {
+    recycle(m_order.front());
+    m_order.pop_front();
+  }
+  m_open.clear();
+  m_timeoutCount  = 0;
+  m_overflowCount = 0;
+}
+
+size_t gem::readout::GEMEventBuilder::getOpenVFATs() const
+{
+  size_t nVFATs = 0;
+  for (auto event = m_open.begin(); event != m_open.end(); ++event)
+    nVFATs += event->second->vfats.size();
+  return nVFATs;
+}
+
+size_t gem::readout::GEMEventBuilder::getOpenErrors() const
+{
+  size_t nErrors = 0;
+  for (auto event = m_open.begin(); event != m_open.end(); ++event)
+    nErrors += event->second->erros.size();
+  return nErrors;
+}
+
+gem::readout::GEMEventBuilder::Event* gem::readout::GEMEventBuilder::newEvent(uint32_t const& ES)
+{
+  Event* event = NULL;
+  if (!m_free.empty()) {
+    event = m_free.back();
+    m_free.pop_back();
+  } else {
+    event = new Event();
+    m_events.push_back(event);
+  }
+  event->ES       = ES;
+  event->openUsec = m_timeoutUsec > 0 ? nowUsec() : 0;
+  event->closed   = false;
+  event->timedOut = false;
+  m_open[ES] = event;
+  m_order.push_back(event);
+  return event;
+}
+
+void gem::readout::GEMEventBuilder::close(Event* event, bool const& timedOut)
+{
+  event->closed   = true;
+  event->timedOut = timedOut;
+  if (timedOut)
+    ++m_timeoutCount;
+  m_open.erase(event->ES);
+}
+
+uint64_t gem::readout::GEMEventBuilder::nowUsec()
+{
+  struct timeval now;
+  gettimeofday(&now, 0);
+  return static_cast<uint64_t>(now.tv_sec)*1000000 + now.tv_usec;
+}
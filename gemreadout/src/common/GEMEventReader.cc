@@ -0,0 +1,334 @@
+/**
+ * class: GEMEventReader
+ * description: Maps a binary run file in memory and indexes its events, for
+ *              random access by event number and lazy decoding of the VFAT blocks
+ */
+
+#include "gem/readout/GEMEventReader.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gem/readout/GEMEventSerializer.h"
+
+const uint64_t gem::readout::GEMEventReader::kINDEX_MAGIC = 0x31305844494d4547ULL;  // "GEMIDX01" in the file
+
+namespace {
+  // header words of the sidecar index: magic, size of the run file, events, skipped words
+  const size_t kINDEX_HEADER_WORDS = 4;
+
+  // the smallest event, without VFAT blocks
+  const size_t kMIN_EVENT_WORDS = gem::readout::GEMEventSerializer::kN_FRAME_HEADERS
+    + gem::readout::GEMEventSerializer::kN_PAYLOAD_WORDS + gem::readout::GEMEventSerializer::kN_FRAME_TRAILERS;
+
+  // blocks start after the GEB header
+  const size_t kFIRST_BLOCK = gem::readout::GEMEventSerializer::kN_FRAME_HEADERS + 4;
+
+  bool isCDFHeader(uint64_t const& word)  { return (word >> 60) == 0x5; }
+  bool isCDFTrailer(uint64_t const& word) { return (word >> 60) == 0xa; }
+
+  // words of a block of a sparse encoded event
+  size_t sparseWords(uint64_t const* block)
+  {
+    unsigned const nStrips = block[1] >> 56;
+    return nStrips == gem::readout::GEMEventSerializer::kDENSE_STRIPS ? 4
+      : gem::readout::GEMEventSerializer::sparseBlockWords(nStrips);
+  }
+}
+
+bool gem::readout::GEMEventReader::Event::isSparse() const
+{
+  return gebHeader() & GEMEventSerializer::kGEB_SPARSE;
+}
+
+size_t gem::readout::GEMEventReader::Event::nVFATs() const
+{
+  if (!isSparse())
+    return (m_nWords - kMIN_EVENT_WORDS)/GEMEventSerializer::kN_VFAT_WORDS;
+
+  size_t n = 0;
+  for (uint64_t const* block = p_words + kFIRST_BLOCK; block + 1 < blocksEnd(); block += sparseWords(block))
+    ++n;
+  return n;
+}
+
+uint64_t const* gem::readout::GEMEventReader::Event::sparseBlock(size_t const& i) const
+{
+  uint64_t const* block = p_words + kFIRST_BLOCK;
+  for (size_t n = 0; n < i && block + 1 < blocksEnd(); ++n)
+    block += sparseWords(block);
+  return block;
+}
+
+void gem::readout::GEMEventReader::Event::decodeSparse(uint64_t const* block, GEMDataAMCformat::VFATData& vfat)
+{
+  uint64_t const w1 = block[0];
+  vfat.BC     = w1 >> 48;
+  vfat.EC     = w1 >> 32;
+  vfat.ChipID = w1 >> 16;
+  vfat.crc    = w1;
+  vfat.BXfrOH = 0;
+
+  unsigned const nStrips = block[1] >> 56;
+  if (nStrips == GEMEventSerializer::kDENSE_STRIPS) {
+    vfat.msData = block[2];
+    vfat.lsData = block[3];
+    return;
+  }
+  // strip numbers follow the count, a byte each
+  uint64_t data[2] = {0, 0};
+  for (unsigned s = 0; s < nStrips; ++s) {
+    unsigned const byte  = s + 1;
+    unsigned const strip = (block[1 + byte/8] >> (56 - 8*(byte%8))) & 0x7f;
+    data[strip/64] |= 0x1ULL << (strip%64);
+  }
+  vfat.lsData = data[0];
+  vfat.msData = data[1];
+}
+
+void gem::readout::GEMEventReader::Event::getVFAT(size_t const& i, GEMDataAMCformat::VFATData& vfat) const
+{
+  if (isSparse()) {
+    decodeSparse(sparseBlock(i), vfat);
+    return;
+  }
+
+  uint64_t const* block = p_words + kFIRST_BLOCK + GEMEventSerializer::kN_VFAT_WORDS*i;
+  uint64_t const w1 = block[0];
+  uint64_t const w2 = block[1];
+  uint64_t const w3 = block[2];
+  vfat.BC     = w1 >> 48;
+  vfat.EC     = w1 >> 32;
+  vfat.ChipID = w1 >> 16;
+  vfat.msData = (w1 << 48) | (w2 >> 16);
+  vfat.lsData = (w2 << 48) | (w3 >> 16);
+  vfat.crc    = w3;
+  vfat.BXfrOH = 0;
+}
+
+void gem::readout::GEMEventReader::Event::getVFATs(GEMVFATPayloads& vfats) const
+{
+  size_t const nBlocks = nVFATs();
+  vfats.clear();
+  vfats.reserve(nBlocks);
+  GEMDataAMCformat::VFATData vfat;
+  if (isSparse()) {
+    // the blocks are walked once rather than from the start for every block
+    uint64_t const* block = p_words + kFIRST_BLOCK;
+    for (size_t i = 0; i < nBlocks; ++i, block += sparseWords(block)) {
+      decodeSparse(block, vfat);
+      vfats.push_back(vfat);
+    }
+    return;
+  }
+  for (size_t i = 0; i < nBlocks; ++i) {
+    getVFAT(i, vfat);
+    vfats.push_back(vfat);
+  }
+}
+
+void gem::readout::GEMEventReader::Event::getHeaders(GEMDataAMCformat::GEMData& gem,
+                                                     GEMDataAMCformat::GEBData& geb) const
+{
+  gem.header1  = header1();
+  gem.header2  = header2();
+  gem.header3  = header3();
+  gem.trailer2 = trailer2();
+  gem.trailer1 = trailer1();
+  geb.header   = gebHeader();
+  geb.runhed   = 0;
+  geb.trailer  = gebTrailer();
+}
+
+gem::readout::GEMEventReader::GEMEventReader() :
+  m_gemLogger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMEventReader"))),
+  m_fileName(""),
+  m_fd(-1),
+  m_fileSize(0),
+  p_data(NULL),
+  m_nWords(0),
+  m_skippedWords(0),
+  m_indexLoaded(false)
+{
+}
+
+gem::readout::GEMEventReader::~GEMEventReader()
+{
+  close();
+}
+
+bool gem::readout::GEMEventReader::open(std::string const& fileName, bool const& useIndexFile)
+{
+  if (isOpen())
+    close();
+
+  m_fileName = fileName;
+  m_fd = ::open(m_fileName.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    ERROR("GEMEventReader::open unable to open " << m_fileName << ": " << strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    ERROR("GEMEventReader::open unable to stat " << m_fileName << ": " << strerror(errno));
+    close();
+    return false;
+  }
+  m_fileSize = st.st_size;
+  m_nWords   = m_fileSize/sizeof(uint64_t);
+
+  if (m_fileSize > 0) {
+    void* data = mmap(NULL, m_fileSize, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+      ERROR("GEMEventReader::open unable to map " << m_fileName << ": " << strerror(errno));
+      close();
+      return false;
+    }
+    p_data = static_cast<uint64_t const*>(data);
+  }
+
+  std::string const indexName = m_fileName + ".idx";
+  if (useIndexFile && loadIndex(indexName)) {
+    m_indexLoaded = true;
+  } else {
+    buildIndex();
+    if (useIndexFile && !saveIndex(indexName))
+      WARN("GEMEventReader::open unable to write the index " << indexName);
+  }
+
+  INFO("GEMEventReader::open " << m_fileName << " " << m_offsets.size() << " events"
+       << (m_indexLoaded ? " from the index" : "") << ", skipped words " << m_skippedWords);
+  return true;
+}
+
+void gem::readout::GEMEventReader::close()
+{
+  if (p_data)
+    munmap(const_cast<uint64_t*>(p_data), m_fileSize);
+  p_data = NULL;
+  if (m_fd >= 0)
+    ::close(m_fd);
+  m_fd = -1;
+  m_fileSize = 0;
+  m_nWords   = 0;
+  m_offsets.clear();
+  m_lengths.clear();
+  m_skippedWords = 0;
+  m_indexLoaded  = false;
+}
+
+void gem::readout::GEMEventReader::buildIndex()
+{
+  m_offsets.clear();
+  m_lengths.clear();
+  m_skippedWords = 0;
+  if (!p_data)
+    return;
+
+  // the whole file is walked once, front to back
+  madvise(const_cast<uint64_t*>(p_data), m_fileSize, MADV_SEQUENTIAL);
+
+  size_t offset = 0;
+  while (offset < m_nWords) {
+    size_t const nWords = eventLength(offset);
+    if (nWords == 0) {
+      // not an event, look for the next CDF header
+      ++m_skippedWords;
+      ++offset;
+      continue;
+    }
+    m_offsets.push_back(offset);
+    m_lengths.push_back(nWords);
+    offset += nWords;
+  }
+
+  madvise(const_cast<uint64_t*>(p_data), m_fileSize, MADV_NORMAL);
+}
+
+size_t gem::readout::GEMEventReader::eventLength(size_t const& offset) const
+{
+  if (offset + kMIN_EVENT_WORDS > m_nWords || !isCDFHeader(p_data[offset]))
+    return 0;
+
+  size_t const nFrame = GEMEventSerializer::kN_FRAME_HEADERS + GEMEventSerializer::kN_FRAME_TRAILERS;
+
+  // the AMC size covers the whole GEM payload
+  size_t const amcSize = (p_data[offset + 2] >> 32) & 0xffffff;
+  size_t nWords = nFrame + amcSize;
+  if (amcSize >= GEMEventSerializer::kN_PAYLOAD_WORDS && offset + nWords <= m_nWords
+      && isCDFTrailer(p_data[offset + nWords - 1]))
+    return nWords;
+
+  // files written before the AMC size was filled in, the GEB header holds the number of VFAT words
+  uint64_t const gebHeader = p_data[offset + GEMEventSerializer::kN_FRAME_HEADERS + 3];
+  nWords = kMIN_EVENT_WORDS + ((gebHeader >> 23) & 0x7ff);
+  if (offset + nWords <= m_nWords && isCDFTrailer(p_data[offset + nWords - 1]))
+    return nWords;
+
+  return 0;
+}
+
+bool gem::readout::GEMEventReader::loadIndex(std::string const& indexName)
+{
+  int fd = ::open(indexName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  uint64_t header[kINDEX_HEADER_WORDS];
+  bool ok = ::read(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header))
+    && header[0] == kINDEX_MAGIC && header[1] == m_fileSize;
+  if (ok) {
+    size_t const nEvents = header[2];
+    m_offsets.resize(nEvents);
+    m_lengths.resize(nEvents);
+    if (nEvents > 0) {
+      ssize_t const offsetBytes = nEvents*sizeof(uint64_t);
+      ssize_t const lengthBytes = nEvents*sizeof(uint32_t);
+      ok = ::read(fd, &m_offsets[0], offsetBytes) == offsetBytes
+        && ::read(fd, &m_lengths[0], lengthBytes) == lengthBytes;
+    }
+    m_skippedWords = header[3];
+  }
+  ::close(fd);
+
+  // an index that does not fit the file is rebuilt
+  for (size_t i = 0; ok && i < m_offsets.size(); ++i)
+    ok = m_offsets[i] + m_lengths[i] <= m_nWords;
+  if (!ok) {
+    m_offsets.clear();
+    m_lengths.clear();
+    m_skippedWords = 0;
+  }
+  return ok;
+}
+
+bool gem::readout::GEMEventReader::saveIndex(std::string const& indexName) const
+{
+  // written aside and renamed, so a reader never sees a partial index
+  std::string const tmpName = indexName + ".tmp";
+  int fd = ::open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  uint64_t const header[kINDEX_HEADER_WORDS] = {kINDEX_MAGIC, m_fileSize, m_offsets.size(), m_skippedWords};
+  bool ok = ::write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header));
+  if (ok && !m_offsets.empty()) {
+    ssize_t const offsetBytes = m_offsets.size()*sizeof(uint64_t);
+    ssize_t const lengthBytes = m_lengths.size()*sizeof(uint32_t);
+    ok = ::write(fd, &m_offsets[0], offsetBytes) == offsetBytes
+      && ::write(fd, &m_lengths[0], lengthBytes) == lengthBytes;
+  }
+  ok = (::close(fd) == 0) && ok;
+
+  if (ok)
+    ok = rename(tmpName.c_str(), indexName.c_str()) == 0;
+  if (!ok)
+    unlink(tmpName.c_str());
+  return ok;
+}
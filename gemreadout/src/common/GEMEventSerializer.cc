@@ -0,0 +1,271 @@
+/**
+ * class: GEMEventSerializer
+ * description: Lays out a whole event, with its CDF and AMC13 framing,
+ *              lengths and CRCs, in a contiguous buffer written in one go
+ */
+
+#include "gem/readout/GEMEventSerializer.h"
+
+#include "gem/readout/GEMHexCodec.h"
+
+const size_t gem::readout::GEMEventSerializer::kN_FRAME_HEADERS;
+const size_t gem::readout::GEMEventSerializer::kN_FRAME_TRAILERS;
+const size_t gem::readout::GEMEventSerializer::kN_PAYLOAD_WORDS;
+const size_t gem::readout::GEMEventSerializer::kN_VFAT_WORDS;
+const size_t gem::readout::GEMEventSerializer::kN_ZS_SLOTS;
+const unsigned gem::readout::GEMEventSerializer::kDENSE_STRIPS;
+const uint64_t gem::readout::GEMEventSerializer::kGEB_SPARSE = 0x1ULL << 22;
+
+namespace {
+  const uint64_t kCDF_EVT_TY  = 0x1;   // physics trigger
+  const uint64_t kAMC13_UFOV  = 0x0;
+  const uint64_t kAMC_STATUS  = 0x9e;  // L, E(nabled), P(resent), V(alid), C(RC ok)
+  const uint64_t kBLOCK_NO    = 0x0;   // events are never segmented in several blocks
+
+  const uint64_t kGEB_ZSFLAG  = 0xffffffULL << 40;
+  const uint64_t kGEB_SUMVFAT = 0x7ffULL << 23;
+}
+
+uint32_t gem::readout::GEMEventSerializer::s_crc32Table[256];
+uint16_t gem::readout::GEMEventSerializer::s_crc16Table[256];
+bool     gem::readout::GEMEventSerializer::s_crcTablesFilled = gem::readout::GEMEventSerializer::fillCRCTables();
+
+gem::readout::GEMEventSerializer::GEMEventSerializer(OutputType const& outputType) :
+  m_outputType(outputType),
+  m_serialize(&GEMEventSerializer::serializeBinary),
+  m_sourceID(0),
+  m_zeroSuppress(false),
+  m_sparseMaxStrips(0),
+  p_data(NULL),
+  m_nBytes(0)
+{
+  setOutputType(outputType);
+  // room for a full chamber, hex lines are 17 bytes
+  m_words.reserve(kN_FRAME_HEADERS + kN_PAYLOAD_WORDS + 1
+                  + (kN_VFAT_WORDS+1)*GEMVFATPayloads::kDEFAULT_CAPACITY + kN_FRAME_TRAILERS);
+  m_hex.reserve(GEMHexCodec::kLINE_SIZE*m_words.capacity());
+  m_kept.reserve(GEMVFATPayloads::kDEFAULT_CAPACITY);
+  m_nStrips.reserve(GEMVFATPayloads::kDEFAULT_CAPACITY);
+}
+
+void gem::readout::GEMEventSerializer::setOutputType(OutputType const& outputType)
+{
+  m_outputType = outputType;
+  m_serialize  = (outputType == HEX) ? &GEMEventSerializer::serializeHex : &GEMEventSerializer::serializeBinary;
+}
+
+bool gem::readout::GEMEventSerializer::write(GEMEventWriter& outFile, GEMDataAMCformat::GEMData& gem,
+                                             GEMDataAMCformat::GEBData const& geb, GEMVFATPayloads const& vfats)
+{
+  if (!outFile.isOpen())
+    return false;
+  (this->*m_serialize)(gem, geb, vfats);
+  bool const written = outFile.write(p_data, m_nBytes);
+  outFile.endEvent();
+  return written;
+}
+
+uint32_t gem::readout::GEMEventSerializer::crc32(uint64_t const* words, size_t const& nWords)
+{
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < nWords; ++i) {
+    uint64_t const word = words[i];
+    // bytes in the order they are in the file
+    for (unsigned byte = 0; byte < 8; ++byte)
+      crc = (crc >> 8) ^ s_crc32Table[(crc ^ (word >> (8*byte))) & 0xff];
+  }
+  return ~crc;
+}
+
+uint16_t gem::readout::GEMEventSerializer::crc16(uint64_t const* words, size_t const& nWords)
+{
+  uint16_t crc = 0xffff;
+  for (size_t i = 0; i < nWords; ++i) {
+    uint64_t const word = words[i];
+    // most significant byte first, as the FED CRC is defined on the 64 bit words
+    for (int byte = 7; byte >= 0; --byte)
+      crc = (crc << 8) ^ s_crc16Table[((crc >> 8) ^ (word >> (8*byte))) & 0xff];
+  }
+  return crc;
+}
+
+size_t gem::readout::GEMEventSerializer::layoutPayload(size_t const& start, bool const& hex,
+                                                       GEMDataAMCformat::GEMData& gem,
+                                                       GEMDataAMCformat::GEBData const& geb,
+                                                       GEMVFATPayloads const& vfats)
+{
+  uint16_t const* BC     = vfats.BC();
+  uint16_t const* EC     = vfats.EC();
+  uint16_t const* ChipID = vfats.ChipID();
+  uint64_t const* lsData = vfats.lsData();
+  uint64_t const* msData = vfats.msData();
+  uint32_t const* BXfrOH = vfats.BXfrOH();
+  uint16_t const* crc    = vfats.crc();
+
+  // without zero suppression nor strip lists all blocks are written as they are
+  bool const sparseAllowed = !hex && m_sparseMaxStrips > 0;
+  bool const selecting     = m_zeroSuppress || sparseAllowed;
+  uint64_t   gebHeader     = geb.header;
+  bool       sparse        = false;
+  size_t     nVFATs        = vfats.size();
+  size_t     nVFATWords    = kN_VFAT_WORDS*nVFATs;
+  if (selecting) {
+    uint64_t zsFlag = 0;
+    size_t sparseWords = 0;
+    m_kept.clear();
+    m_nStrips.clear();
+    for (size_t i = 0; i < vfats.size(); ++i) {
+      unsigned const nStrips = __builtin_popcountll(lsData[i]) + __builtin_popcountll(msData[i]);
+      if (m_zeroSuppress && nStrips == 0 && i < kN_ZS_SLOTS) {
+        zsFlag |= 0x1ULL << (kN_ZS_SLOTS-1 - i);
+        continue;
+      }
+      m_kept.push_back(i);
+      m_nStrips.push_back(nStrips);
+      sparseWords += (nStrips <= m_sparseMaxStrips) ? sparseBlockWords(nStrips) : 2 + 2;
+    }
+    nVFATs     = m_kept.size();
+    sparse     = sparseAllowed && sparseWords < kN_VFAT_WORDS*nVFATs;
+    nVFATWords = sparse ? sparseWords : kN_VFAT_WORDS*nVFATs;
+    gebHeader  = (gebHeader & ~(kGEB_ZSFLAG | kGEB_SUMVFAT | kGEB_SPARSE))
+      | (zsFlag << 40) | ((nVFATWords & 0x7ff) << 23) | (sparse ? kGEB_SPARSE : 0);
+  }
+  size_t const nPayload = kN_PAYLOAD_WORDS + (hex ? 1 + (kN_VFAT_WORDS+1)*nVFATs : nVFATWords);
+
+  // header1 DataLgth:20 and trailer1 LV1IDT:8 DataLgth:20 are known before anything is laid out
+  uint64_t const LV1ID = (gem.header1 >> 32) & 0xffffff;
+  gem.header1  = (gem.header1  & ~0x00000000000fffffULL) | (nPayload & 0xfffff);
+  gem.trailer1 = (gem.trailer1 & ~0x00000000ffffffffULL) | ((LV1ID & 0xff) << 24) | (nPayload & 0xfffff);
+
+  m_words.resize(start + nPayload);
+  uint64_t* word = &m_words[start];
+
+  *word++ = gem.header1;
+  *word++ = gem.header2;
+  *word++ = gem.header3;
+  *word++ = gebHeader;
+  if (hex)
+    *word++ = geb.runhed;
+
+  for (size_t k = 0; k < nVFATs; ++k) {
+    size_t const i = selecting ? m_kept[k] : k;
+    if (sparse) {
+      *word++ = (static_cast<uint64_t>(BC[i]) << 48) | (static_cast<uint64_t>(EC[i]) << 32)
+        | (static_cast<uint64_t>(ChipID[i]) << 16) | crc[i];
+      if (m_nStrips[k] <= m_sparseMaxStrips) {
+        word = layoutSparse(word, m_nStrips[k], msData[i], lsData[i]);
+      } else {
+        *word++ = static_cast<uint64_t>(kDENSE_STRIPS) << 56;
+        *word++ = msData[i];
+        *word++ = lsData[i];
+      }
+      continue;
+    }
+    *word++ = (static_cast<uint64_t>(BC[i]) << 48) | (static_cast<uint64_t>(EC[i]) << 32)
+      | (static_cast<uint64_t>(ChipID[i]) << 16) | (msData[i] >> 48);
+    *word++ = (msData[i] << 16) | (lsData[i] >> 48);
+    *word++ = (lsData[i] << 16) | crc[i];
+    if (hex)
+      *word++ = BXfrOH[i];
+  }
+
+  *word++ = geb.trailer;
+  *word++ = gem.trailer2;
+
+  // trailer1 crc:32 covers the payload up to trailer2
+  gem.trailer1 = (gem.trailer1 & 0x00000000ffffffffULL)
+    | (static_cast<uint64_t>(crc32(&m_words[start], nPayload - 1)) << 32);
+  *word++ = gem.trailer1;
+
+  return nPayload;
+}
+
+uint64_t* gem::readout::GEMEventSerializer::layoutSparse(uint64_t* word, unsigned const& nStrips,
+                                                         uint64_t const& msData, uint64_t const& lsData)
+{
+  // the strip numbers fill the bytes after the count, from the most significant one
+  uint64_t packed = static_cast<uint64_t>(nStrips) << 56;
+  int shift = 48;
+  uint64_t const data[2] = {lsData, msData};
+  for (unsigned half = 0; half < 2; ++half) {
+    uint64_t bits = data[half];
+    while (bits) {
+      uint64_t const strip = 64*half + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      packed |= strip << shift;
+      shift -= 8;
+      if (shift < 0) {
+        *word++ = packed;
+        packed  = 0;
+        shift   = 56;
+      }
+    }
+  }
+  // a partly filled last word, or the count alone
+  if (shift != 56)
+    *word++ = packed;
+  return word;
+}
+
+void gem::readout::GEMEventSerializer::serializeBinary(GEMDataAMCformat::GEMData& gem,
+                                                       GEMDataAMCformat::GEBData const& geb,
+                                                       GEMVFATPayloads const& vfats)
+{
+  size_t const nPayload = layoutPayload(kN_FRAME_HEADERS, false, gem, geb, vfats);
+  size_t const nWords   = kN_FRAME_HEADERS + nPayload + kN_FRAME_TRAILERS;
+  m_words.resize(nWords);
+
+  uint64_t const LV1ID = (gem.header1 >> 32) & 0xffffff;
+  uint64_t const BXID  = (gem.header1 >> 20) & 0xfff;
+  uint64_t const OrN   = (gem.header2 >> 16) & 0xffff;
+  uint64_t const AmcNo = (gem.header1 >> 60) & 0xf;
+  uint64_t const BoardID = gem.header2 & 0xffff;
+
+  // CDF header, 5:4 Evt_ty:4 LV1_id:24 BX_id:12 Source_id:12 FOV:4 H:1 x:3, no further header words
+  m_words[0] = (0x5ULL << 60) | (kCDF_EVT_TY << 56) | (LV1ID << 32) | (BXID << 20)
+    | (static_cast<uint64_t>(m_sourceID) << 8);
+  // AMC13 header, a single AMC
+  m_words[1] = (kAMC13_UFOV << 60) | (0x1ULL << 52) | (OrN << 4);
+  // AMC header, the size covers the whole GEM payload
+  m_words[2] = (kAMC_STATUS << 56) | ((nPayload & 0xffffff) << 32) | (kBLOCK_NO << 20) | (AmcNo << 16) | BoardID;
+
+  size_t const end = kN_FRAME_HEADERS + nPayload;
+  // AMC13 trailer, CRC32:32 0:4 Blk_no:8 LV1_id:8 BX_id:12
+  m_words[end] = (static_cast<uint64_t>(crc32(&m_words[kN_FRAME_HEADERS], nPayload)) << 32)
+    | (kBLOCK_NO << 20) | ((LV1ID & 0xff) << 12) | BXID;
+  // CDF trailer, a:4 0:4 Evt_lgth:24 CRC16:16 ..., the CRC is computed with its own field zero
+  m_words[end+1] = (0xaULL << 60) | ((static_cast<uint64_t>(nWords) & 0xffffff) << 32);
+  m_words[end+1] |= static_cast<uint64_t>(crc16(&m_words[0], nWords)) << 16;
+
+  p_data   = reinterpret_cast<char const*>(&m_words[0]);
+  m_nBytes = nWords*sizeof(uint64_t);
+}
+
+void gem::readout::GEMEventSerializer::serializeHex(GEMDataAMCformat::GEMData& gem,
+                                                    GEMDataAMCformat::GEBData const& geb,
+                                                    GEMVFATPayloads const& vfats)
+{
+  size_t const nWords = layoutPayload(0, true, gem, geb, vfats);
+
+  m_hex.resize(GEMHexCodec::kLINE_SIZE*nWords);
+  p_data   = &m_hex[0];
+  m_nBytes = GEMHexCodec::encode(&m_words[0], nWords, &m_hex[0]);
+}
+
+bool gem::readout::GEMEventSerializer::fillCRCTables()
+{
+  for (unsigned byte = 0; byte < 256; ++byte) {
+    // IEEE 802.3, reflected
+    uint32_t crc32 = byte;
+    for (unsigned bit = 0; bit < 8; ++bit)
+      crc32 = (crc32 & 0x1) ? ((crc32 >> 1) ^ 0xedb88320) : (crc32 >> 1);
+    s_crc32Table[byte] = crc32;
+
+    // x^16+x^15+x^2+1, not reflected
+    uint16_t crc16 = byte << 8;
+    for (unsigned bit = 0; bit < 8; ++bit)
+      crc16 = (crc16 & 0x8000) ? ((crc16 << 1) ^ 0x8005) : (crc16 << 1);
+    s_crc16Table[byte] = crc16;
+  }
+  return true;
+}
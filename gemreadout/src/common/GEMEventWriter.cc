@@ -0,0 +1,647 @@
+/**
+ * class: GEMEventWriter
+ * description: Buffered writer for the readout output files, keeps the file
+ *              open for the whole run rather than reopening for every word
+ */
+
+#include "gem/readout/GEMEventWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/falloc.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "gem/readout/GEMHexCodec.h"
+
+const size_t   gem::readout::GEMEventWriter::kDEFAULT_BUFFER_SIZE = 4*1024*1024;
+const size_t   gem::readout::GEMEventWriter::kBUFFER_ALIGNMENT    = 4096;
+const unsigned gem::readout::GEMEventWriter::kN_BUFFERS           = 4;
+const unsigned gem::readout::GEMEventWriter::kIDLE_USEC           = 100;
+const unsigned gem::readout::GEMEventWriter::kN_LATENCY_BINS;
+
+gem::readout::GEMEventWriter::GEMEventWriter(size_t const& bufferSize, bool const& writerThread) :
+  m_gemLogger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMEventWriter"))),
+  m_fileName(""),
+  m_fd(-1),
+  m_bufferSize(bufferSize),
+  p_current(NULL),
+  m_directIO(false),
+  p_staging(NULL),
+  m_stagingSize(0),
+  m_carry(0),
+  m_segmentMaxEvents(0),
+  m_segmentMaxBytes(0),
+  m_segmentMaxSeconds(0),
+  m_fsyncPolicy(FSYNC_NEVER),
+  m_segmentEvents(0),
+  m_segmentBytes(0),
+  m_segmentStart(0),
+  m_segment(0),
+  m_spareFd(-1),
+  m_segmentWritten(0),
+  m_segmentRaw(0),
+  m_segmentEventsOut(0),
+  m_segmentFirstEvent(0),
+  m_segmentOpened(0),
+  m_lastSegmentSize(0),
+  m_eventsOut(0),
+  m_writerExit(false),
+  m_writerRunning(false),
+  m_writeFailed(false),
+  m_submitted(0),
+  m_completed(0),
+  m_bytesWritten(0),
+  m_rawBytes(0),
+  m_compressUsec(0),
+  m_eventsWritten(0),
+  m_flushCount(0),
+  m_writeUsec(0),
+  m_maxWriteUsec(0),
+  m_stallCount(0)
+{
+  for (unsigned bin = 0; bin < kN_LATENCY_BINS; ++bin)
+    m_writeLatency[bin] = 0;
+
+  // round the buffer up to a whole number of pages
+  if (m_bufferSize < kBUFFER_ALIGNMENT)
+    m_bufferSize = kBUFFER_ALIGNMENT;
+  m_bufferSize = ((m_bufferSize + kBUFFER_ALIGNMENT - 1)/kBUFFER_ALIGNMENT)*kBUFFER_ALIGNMENT;
+
+  unsigned nBuffers = writerThread ? kN_BUFFERS : 1;
+  for (unsigned i = 0; i < nBuffers; ++i) {
+    void* buf = NULL;
+    if (posix_memalign(&buf, kBUFFER_ALIGNMENT, m_bufferSize) != 0) {
+      ERROR("GEMEventWriter::unable to allocate " << m_bufferSize << " bytes for the output buffer");
+      break;
+    }
+    OutputBuffer buffer = {static_cast<char*>(buf), m_bufferSize, 0, 0, 0, false};
+    m_buffers.push_back(buffer);
+  }
+
+  if (m_buffers.empty()) {
+    m_bufferSize = 0;
+    return;
+  }
+  p_current = &m_buffers[0];
+
+  if (writerThread && m_buffers.size() > 1) {
+    m_fullQueue = std::unique_ptr<gem::utils::SPSCQueue<OutputBuffer*> >(new gem::utils::SPSCQueue<OutputBuffer*>(m_buffers.size()));
+    m_freeQueue = std::unique_ptr<gem::utils::SPSCQueue<OutputBuffer*> >(new gem::utils::SPSCQueue<OutputBuffer*>(m_buffers.size()));
+    for (unsigned i = 1; i < m_buffers.size(); ++i)
+      m_freeQueue->push(&m_buffers[i]);
+    m_writerRunning = true;
+    m_writerTask = std::make_shared<gem::readout::GEMEventWriterTask>(this);
+    m_writerTask->activate();
+  }
+}
+
+gem::readout::GEMEventWriter::~GEMEventWriter()
+{
+  close();
+  if (m_writerTask) {
+    m_writerExit = true;
+    while (m_writerRunning)
+      usleep(kIDLE_USEC);
+  }
+  for (auto buffer = m_buffers.begin(); buffer != m_buffers.end(); ++buffer)
+    free(buffer->data);
+  m_buffers.clear();
+  p_current = NULL;
+  free(p_staging);
+  p_staging = NULL;
+}
+
+bool gem::readout::GEMEventWriter::open(std::string const& fileName)
+{
+  if (isOpen())
+    close();
+
+  // compressed frames and direct writes go through the staging buffer, with room for a partial block in front
+  m_carry = 0;
+  if (m_codec || m_directIO)
+    if (!growStaging((m_codec ? GEMFrameCodec::maxFrameSize(m_bufferSize) : m_bufferSize) + kBUFFER_ALIGNMENT))
+      return false;
+
+  m_fileName = fileName;
+  m_segment  = 0;
+  m_fd = openSegment(m_segment);
+  if (m_fd < 0)
+    return false;
+  if (p_current)
+    resetBuffer(*p_current);
+  m_bytesWritten  = 0;
+  m_rawBytes      = 0;
+  m_compressUsec  = 0;
+  m_eventsWritten = 0;
+  m_flushCount    = 0;
+  m_writeUsec     = 0;
+  m_maxWriteUsec  = 0;
+  m_stallCount    = 0;
+  m_writeFailed   = false;
+  for (unsigned bin = 0; bin < kN_LATENCY_BINS; ++bin)
+    m_writeLatency[bin] = 0;
+
+  m_eventsOut       = 0;
+  m_lastSegmentSize = 0;
+  m_segmentEvents   = 0;
+  m_segmentBytes    = 0;
+  m_segmentStart    = time(0);
+  startSegment();
+  if (isRotating())
+    prepareSpare();
+
+  DEBUG("GEMEventWriter::open opened " << m_fileName << " with " << m_buffers.size()
+        << " buffers of " << m_bufferSize << " bytes");
+  return true;
+}
+
+void gem::readout::GEMEventWriter::close()
+{
+  if (!isOpen())
+    return;
+
+  flush();
+  if (!writeCarry())
+    WARN("GEMEventWriter::close the last " << m_carry << " bytes of " << m_fileName << " were not written");
+  m_carry = 0;
+  closeSegment(m_fd);
+  m_fd = -1;
+  if (m_spareFd >= 0) {
+    // the next segment was never started, its file is removed unless it was there before
+    struct stat st;
+    bool const empty = fstat(m_spareFd, &st) == 0 && st.st_size == 0;
+    ::close(m_spareFd);
+    if (empty)
+      unlink(segmentName(m_fileName, m_segment+1).c_str());
+    m_spareFd = -1;
+  }
+  DEBUG("GEMEventWriter::close closed " << m_fileName << " after " << m_eventsWritten << " events in "
+        << m_segment+1 << " segments, "
+        << m_bytesWritten << " bytes in " << m_flushCount << " writes taking " << m_writeUsec << " usec, "
+        << m_stallCount << " stalls");
+}
+
+bool gem::readout::GEMEventWriter::flush()
+{
+  if (!isOpen() || p_current == NULL)
+    return false;
+
+  if (p_current->used > 0)
+    submit();
+
+  if (m_writerTask) {
+    // wait for the writer thread to catch up
+    __sync_synchronize();
+    while (m_completed != m_submitted) {
+      usleep(kIDLE_USEC);
+      __sync_synchronize();
+    }
+  }
+
+  bool ok = !m_writeFailed;
+  m_writeFailed = false;
+  return ok;
+}
+
+bool gem::readout::GEMEventWriter::write(char const* data, size_t const& nBytes)
+{
+  if (!isOpen() || p_current == NULL)
+    return false;
+
+  // compressed frames hold whole events, so an event that does not fit starts the next buffer,
+  // which is grown if the event does not fit in it either
+  if (m_codec && p_current->used + nBytes > p_current->size) {
+    if (p_current->eventEnd > 0 && !submitEvents())
+      return false;
+    if (p_current->used + nBytes > p_current->size && !growBuffer(*p_current, p_current->used + nBytes))
+      return false;
+  }
+  m_segmentBytes += nBytes;
+
+  size_t left = nBytes;
+  while (left > 0) {
+    if (p_current->used == p_current->size)
+      if (!submit())
+        return false;
+    size_t chunk = std::min(left, p_current->size - p_current->used);
+    memcpy(p_current->data+p_current->used, data, chunk);
+    p_current->used += chunk;
+    data += chunk;
+    left -= chunk;
+  }
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::writeHex(uint64_t const& word)
+{
+  char line[GEMHexCodec::kLINE_SIZE];
+  GEMHexCodec::encode(word, line);
+  return write(line, GEMHexCodec::kLINE_SIZE);
+}
+
+bool gem::readout::GEMEventWriter::setCompression(int const& level)
+{
+  if (isOpen()) {
+    WARN("GEMEventWriter::setCompression unable to change the compression while " << m_fileName << " is open");
+    return false;
+  }
+  if (level <= 0) {
+    m_codec.reset();
+    return true;
+  }
+  m_codec = std::unique_ptr<GEMFrameCodec>(new GEMFrameCodec(level));
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::setDirectIO(bool const& directIO)
+{
+  if (isOpen()) {
+    WARN("GEMEventWriter::setDirectIO unable to change the direct I/O while " << m_fileName << " is open");
+    return false;
+  }
+  m_directIO = directIO;
+  return true;
+}
+
+void gem::readout::GEMEventWriter::getWriteLatency(std::vector<uint64_t>& histogram) const
+{
+  histogram.resize(kN_LATENCY_BINS);
+  for (unsigned bin = 0; bin < kN_LATENCY_BINS; ++bin)
+    histogram[bin] = m_writeLatency[bin];
+}
+
+bool gem::readout::GEMEventWriter::submit()
+{
+  if (!m_writerTask) {
+    bool ok = writeOut(*p_current);
+    resetBuffer(*p_current);
+    return ok;
+  }
+
+  // there are never more buffers than the queue can hold
+  m_fullQueue->push(p_current);
+  ++m_submitted;
+
+  if (!m_freeQueue->pop(p_current)) {
+    // all buffers are waiting for the disk
+    ++m_stallCount;
+    while (!m_freeQueue->pop(p_current))
+      usleep(kIDLE_USEC);
+  }
+  resetBuffer(*p_current);
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::submitEvents()
+{
+  // the buffer is only read from once handed over, so the partial event can be copied out afterwards
+  char const*  partial = p_current->data + p_current->eventEnd;
+  size_t const nBytes  = p_current->used - p_current->eventEnd;
+  p_current->used = p_current->eventEnd;
+  if (!submit())
+    return false;
+  if (nBytes > p_current->size && !growBuffer(*p_current, nBytes))
+    return false;
+  memmove(p_current->data, partial, nBytes);
+  p_current->used = nBytes;
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::growBuffer(OutputBuffer& buffer, size_t const& size)
+{
+  size_t const newSize = ((size + kBUFFER_ALIGNMENT - 1)/kBUFFER_ALIGNMENT)*kBUFFER_ALIGNMENT;
+  void* buf = NULL;
+  if (posix_memalign(&buf, kBUFFER_ALIGNMENT, newSize) != 0) {
+    ERROR("GEMEventWriter::growBuffer unable to allocate " << newSize << " bytes for an event of " << m_fileName);
+    m_writeFailed = true;
+    return false;
+  }
+  memcpy(buf, buffer.data, buffer.used);
+  free(buffer.data);
+  buffer.data = static_cast<char*>(buf);
+  buffer.size = newSize;
+  DEBUG("GEMEventWriter::growBuffer grew a buffer to " << newSize << " bytes for an event of " << m_fileName);
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::growStaging(size_t const& size)
+{
+  if (size <= m_stagingSize)
+    return true;
+  void* buf = NULL;
+  if (posix_memalign(&buf, kBUFFER_ALIGNMENT, size) != 0) {
+    ERROR("GEMEventWriter::growStaging unable to allocate " << size << " bytes for the staging buffer");
+    return false;
+  }
+  if (m_carry > 0)
+    memcpy(buf, p_staging, m_carry);
+  free(p_staging);
+  p_staging     = static_cast<char*>(buf);
+  m_stagingSize = size;
+  return true;
+}
+
+bool gem::readout::GEMEventWriter::writeOut(OutputBuffer& buffer)
+{
+  bool ok = true;
+  // a buffer grown for a large event needs a larger staging buffer too
+  if (buffer.used > 0 && (m_codec || m_carry > 0))
+    if (!growStaging(m_carry + (m_codec ? GEMFrameCodec::maxFrameSize(buffer.used) : buffer.used))) {
+      m_writeFailed = true;
+      buffer.used   = 0;
+      ok = false;
+    }
+  if (buffer.used > 0) {
+    m_rawBytes   = m_rawBytes + buffer.used;
+    m_segmentRaw += buffer.used;
+
+    // the buffer is written as is, unless it is compressed or a partial block is waiting in front of it
+    char const* data   = buffer.data;
+    size_t      nBytes = buffer.used;
+    if (m_codec) {
+      struct timeval start, stop;
+      gettimeofday(&start, 0);
+      size_t frameSize = m_codec->compress(buffer.data, buffer.used, buffer.events, p_staging + m_carry);
+      gettimeofday(&stop, 0);
+      m_compressUsec = m_compressUsec + (stop.tv_sec-start.tv_sec)*1000000 + (stop.tv_usec-start.tv_usec);
+
+      if (frameSize == 0) {
+        ERROR("GEMEventWriter::writeOut failed compressing " << buffer.used << " bytes for " << m_fileName);
+        m_writeFailed = true;
+        ok = false;
+      }
+      data   = p_staging;
+      nBytes = frameSize > 0 ? m_carry + frameSize : 0;
+    } else if (m_carry > 0) {
+      memcpy(p_staging + m_carry, buffer.data, buffer.used);
+      data   = p_staging;
+      nBytes = m_carry + buffer.used;
+    }
+
+    if (nBytes > 0) {
+      if (m_directIO && (fcntl(m_fd, F_GETFL) & O_DIRECT)) {
+        ok = writeDirect(data, nBytes);
+      } else {
+        ok = writeBytes(data, nBytes);
+        m_carry = 0;
+      }
+    }
+    if (m_fsyncPolicy == FSYNC_BUFFER)
+      fdatasync(m_fd);
+  }
+  m_eventsOut        += buffer.events;
+  m_segmentEventsOut += buffer.events;
+
+  if (buffer.lastOfSegment) {
+    if (!writeCarry())
+      m_writeFailed = true;
+    m_carry = 0;
+    nextSegment();
+  }
+  return ok;
+}
+
+bool gem::readout::GEMEventWriter::writeDirect(char const* data, size_t const& nBytes)
+{
+  size_t const blocks = (nBytes/kBUFFER_ALIGNMENT)*kBUFFER_ALIGNMENT;
+  bool ok = true;
+  if (blocks > 0)
+    ok = writeBytes(data, blocks);
+
+  // the data is always at the start of an aligned buffer, the tail is moved to the front of the staging one
+  m_carry = nBytes - blocks;
+  if (m_carry > 0)
+    memmove(p_staging, data + blocks, m_carry);
+  return ok;
+}
+
+bool gem::readout::GEMEventWriter::writeCarry()
+{
+  if (m_carry == 0 || m_fd < 0)
+    return true;
+  // a partial block cannot go through O_DIRECT, and nothing else is written to this segment
+  clearDirectIO(m_fd);
+  bool ok = writeBytes(p_staging, m_carry);
+  m_carry = 0;
+  return ok;
+}
+
+void gem::readout::GEMEventWriter::clearDirectIO(int const fd)
+{
+  int const flags = fcntl(fd, F_GETFL);
+  if (flags >= 0 && (flags & O_DIRECT))
+    fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+}
+
+bool gem::readout::GEMEventWriter::writeBytes(char const* data, size_t const& nBytes)
+{
+  struct timeval start, stop;
+  gettimeofday(&start, 0);
+
+  bool ok = true;
+  size_t done = 0;
+  while (done < nBytes) {
+    ssize_t res = ::write(m_fd, data+done, nBytes-done);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EINVAL && m_directIO && (fcntl(m_fd, F_GETFL) & O_DIRECT)) {
+        // the file offset or the device do not allow direct I/O, carry on through the page cache
+        WARN("GEMEventWriter::writeBytes direct I/O rejected for " << m_fileName << ", writing through the page cache");
+        clearDirectIO(m_fd);
+        continue;
+      }
+      ERROR("GEMEventWriter::writeBytes failed writing to " << m_fileName << ": " << strerror(errno));
+      // drop what could not be written, rather than blocking the readout
+      m_writeFailed = true;
+      ok = false;
+      break;
+    }
+    done += res;
+  }
+
+  gettimeofday(&stop, 0);
+  uint64_t usec = (stop.tv_sec-start.tv_sec)*1000000 + (stop.tv_usec-start.tv_usec);
+  m_writeUsec    = m_writeUsec + usec;
+  if (usec > m_maxWriteUsec)
+    m_maxWriteUsec = usec;
+  unsigned bin = 0;
+  while (bin < kN_LATENCY_BINS-1 && (usec >> (bin+1)) > 0)
+    ++bin;
+  m_writeLatency[bin] = m_writeLatency[bin] + 1;
+  m_bytesWritten = m_bytesWritten + done;
+  m_segmentWritten += done;
+  m_flushCount   = m_flushCount + 1;
+  return ok;
+}
+
+gem::readout::GEMEventWriter::FsyncPolicy gem::readout::GEMEventWriter::parseFsyncPolicy(std::string const& policy)
+{
+  if (policy == "segment")
+    return FSYNC_SEGMENT;
+  if (policy == "buffer")
+    return FSYNC_BUFFER;
+  return FSYNC_NEVER;
+}
+
+std::string gem::readout::GEMEventWriter::segmentName(std::string const& fileName, uint32_t const& segment)
+{
+  char number[16];
+  snprintf(number, sizeof(number), "_%04u", segment);
+  // the number goes before the extension, if the file name has one
+  size_t const slash = fileName.rfind('/');
+  size_t const dot   = fileName.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    return fileName + number;
+  return fileName.substr(0, dot) + number + fileName.substr(dot);
+}
+
+bool gem::readout::GEMEventWriter::setRotation(uint64_t const& maxEvents, uint64_t const& maxBytes,
+                                               uint32_t const& maxSeconds)
+{
+  if (isOpen()) {
+    WARN("GEMEventWriter::setRotation unable to change the segmentation while " << m_fileName << " is open");
+    return false;
+  }
+  m_segmentMaxEvents  = maxEvents;
+  m_segmentMaxBytes   = maxBytes;
+  m_segmentMaxSeconds = maxSeconds;
+  return true;
+}
+
+void gem::readout::GEMEventWriter::checkRotation()
+{
+  if ((m_segmentMaxEvents  > 0 && m_segmentEvents >= m_segmentMaxEvents) ||
+      (m_segmentMaxBytes   > 0 && m_segmentBytes  >= m_segmentMaxBytes)  ||
+      (m_segmentMaxSeconds > 0 && time(0) - m_segmentStart >= static_cast<time_t>(m_segmentMaxSeconds))) {
+    // the buffer ends with this event, the segment is switched once it is written
+    p_current->lastOfSegment = true;
+    submit();
+    m_segmentEvents = 0;
+    m_segmentBytes  = 0;
+    m_segmentStart  = time(0);
+  }
+}
+
+int gem::readout::GEMEventWriter::openSegment(uint32_t const& segment)
+{
+  std::string const fileName = isRotating() ? segmentName(m_fileName, segment) : m_fileName;
+  int const flags = O_WRONLY | O_CREAT | O_APPEND;
+  int fd = -1;
+  if (m_directIO) {
+    fd = ::open(fileName.c_str(), flags | O_DIRECT, 0644);
+    if (fd < 0 && errno == EINVAL)
+      WARN("GEMEventWriter::openSegment " << fileName << " does not support direct I/O, writing through the page cache");
+  }
+  if (fd < 0)
+    fd = ::open(fileName.c_str(), flags, 0644);
+  if (fd < 0)
+    ERROR("GEMEventWriter::openSegment unable to open " << fileName << ": " << strerror(errno));
+  return fd;
+}
+
+void gem::readout::GEMEventWriter::nextSegment()
+{
+  int fd = m_spareFd;
+  m_spareFd = -1;
+  if (fd < 0)
+    fd = openSegment(m_segment+1);
+  if (fd < 0) {
+    // carry on in the current segment rather than losing data
+    m_writeFailed = true;
+    return;
+  }
+
+  // the caller keeps writing to the new segment while the old one is closed
+  int const oldFd = m_fd;
+  m_fd = fd;
+  closeSegment(oldFd);
+  m_lastSegmentSize = m_segmentWritten;
+
+  ++m_segment;
+  startSegment();
+  prepareSpare();
+}
+
+void gem::readout::GEMEventWriter::startSegment()
+{
+  m_segmentWritten    = 0;
+  m_segmentRaw        = 0;
+  m_segmentEventsOut  = 0;
+  m_segmentFirstEvent = m_eventsOut;
+  m_segmentOpened     = time(0);
+}
+
+void gem::readout::GEMEventWriter::prepareSpare()
+{
+  m_spareFd = openSegment(m_segment+1);
+  if (m_spareFd < 0)
+    return;
+
+  // the size of a segment is not known in advance, expect it to be like the limit or the last one
+  uint64_t const size = m_segmentMaxBytes > 0 ? m_segmentMaxBytes : m_lastSegmentSize;
+  if (size > 0 && fallocate(m_spareFd, FALLOC_FL_KEEP_SIZE, 0, size) != 0)
+    DEBUG("GEMEventWriter::prepareSpare unable to preallocate " << size << " bytes for "
+          << segmentName(m_fileName, m_segment+1) << ": " << strerror(errno));
+}
+
+void gem::readout::GEMEventWriter::closeSegment(int const fd)
+{
+  if (fd < 0)
+    return;
+
+  // preallocated blocks past the end of the data are released by truncating to the data
+  struct stat st;
+  if (fstat(fd, &st) == 0 && ftruncate(fd, st.st_size) != 0)
+    DEBUG("GEMEventWriter::closeSegment unable to release the preallocated space of segment " << m_segment);
+  if (m_fsyncPolicy != FSYNC_NEVER)
+    fsync(fd);
+  ::close(fd);
+
+  if (isRotating())
+    writeSegmentMeta();
+}
+
+void gem::readout::GEMEventWriter::writeSegmentMeta()
+{
+  std::string const fileName = segmentName(m_fileName, m_segment);
+  std::ofstream meta((fileName + ".meta").c_str());
+  meta << "file="       << fileName            << std::endl
+       << "segment="    << m_segment           << std::endl
+       << "firstEvent=" << m_segmentFirstEvent << std::endl
+       << "events="     << m_segmentEventsOut  << std::endl
+       << "bytes="      << m_segmentWritten    << std::endl
+       << "rawBytes="   << m_segmentRaw        << std::endl
+       << "compressed=" << (m_codec ? 1 : 0)   << std::endl
+       << "opened="     << m_segmentOpened     << std::endl
+       << "closed="     << time(0)             << std::endl;
+  if (!meta)
+    WARN("GEMEventWriter::writeSegmentMeta unable to write " << fileName << ".meta");
+}
+
+int gem::readout::GEMEventWriter::writerTask()
+{
+  OutputBuffer* buffer = NULL;
+  while (true) {
+    if (!m_fullQueue->pop(buffer)) {
+      if (m_writerExit)
+        break;
+      usleep(kIDLE_USEC);
+      continue;
+    }
+    writeOut(*buffer);
+    resetBuffer(*buffer);
+    m_freeQueue->push(buffer);
+    __sync_synchronize();
+    m_completed = m_completed + 1;
+  }
+  m_writerRunning = false;
+  return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * class: GEMFrameCodec
+ * description: Independently decodable deflate frames for the compressed
+ *              binary output type
+ */
+
+#include "gem/readout/GEMFrameCodec.h"
+
+#include <cstring>
+#include <zlib.h>
+
+const uint32_t gem::readout::GEMFrameCodec::kFRAME_MAGIC = 0x5a4d4547;  // "GEMZ" in the file
+const size_t   gem::readout::GEMFrameCodec::kHEADER_SIZE;
+
+gem::readout::GEMFrameCodec::GEMFrameCodec(int const& level) :
+  m_level(level < Z_BEST_SPEED ? Z_BEST_SPEED : (level > Z_BEST_COMPRESSION ? Z_BEST_COMPRESSION : level)),
+  p_stream(NULL)
+{
+  z_stream* stream = new z_stream;
+  memset(stream, 0, sizeof(z_stream));
+  if (deflateInit(stream, m_level) != Z_OK) {
+    delete stream;
+    return;
+  }
+  p_stream = stream;
+}
+
+gem::readout::GEMFrameCodec::~GEMFrameCodec()
+{
+  if (p_stream) {
+    z_stream* stream = static_cast<z_stream*>(p_stream);
+    deflateEnd(stream);
+    delete stream;
+  }
+  p_stream = NULL;
+}
+
+size_t gem::readout::GEMFrameCodec::maxFrameSize(size_t const& rawSize)
+{
+  return kHEADER_SIZE + compressBound(rawSize);
+}
+
+size_t gem::readout::GEMFrameCodec::compress(char const* raw, size_t const& rawSize, uint32_t const& nEvents,
+                                             char* frame)
+{
+  if (p_stream == NULL)
+    return 0;
+
+  // a fresh stream for every frame, so that frames do not depend on each other
+  z_stream* stream = static_cast<z_stream*>(p_stream);
+  if (deflateReset(stream) != Z_OK)
+    return 0;
+  stream->next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(raw));
+  stream->avail_in  = rawSize;
+  stream->next_out  = reinterpret_cast<Bytef*>(frame + kHEADER_SIZE);
+  stream->avail_out = compressBound(rawSize);
+  if (deflate(stream, Z_FINISH) != Z_STREAM_END)
+    return 0;
+
+  FrameHeader header = {kFRAME_MAGIC, static_cast<uint32_t>(stream->total_out),
+                        static_cast<uint32_t>(rawSize), nEvents};
+  memcpy(frame, &header, kHEADER_SIZE);
+  return kHEADER_SIZE + stream->total_out;
+}
+
+bool gem::readout::GEMFrameCodec::readHeader(char const* data, size_t const& size, FrameHeader& header)
+{
+  if (size < kHEADER_SIZE)
+    return false;
+  memcpy(&header, data, kHEADER_SIZE);
+  return header.magic == kFRAME_MAGIC;
+}
+
+bool gem::readout::GEMFrameCodec::decompress(char const* frame, size_t const& size, std::vector<char>& raw)
+{
+  FrameHeader header;
+  if (!readHeader(frame, size, header) || size < kHEADER_SIZE + header.compressedSize)
+    return false;
+
+  raw.resize(header.rawSize);
+  if (header.rawSize == 0)
+    return true;
+  uLongf rawSize = header.rawSize;
+  int res = uncompress(reinterpret_cast<Bytef*>(&raw[0]), &rawSize,
+                       reinterpret_cast<Bytef const*>(frame + kHEADER_SIZE), header.compressedSize);
+  return res == Z_OK && rawSize == header.rawSize;
+}
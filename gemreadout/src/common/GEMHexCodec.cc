@@ -0,0 +1,85 @@
+/**
+ * class: GEMHexCodec
+ * description: Table driven formatting and parsing of the hex output lines
+ */
+
+#include "gem/readout/GEMHexCodec.h"
+
+const size_t gem::readout::GEMHexCodec::kLINE_SIZE;
+
+char   gem::readout::GEMHexCodec::s_digitPairs[2*256];
+int8_t gem::readout::GEMHexCodec::s_digitValues[256];
+bool   gem::readout::GEMHexCodec::s_tablesFilled = gem::readout::GEMHexCodec::fillTables();
+
+size_t gem::readout::GEMHexCodec::encode(uint64_t const* words, size_t const& nWords, char* text)
+{
+  char* line = text;
+  for (size_t i = 0; i < nWords; ++i)
+    line = encode(words[i], line);
+  return line - text;
+}
+
+bool gem::readout::GEMHexCodec::decode(char const* digits, uint64_t& word)
+{
+  uint64_t value = 0;
+  int8_t   bad   = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    int8_t const digit = s_digitValues[static_cast<unsigned char>(digits[i])];
+    bad  |= digit;
+    value = (value << 4) | (digit & 0xf);
+  }
+  // invalid digits are -1, so the sign bit collects them all
+  if (bad < 0)
+    return false;
+  word = value;
+  return true;
+}
+
+bool gem::readout::GEMHexCodec::read(std::istream& in, uint64_t& word)
+{
+  std::streambuf* buf = in.rdbuf();
+  if (!in.good() || buf == NULL) {
+    in.setstate(std::ios::failbit);
+    return false;
+  }
+
+  int c = buf->sgetc();
+  while (c == ' ' || c == '\n' || c == '\t' || c == '\r')
+    c = buf->snextc();
+
+  uint64_t value   = 0;
+  unsigned nDigits = 0;
+  while (nDigits < 16 && c != std::char_traits<char>::eof()) {
+    int8_t const digit = s_digitValues[static_cast<unsigned char>(c)];
+    if (digit < 0)
+      break;
+    value = (value << 4) | digit;
+    ++nDigits;
+    c = buf->snextc();
+  }
+
+  if (c == std::char_traits<char>::eof())
+    in.setstate(std::ios::eofbit);
+  if (nDigits == 0) {
+    in.setstate(std::ios::failbit);
+    return false;
+  }
+  word = value;
+  return true;
+}
+
+bool gem::readout::GEMHexCodec::fillTables()
+{
+  char const digits[] = "0123456789abcdef";
+  for (unsigned byte = 0; byte < 256; ++byte) {
+    s_digitPairs[2*byte]   = digits[byte >> 4];
+    s_digitPairs[2*byte+1] = digits[byte & 0xf];
+    s_digitValues[byte]    = -1;
+  }
+  for (unsigned digit = 0; digit < 16; ++digit) {
+    s_digitValues[static_cast<unsigned char>(digits[digit])] = digit;
+    if (digit >= 10)
+      s_digitValues[static_cast<unsigned char>('A' + digit - 10)] = digit;
+  }
+  return true;
+}
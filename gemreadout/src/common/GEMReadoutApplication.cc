@@ -8,17 +8,23 @@
 
 #include "gem/readout/GEMReadoutApplication.h"
 
+#include <algorithm>
 #include <iomanip>
+#include <unistd.h>
 
 #include "toolbox/mem/Pool.h"
 #include "toolbox/mem/MemoryPoolFactory.h"
 #include "toolbox/mem/CommittedHeapAllocator.h"
+#include "toolbox/mem/exception/Exception.h"
 
 #include "gem/readout/GEMReadoutWebApplication.h"
 
 const int gem::readout::GEMReadoutApplication::I2O_READOUT_NOTIFY=0x84;
 const int gem::readout::GEMReadoutApplication::I2O_READOUT_CONFIRM=0x85;
 
+const unsigned gem::readout::GEMReadoutApplication::kBUILDER_IDLE_USEC  = 100;
+const unsigned gem::readout::GEMReadoutApplication::kDRAIN_TIMEOUT_MSEC = 5000;
+
 /*
   namespace gem {
   namespace readout {
@@ -42,6 +48,16 @@ gem::readout::GEMReadoutApplication::GEMReadoutSettings::GEMReadoutSettings() {
   outputType     = "Bin";
   outputLocation = "/tmp";
   setupLocation  = "";
+  poolSize       = 4096*4096;
+  frameSize      = 64*1024;
+  compressionLevel = 1;
+  segmentEvents  = 0;
+  segmentBytes   = 0;
+  segmentSeconds = 0;
+  fsyncPolicy    = "never";
+  directIO       = false;
+  zeroSuppress   = false;
+  sparseMaxStrips = 0;
 }
 
 void gem::readout::GEMReadoutApplication::GEMReadoutSettings::registerFields(xdata::Bag<gem::readout::GEMReadoutApplication::GEMReadoutSettings>* bag) {
@@ -51,6 +67,16 @@ void gem::readout::GEMReadoutApplication::GEMReadoutSettings::registerFields(xda
   bag->addField("outputType",     &outputType);
   bag->addField("outputLocation", &outputLocation);
   bag->addField("setupLocation",  &setupLocation);
+  bag->addField("poolSize",       &poolSize);
+  bag->addField("frameSize",      &frameSize);
+  bag->addField("compressionLevel", &compressionLevel);
+  bag->addField("segmentEvents",  &segmentEvents);
+  bag->addField("segmentBytes",   &segmentBytes);
+  bag->addField("segmentSeconds", &segmentSeconds);
+  bag->addField("fsyncPolicy",    &fsyncPolicy);
+  bag->addField("directIO",       &directIO);
+  bag->addField("zeroSuppress",   &zeroSuppress);
+  bag->addField("sparseMaxStrips", &sparseMaxStrips);
 }
 
 
@@ -58,11 +84,32 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
   throw (xdaq::exception::Exception) :
   gem::base::GEMFSMApplication(stub),
   m_outFileName(""),
+  m_pool(NULL),
+  m_readoutIdle(true),
+  m_builderIdle(true),
+  m_readoutDone(false),
+  m_builderExit(false),
+  m_builderDone(false),
   m_connectionFile("ConnectionFile"),
   m_deviceName("ReadoutDevice"),
   m_eventsReadout(0),
   m_usecPerEvent(0.0),
-  m_usecUsed(0.0)
+  m_usecUsed(0.0),
+  m_poolUsed(0),
+  m_poolHighWater(0),
+  m_poolExhausted(0),
+  m_framesQueued(0),
+  m_framesBuilt(0),
+  m_frameQueueDepth(0),
+  m_usecPerFrameBuilt(0.0),
+  m_bytesWritten(0),
+  m_usecPerMBWritten(0.0),
+  m_maxWriteUsec(0),
+  m_writerStalls(0),
+  m_compressionRatio(0.0),
+  m_compressMBPerSec(0.0),
+  m_outputSegment(0),
+  m_usecBuilt(0.0)
 {
   DEBUG("GEMReadoutApplication ctor begin");
   //i2o::bind(this,&ReadoutApplication::onReadoutNotify,I2O_READOUT_NOTIFY,XDAQ_ORGANIZATION_ID);
@@ -72,12 +119,43 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
   p_appInfoSpace->fireItemAvailable("ConnectionFile", &m_connectionFile);
   p_appInfoSpace->fireItemAvailable("EventsReadout",  &m_eventsReadout);
   p_appInfoSpace->fireItemAvailable("uSecPerEvent",   &m_usecPerEvent);
+  p_appInfoSpace->fireItemAvailable("PoolUsed",       &m_poolUsed);
+  p_appInfoSpace->fireItemAvailable("PoolHighWater",  &m_poolHighWater);
+  p_appInfoSpace->fireItemAvailable("PoolExhausted",  &m_poolExhausted);
+  p_appInfoSpace->fireItemAvailable("FramesQueued",      &m_framesQueued);
+  p_appInfoSpace->fireItemAvailable("FramesBuilt",       &m_framesBuilt);
+  p_appInfoSpace->fireItemAvailable("FrameQueueDepth",   &m_frameQueueDepth);
+  p_appInfoSpace->fireItemAvailable("uSecPerFrameBuilt", &m_usecPerFrameBuilt);
+  p_appInfoSpace->fireItemAvailable("BytesWritten",      &m_bytesWritten);
+  p_appInfoSpace->fireItemAvailable("uSecPerMBWritten",  &m_usecPerMBWritten);
+  p_appInfoSpace->fireItemAvailable("MaxWriteUSec",      &m_maxWriteUsec);
+  p_appInfoSpace->fireItemAvailable("WriterStalls",      &m_writerStalls);
+  p_appInfoSpace->fireItemAvailable("CompressionRatio",  &m_compressionRatio);
+  p_appInfoSpace->fireItemAvailable("CompressMBPerSec",  &m_compressMBPerSec);
+  p_appInfoSpace->fireItemAvailable("OutputSegment",     &m_outputSegment);
+  m_writeLatency.setSize(GEMEventWriter::kN_LATENCY_BINS);
+  p_appInfoSpace->fireItemAvailable("WriteLatencyHistogram", &m_writeLatency);
 
   p_appInfoSpace->addItemRetrieveListener("ReadoutSettings", this);
   p_appInfoSpace->addItemRetrieveListener("DeviceName",      this);
   p_appInfoSpace->addItemRetrieveListener("ConnectionFile",  this);
   p_appInfoSpace->addItemRetrieveListener("EventsReadout",   this);
   p_appInfoSpace->addItemRetrieveListener("uSecPerEvent",    this);
+  p_appInfoSpace->addItemRetrieveListener("PoolUsed",        this);
+  p_appInfoSpace->addItemRetrieveListener("PoolHighWater",   this);
+  p_appInfoSpace->addItemRetrieveListener("PoolExhausted",   this);
+  p_appInfoSpace->addItemRetrieveListener("FramesQueued",      this);
+  p_appInfoSpace->addItemRetrieveListener("FramesBuilt",       this);
+  p_appInfoSpace->addItemRetrieveListener("FrameQueueDepth",   this);
+  p_appInfoSpace->addItemRetrieveListener("uSecPerFrameBuilt", this);
+  p_appInfoSpace->addItemRetrieveListener("BytesWritten",      this);
+  p_appInfoSpace->addItemRetrieveListener("uSecPerMBWritten",  this);
+  p_appInfoSpace->addItemRetrieveListener("MaxWriteUSec",      this);
+  p_appInfoSpace->addItemRetrieveListener("WriterStalls",      this);
+  p_appInfoSpace->addItemRetrieveListener("CompressionRatio",  this);
+  p_appInfoSpace->addItemRetrieveListener("CompressMBPerSec",  this);
+  p_appInfoSpace->addItemRetrieveListener("OutputSegment",     this);
+  p_appInfoSpace->addItemRetrieveListener("WriteLatencyHistogram", this);
 
   p_appInfoSpace->addItemChangedListener( "ReadoutSettings", this);
   p_appInfoSpace->addItemChangedListener( "DeviceName",      this);
@@ -99,7 +177,7 @@ gem::readout::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub
 
 gem::readout::GEMReadoutApplication::~GEMReadoutApplication()
 {
-
+  stopThreads();
 }
 
 void gem::readout::GEMReadoutApplication::actionPerformed(xdata::Event& event)
@@ -126,31 +204,53 @@ void gem::readout::GEMReadoutApplication::initializeAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   DEBUG("gem::readout::GEMReadoutApplication::initializeAction begin");
-  if (!m_task) {
-    m_task = std::make_shared<gem::readout::GEMReadoutTask>(this);
-    m_task->activate();
-  } else {
-    m_cmdQueue.push(ReadoutCommands::CMD_STOP);
-  }
-
-  /*
   // create a pool
   if (!m_pool) {
     char poolname[128];
     snprintf(poolname,128,"GEMReadoutPool-%s-%d",getApplicationDescriptor()->getClassName().c_str(),(int)getApplicationDescriptor()->getInstance());
     try {
-      // 4k events at the average size
-      toolbox::mem::CommittedHeapAllocator* alloc = new toolbox::mem::CommittedHeapAllocator(4096*4096);
+      // default is 4k events at the average size
+      toolbox::mem::CommittedHeapAllocator* alloc =
+        new toolbox::mem::CommittedHeapAllocator(m_readoutSettings.bag.poolSize.value_);
       toolbox::net::URN urn("toolbox-mem-pool",poolname);
       m_pool = toolbox::mem::getMemoryPoolFactory()->createPool(urn,alloc);
+      DEBUG("GEMReadoutApplication::initializeAction created pool " << poolname << " of "
+            << m_readoutSettings.bag.poolSize.toString() << " bytes with "
+            << m_readoutSettings.bag.frameSize.toString() << " byte frames");
     } catch (xcept::Exception& e) {
       XCEPT_RETHROW(gem::base::exception::Exception,"Unable to create readout memory pool",e);
     }
   }
-  */
+
+  // the queue can hold every frame in the pool, so the pool is what limits the readout
+  if (!m_frameQueue) {
+    size_t nFrames = m_readoutSettings.bag.poolSize.value_/std::max(m_readoutSettings.bag.frameSize.value_, 1U);
+    m_frameQueue = std::unique_ptr<gem::utils::SPSCQueue<toolbox::mem::Reference*> >(
+      new gem::utils::SPSCQueue<toolbox::mem::Reference*>(nFrames+1));
+  }
+
+  if (!m_builder) {
+    m_builder = std::make_shared<gem::readout::GEMBuilderTask>(this);
+    m_builder->activate();
+  }
+
+  if (!m_task) {
+    m_task = std::make_shared<gem::readout::GEMReadoutTask>(this);
+    m_task->activate();
+  } else {
+    m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+  }
+
   m_eventsReadout.value_ = 0;
   m_usecPerEvent.value_  = 0;
   m_usecUsed = 0;
+  m_poolHighWater.value_ = 0;
+  m_poolExhausted.value_ = 0;
+  m_framesQueued.value_      = 0;
+  m_framesBuilt.value_       = 0;
+  m_usecPerFrameBuilt.value_ = 0;
+  m_usecBuilt = 0;
+  updatePoolCounters();
 }
 
 void gem::readout::GEMReadoutApplication::configureAction()
@@ -183,12 +283,15 @@ void gem::readout::GEMReadoutApplication::startAction()
   std::replace(date_and_time.begin(), date_and_time.end(), ' ', '_' );
   std::replace(date_and_time.begin(), date_and_time.end(), ':', '-');
   */
-  m_readoutSettings.bag.fileName = toolbox::toString("%s/run%06d_%s_%s_%s.dat",
+  // compressed files are frames of binary events, and cannot be read as plain binary ones
+  bool const compressed = m_readoutSettings.bag.outputType.toString() == "BinZ";
+  m_readoutSettings.bag.fileName = toolbox::toString("%s/run%06d_%s_%s_%s.%s",
                                                      m_readoutSettings.bag.outputLocation.toString().c_str(),
                                                      m_runNumber.value_,
                                                      m_readoutSettings.bag.runType.toString().c_str(),
                                                      m_readoutSettings.bag.setupLocation.toString().c_str(),
-                                                     date.str().c_str()
+                                                     date.str().c_str(),
+                                                     compressed ? "datz" : "dat"
                                                      );
 
   m_outFileName  = m_readoutSettings.bag.fileName.toString();
@@ -201,6 +304,7 @@ void gem::readout::GEMReadoutApplication::pauseAction()
 {
   DEBUG("gem::readout::GEMReadoutApplication::pauseAction begin");
   m_cmdQueue.push(ReadoutCommands::CMD_PAUSE);
+  drainPipeline();
 }
 
 void gem::readout::GEMReadoutApplication::resumeAction()
@@ -215,14 +319,17 @@ void gem::readout::GEMReadoutApplication::stopAction()
 {
   DEBUG("gem::readout::GEMReadoutApplication::stopAction begin");
   m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+  drainPipeline();
 }
 
 void gem::readout::GEMReadoutApplication::haltAction()
   /*throw (gem::readout::exception::Exception)*/
 {
   DEBUG("gem::readout::GEMReadoutApplication::haltAction begin");
-  if (m_task)
+  if (m_task) {
     m_cmdQueue.push(ReadoutCommands::CMD_STOP);
+    drainPipeline();
+  }
 }
 
 void gem::readout::GEMReadoutApplication::resetAction()
@@ -247,11 +354,12 @@ int gem::readout::GEMReadoutApplication::readoutTask()
 {
   bool isRunning(false), isDone(false);
   int nevtsRead(0);
-  // may at some point want to actually pass the memory
   std::vector<toolbox::mem::Reference* > data;
 
   while (!isDone) {
     if (!isRunning || m_cmdQueue.size() > 0) {
+      if (!isRunning)
+        m_readoutIdle = true;
       int cmd = m_cmdQueue.pop();
       switch(cmd) {
       case(ReadoutCommands::CMD_PAUSE) :
@@ -271,6 +379,7 @@ int gem::readout::GEMReadoutApplication::readoutTask()
         isRunning = false;
         break;
       }
+      m_readoutIdle = !isRunning;
     }
     if (isRunning) {
       data.clear();
@@ -284,13 +393,17 @@ int gem::readout::GEMReadoutApplication::readoutTask()
         ERROR(xcept::stdformat_exception_history(e));
       }
 
-      DEBUG("GEMReadoutApplication::readoutTask read " << nevtsRead << " events");
-      /*
-      for (int i = 0; i < nevtsRead; i++) {
-        DEBUG("GEMReadoutApplication::readoutTask releaseing data[" << i << "]");
-        data[i]->release();
+      // hand the filled frames to the builder, the empty ones go straight back
+      for (auto frame = data.begin(); frame != data.end(); ++frame) {
+        if ((*frame)->getDataSize() > 0 && m_frameQueue->push(*frame)) {
+          m_framesQueued.value_ = m_framesQueued.value_ + 1;
+        } else {
+          (*frame)->release();
+        }
       }
-      */
+      data.clear();
+      m_frameQueueDepth.value_ = m_frameQueue->size();
+
       if (nevtsRead > 0) {
         DEBUG("GEMReadoutApplication::readoutTask read " << nevtsRead << " events");
         gettimeofday(&stop,0);
@@ -301,5 +414,143 @@ int gem::readout::GEMReadoutApplication::readoutTask()
       }
     }
   }
+  m_readoutIdle = true;
+  m_readoutDone = true;
+  return 0;
+}
+
+int gem::readout::GEMReadoutApplication::builderTask()
+{
+  std::vector<toolbox::mem::Reference* > data;
+  toolbox::mem::Reference* frame = NULL;
+
+  while (!m_builderExit) {
+    m_builderIdle = false;
+    // take everything that is waiting in one go
+    while (m_frameQueue->pop(frame))
+      data.push_back(frame);
+
+    if (data.empty()) {
+      m_builderIdle = true;
+      usleep(kBUILDER_IDLE_USEC);
+      continue;
+    }
+
+    struct timeval start,stop;
+    gettimeofday(&start,0);
+    // nothing thrown by the processing may stop the builder, or the pipeline would never drain
+    try {
+      processData(data);
+    } catch (gem::base::exception::Exception& e) {
+      ERROR(xcept::stdformat_exception_history(e));
+    } catch (std::exception const& e) {
+      ERROR("GEMReadoutApplication::builderTask caught std::exception " << e.what());
+    } catch (...) {
+      ERROR("GEMReadoutApplication::builderTask caught unknown exception");
+    }
+    gettimeofday(&stop,0);
+
+    m_framesBuilt.value_ = m_framesBuilt.value_ + data.size();
+    m_usecBuilt += (stop.tv_sec-start.tv_sec)*1e6+(stop.tv_usec-start.tv_usec);
+    m_usecPerFrameBuilt.value_ = m_usecBuilt/m_framesBuilt.value_;
+
+    updatePoolCounters();
+    releaseFrames(data);
+  }
+  m_builderIdle = true;
+  m_builderDone = true;
   return 0;
 }
+
+void gem::readout::GEMReadoutApplication::drainPipeline()
+{
+  if (!m_frameQueue)
+    return;
+
+  for (unsigned msec = 0; msec < kDRAIN_TIMEOUT_MSEC; ++msec) {
+    __sync_synchronize();
+    if (m_readoutIdle && m_frameQueue->empty() && m_builderIdle)
+      return;
+    usleep(1000);
+  }
+  WARN("GEMReadoutApplication::drainPipeline timed out with " << m_frameQueue->size()
+       << " frames still queued for the builder");
+}
+
+void gem::readout::GEMReadoutApplication::stopThreads()
+{
+  // the threads use the frame queue, so they have to be gone before it is
+  if (m_task && !m_readoutDone) {
+    m_cmdQueue.push(ReadoutCommands::CMD_EXIT);
+    while (!m_readoutDone)
+      usleep(1000);
+  }
+  if (m_builder && !m_builderDone) {
+    m_builderExit = true;
+    while (!m_builderDone)
+      usleep(1000);
+  }
+
+  // frames the builder did not get to go back to the pool
+  if (m_frameQueue) {
+    toolbox::mem::Reference* frame = NULL;
+    while (m_frameQueue->pop(frame))
+      frame->release();
+  }
+}
+
+toolbox::mem::Reference* gem::readout::GEMReadoutApplication::allocateFrame()
+{
+  if (!m_pool)
+    return NULL;
+
+  try {
+    toolbox::mem::Reference* frame =
+      toolbox::mem::getMemoryPoolFactory()->getFrame(m_pool, m_readoutSettings.bag.frameSize.value_);
+    // frames start out empty, readout appends to them
+    frame->setDataSize(0);
+    return frame;
+  } catch (toolbox::mem::exception::Exception& e) {
+    // pool is full, the readout has to wait for the consumer to release frames
+    m_poolExhausted.value_ = m_poolExhausted.value_ + 1;
+    DEBUG("GEMReadoutApplication::allocateFrame pool exhausted: " << e.what());
+    return NULL;
+  }
+}
+
+void gem::readout::GEMReadoutApplication::releaseFrames(std::vector<toolbox::mem::Reference*>& data)
+{
+  for (auto frame = data.begin(); frame != data.end(); ++frame)
+    if (*frame)
+      (*frame)->release();
+  data.clear();
+}
+
+void gem::readout::GEMReadoutApplication::updateWriterCounters(GEMEventWriter const& writer)
+{
+  m_bytesWritten.value_ = writer.getBytesWritten();
+  if (writer.getBytesWritten() > 0)
+    m_usecPerMBWritten.value_ = writer.getWriteUsec()/(writer.getBytesWritten()/(1024.*1024.));
+  m_maxWriteUsec.value_ = writer.getMaxWriteUsec();
+  m_writerStalls.value_ = writer.getStallCount();
+  m_outputSegment.value_ = writer.getSegment();
+  std::vector<uint64_t> latency;
+  writer.getWriteLatency(latency);
+  for (size_t bin = 0; bin < latency.size() && bin < m_writeLatency.size(); ++bin)
+    m_writeLatency[bin] = latency[bin];
+  if (writer.isCompressed() && writer.getBytesWritten() > 0) {
+    m_compressionRatio.value_ = static_cast<double>(writer.getRawBytes())/writer.getBytesWritten();
+    if (writer.getCompressUsec() > 0)
+      m_compressMBPerSec.value_ = (writer.getRawBytes()/(1024.*1024.))/(writer.getCompressUsec()/1e6);
+  }
+}
+
+void gem::readout::GEMReadoutApplication::updatePoolCounters()
+{
+  if (!m_pool)
+    return;
+
+  m_poolUsed.value_ = m_pool->getMemoryUsage().getUsed();
+  if (m_poolUsed.value_ > m_poolHighWater.value_)
+    m_poolHighWater.value_ = m_poolUsed.value_;
+}
@@ -0,0 +1,41 @@
+/**
+ * class: GEMReadoutBuffer
+ * description: Contiguous buffer holding the raw tracking data words between
+ *              the FIFO block read and the event builder
+ */
+
+#include "gem/readout/GEMReadoutBuffer.h"
+
+#include <cstring>
+
+// enough for a full GLIB tracking data FIFO
+const size_t gem::readout::GEMReadoutBuffer::kDEFAULT_CAPACITY = 128*1024;
+
+gem::readout::GEMReadoutBuffer::GEMReadoutBuffer(size_t const& capacity) :
+  m_store(capacity > 0 ? capacity : 1),
+  m_head(0),
+  m_tail(0)
+{
+}
+
+uint32_t* gem::readout::GEMReadoutBuffer::reserve(size_t const& nWords)
+{
+  if (m_store.size() - m_tail < nWords) {
+    // reclaim the consumed words at the front first
+    size_t unread = size();
+    if (m_head > 0) {
+      if (unread > 0)
+        memmove(&m_store[0], &m_store[0] + m_head, unread*sizeof(uint32_t));
+      m_head = 0;
+      m_tail = unread;
+    }
+    // only grow when compacting is not sufficient
+    if (m_store.size() - m_tail < nWords) {
+      size_t newSize = m_store.size();
+      while (newSize - m_tail < nWords)
+        newSize *= 2;
+      m_store.resize(newSize);
+    }
+  }
+  return &m_store[0] + m_tail;
+}
@@ -0,0 +1,47 @@
+/**
+ * class: GEMVFATDecoder
+ * description: Unpacks the raw VFAT blocks of the tracking data FIFO into
+ *              the VFATData structure of the AMC data format
+ */
+
+#include "gem/readout/GEMVFATDecoder.h"
+
+const size_t gem::readout::GEMVFATDecoder::kBLOCK_WORDS;
+
+size_t gem::readout::GEMVFATDecoder::decode(uint32_t const* words, size_t const& nWords,
+                                            GEMDataAMCformat::VFATData* out)
+{
+  size_t const nBlocks = nWords/kBLOCK_WORDS;
+  // independent iterations, no data dependent branches
+  for (size_t block = 0; block < nBlocks; ++block)
+    decode(words + block*kBLOCK_WORDS, out[block]);
+  return nBlocks;
+}
+
+size_t gem::readout::GEMVFATDecoder::findBlockStart(uint32_t const* words, size_t const& nWords)
+{
+  if (nWords < 2)
+    return (nWords == 1 && isBlockStart(words[0])) ? 0 : nWords;
+
+  // candidate positions 0..last have the word after them to check the second marker
+  size_t const last = nWords - 2;
+  size_t pos = 0;
+
+  // test four positions per iteration and only branch on the combined result
+  for ( ; pos + 3 <= last; pos += 4) {
+    unsigned const found =
+      (isBlockHeader(words[pos],   words[pos+1])     ) |
+      (isBlockHeader(words[pos+1], words[pos+2]) << 1) |
+      (isBlockHeader(words[pos+2], words[pos+3]) << 2) |
+      (isBlockHeader(words[pos+3], words[pos+4]) << 3);
+    if (found)
+      return pos + __builtin_ctz(found);
+  }
+  for ( ; pos <= last; ++pos)
+    if (isBlockHeader(words[pos], words[pos+1]))
+      return pos;
+  // the last word can still be the first word of a block whose second word has not arrived yet
+  if (isBlockStart(words[nWords-1]))
+    return nWords-1;
+  return nWords;
+}
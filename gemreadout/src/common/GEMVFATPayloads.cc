@@ -0,0 +1,44 @@
+/**
+ * class: GEMVFATPayloads
+ * description: Field by field storage of the VFAT blocks of an event
+ */
+
+#include "gem/readout/GEMVFATPayloads.h"
+
+const size_t gem::readout::GEMVFATPayloads::kDEFAULT_CAPACITY;
+
+gem::readout::GEMVFATPayloads::GEMVFATPayloads(size_t const& capacity) :
+  m_size(0)
+{
+  reserve(capacity > 0 ? capacity : 1);
+}
+
+void gem::readout::GEMVFATPayloads::reserve(size_t const& capacity)
+{
+  if (capacity <= m_BC.size())
+    return;
+  // the arrays are used up to m_size only, resizing keeps their contents
+  m_BC.resize(capacity);
+  m_EC.resize(capacity);
+  m_ChipID.resize(capacity);
+  m_lsData.resize(capacity);
+  m_msData.resize(capacity);
+  m_BXfrOH.resize(capacity);
+  m_crc.resize(capacity);
+}
+
+void gem::readout::GEMVFATPayloads::assign(GEMDataAMCformat::VFATData const* vfats, size_t const& nVFATs)
+{
+  reserve(nVFATs);
+  m_size = 0;
+  for (size_t i = 0; i < nVFATs; ++i)
+    push_back(vfats[i]);
+}
+
+size_t gem::readout::GEMVFATPayloads::countHits() const
+{
+  size_t nHits = 0;
+  for (size_t i = 0; i < m_size; ++i)
+    nHits += __builtin_popcountll(m_lsData[i]) + __builtin_popcountll(m_msData[i]);
+  return nHits;
+}
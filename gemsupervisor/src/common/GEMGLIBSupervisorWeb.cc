@@ -734,8 +734,10 @@ bool gem::supervisor::GEMGLIBSupervisorWeb::selectAction(toolbox::task::WorkLoop
     return true;
   else if (gemDataParker->queueDepth() > 0)
     return true;
-  else
-    return false;
+
+  // the queue has drained after the stop, push any buffered output to disk
+  gemDataParker->flush();
+  return false;
 }
 
 
@@ -1014,6 +1016,8 @@ void gem::supervisor::GEMGLIBSupervisorWeb::stopAction(toolbox::Event::Reference
   // once more for luck
   glibDevice_->flushFIFO(readout_mask);
 
+  // the buffered output is flushed by selectAction once it has drained the queue,
+  // this transition runs on the same workloop so it cannot wait for it here
   wl_->submit(select_signature_);
 }
 
@@ -0,0 +1,191 @@
+/** @file HwLock.h */
+
+#ifndef GEM_UTILS_HWLOCK_H
+#define GEM_UTILS_HWLOCK_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <pthread.h>
+#include <stdint.h>
+
+namespace gem {
+  namespace utils {
+
+    /**
+     * @class HwLock
+     * @brief Serializes the access to a hardware device, and records how long it is waited for and held
+     *
+     * The exclusive lock is recursive for the thread holding it. When it is released,
+     * the waiting threads get it in order of their access class, readout first, then
+     * control, then monitoring, and no thread takes it while a thread of a higher class
+     * is waiting. The access class belongs to the calling thread and is set with an
+     * AccessScope, threads that set none are CONTROL.
+     *
+     * The shared lock can be held by several threads at once, for state that is only
+     * read, and excludes the exclusive lock. It is not taken while any thread waits for
+     * the exclusive lock. A thread holding the exclusive lock may take the shared one,
+     * which then counts as a recursive exclusive lock, but a thread holding only the
+     * shared lock must release it before taking the exclusive one.
+     *
+     * The objects accessing the same device, e.g., the ones the manager and the readout
+     * application of a card each create, get one lock from getDeviceLock, so that the
+     * priorities apply between them. This only holds within one process.
+     */
+    class HwLock
+    {
+    public:
+      enum Access {
+        MONITOR = 0,  ///< periodic monitoring, which can wait
+        CONTROL = 1,  ///< configuration and user requests
+        READOUT = 2   ///< data taking, which should not wait
+      };
+      static const unsigned kN_ACCESS = 3;
+
+      /**
+       * @struct Stats
+       * @brief Contention counters of the lock, all times in microseconds
+       * @var Stats::nLocks
+       * nLocks is the number of times the exclusive lock was taken, not counting recursive locks
+       * @var Stats::nSharedLocks
+       * nSharedLocks is the number of times the shared lock was taken
+       * @var Stats::nContended
+       * nContended is the number of locks, exclusive or shared, that had to wait
+       * @var Stats::waitTime
+       * waitTime is the total time waited for the lock by each access class
+       * @var Stats::maxWaitTime
+       * maxWaitTime is the longest single wait
+       * @var Stats::holdTime
+       * holdTime is the total time the exclusive lock was held
+       * @var Stats::maxHoldTime
+       * maxHoldTime is the longest time the exclusive lock was held
+       */
+      typedef struct Stats {
+        uint64_t nLocks;
+        uint64_t nSharedLocks;
+        uint64_t nContended;
+        uint64_t waitTime[kN_ACCESS];
+        uint64_t maxWaitTime;
+        uint64_t holdTime;
+        uint64_t maxHoldTime;
+
+        Stats() { reset(); };
+        void reset() {
+          nLocks = 0; nSharedLocks = 0; nContended = 0;
+          for (unsigned access = 0; access < kN_ACCESS; ++access)
+            waitTime[access] = 0;
+          maxWaitTime = 0; holdTime = 0; maxHoldTime = 0;
+          return; };
+      } Stats;
+
+      /**
+       * @class AccessScope
+       * @brief Sets the access class of the calling thread until the end of the scope
+       */
+      class AccessScope
+      {
+      public:
+        explicit AccessScope(Access const& access);
+        ~AccessScope();
+
+      private:
+        int m_previous;
+
+        // Prevent copying.
+        AccessScope(AccessScope const&);
+        AccessScope& operator=(AccessScope const&);
+      };  // class AccessScope
+
+      HwLock();
+      ~HwLock();
+
+      void lock();
+      void unlock();
+
+      void lockShared();
+      void unlockShared();
+
+      /**
+       * @returns a snapshot of the contention counters
+       */
+      Stats getStats() const;
+
+      void resetStats();
+
+      /**
+       * @returns the access class of the calling thread
+       */
+      static Access getAccess() { return static_cast<Access>(s_access); };
+
+      /**
+       * @param device name of the device
+       * @returns the lock shared by all the users of the device in this process,
+       *          created on the first call
+       */
+      static std::shared_ptr<HwLock> getDeviceLock(std::string const& device);
+
+    private:
+      static uint64_t now();
+
+      /**
+       * @returns whether a thread of the given class can take the exclusive lock now,
+       *          must be called with m_mutex held
+       */
+      bool isAvailable(unsigned const& access) const;
+
+      /**
+       * @returns whether the shared lock can be taken now, must be called with m_mutex held
+       */
+      bool isSharedAvailable() const;
+
+      bool isOwner() const { return m_owned && pthread_equal(m_owner, pthread_self()); };
+
+      void recordWait(unsigned const& access, uint64_t const& waited);
+
+      mutable pthread_mutex_t m_mutex;
+      pthread_cond_t          m_released;
+
+      pthread_t m_owner;
+      bool      m_owned;
+      unsigned  m_depth;
+      unsigned  m_nShared;
+      unsigned  m_nWaiting[kN_ACCESS];
+      uint64_t  m_lockedAt;
+
+      Stats m_stats;
+
+      static __thread int s_access;
+
+      // locks of the devices still in use, see getDeviceLock
+      static pthread_mutex_t s_devicesMutex;
+      static std::map<std::string, std::weak_ptr<HwLock> > s_devices;
+
+      // Prevent copying.
+      HwLock(HwLock const&);
+      HwLock& operator=(HwLock const&);
+    };  // class HwLock
+
+    /**
+     * @class SharedLockGuard
+     * @brief Holds the shared lock of a lock until the end of the scope
+     */
+    template <class L>
+      class SharedLockGuard
+      {
+      public:
+        SharedLockGuard(L& lock) : m_lock(lock) { m_lock.lockShared(); };
+        ~SharedLockGuard() { m_lock.unlockShared(); };
+
+      private:
+        L& m_lock;
+
+        // Prevent copying.
+        SharedLockGuard(SharedLockGuard const&);
+        SharedLockGuard& operator=(SharedLockGuard const&);
+      };  // class SharedLockGuard
+
+  }  // namespace gem::utils
+}  // namespace gem
+
+#endif  // GEM_UTILS_HWLOCK_H
@@ -0,0 +1,142 @@
+/** @file SPSCQueue.h */
+
+#ifndef GEM_UTILS_SPSCQUEUE_H
+#define GEM_UTILS_SPSCQUEUE_H
+
+#include <cstddef>
+
+namespace gem {
+  namespace utils {
+
+    /**
+     * @class SPSCQueue
+     * @brief Fixed size, lock free queue for passing items from exactly one
+     *        producer thread to exactly one consumer thread
+     *
+     * Neither push nor pop ever block, push fails when the queue is full and
+     * pop fails when it is empty, it is up to the caller to decide how to wait.
+     * The producer only ever writes the tail index and the consumer only the
+     * head index, so the only synchronisation needed is a memory barrier
+     * between writing an element and publishing the new index.
+     */
+    template <class T>
+      class SPSCQueue
+      {
+      public:
+        /**
+         * SPSCQueue constructor
+         * @param capacity minimum number of items the queue must be able to hold
+         */
+        SPSCQueue(size_t const& capacity);
+        ~SPSCQueue();
+
+        /**
+         * Called by the producer only
+         * @returns false if the queue is full
+         */
+        bool push(T const& item);
+
+        /**
+         * Called by the consumer only
+         * @returns false if the queue is empty
+         */
+        bool pop(T& item);
+
+        /**
+         * Number of items in the queue, only a snapshot when called while the other side is active
+         */
+        size_t size() const;
+        bool   empty() const { return size() == 0; };
+
+        size_t capacity() const { return m_mask; };
+
+      private:
+        static size_t load(size_t const& index);
+        static void   store(size_t& index, size_t const& value);
+
+        size_t const m_mask;
+        T*           p_items;
+
+        // keep the two indices on separate cache lines
+        char   m_pad0[64];
+        size_t m_head;  ///< next item to pop, written by the consumer
+        char   m_pad1[64];
+        size_t m_tail;  ///< next free slot, written by the producer
+        char   m_pad2[64];
+
+        static size_t roundUp(size_t const& n) {
+          size_t size = 2;
+          while (size < n)
+            size <<= 1;
+          return size;
+        };
+
+        // Prevent copying.
+        SPSCQueue(SPSCQueue const&);
+        SPSCQueue& operator=(SPSCQueue const&);
+      };
+
+  }  // namespace utils
+}  // namespace gem
+
+template <class T>
+gem::utils::SPSCQueue<T>::SPSCQueue(size_t const& capacity) :
+  // one slot is always left empty to tell a full queue from an empty one
+  m_mask(roundUp(capacity+1)-1),
+  p_items(new T[m_mask+1]),
+  m_head(0),
+  m_tail(0)
+{
+}
+
+template <class T>
+gem::utils::SPSCQueue<T>::~SPSCQueue()
+{
+  delete[] p_items;
+}
+
+template <class T>
+size_t gem::utils::SPSCQueue<T>::load(size_t const& index)
+{
+  size_t value = *static_cast<size_t const volatile*>(&index);
+  __sync_synchronize();
+  return value;
+}
+
+template <class T>
+void gem::utils::SPSCQueue<T>::store(size_t& index, size_t const& value)
+{
+  __sync_synchronize();
+  *static_cast<size_t volatile*>(&index) = value;
+}
+
+template <class T>
+bool gem::utils::SPSCQueue<T>::push(T const& item)
+{
+  size_t const tail = m_tail;
+  size_t const next = (tail+1) & m_mask;
+  if (next == load(m_head))
+    return false;
+  p_items[tail] = item;
+  store(m_tail, next);
+  return true;
+}
+
+template <class T>
+bool gem::utils::SPSCQueue<T>::pop(T& item)
+{
+  size_t const head = m_head;
+  if (head == load(m_tail))
+    return false;
+  item = p_items[head];
+  store(m_head, (head+1) & m_mask);
+  return true;
+}
+
+template <class T>
+size_t gem::utils::SPSCQueue<T>::size() const
+{
+  return (load(m_tail) - load(m_head)) & m_mask;
+}
+
+#endif  // GEM_UTILS_SPSCQUEUE_H
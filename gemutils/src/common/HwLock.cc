@@ -0,0 +1,181 @@
+/**
+ * class: HwLock
+ * description: Prioritized, instrumented lock for the access to a hardware device
+ */
+
+#include "gem/utils/HwLock.h"
+
+#include <sys/time.h>
+
+const unsigned gem::utils::HwLock::kN_ACCESS;
+
+__thread int gem::utils::HwLock::s_access = gem::utils::HwLock::CONTROL;
+
+pthread_mutex_t gem::utils::HwLock::s_devicesMutex = PTHREAD_MUTEX_INITIALIZER;
+std::map<std::string, std::weak_ptr<gem::utils::HwLock> > gem::utils::HwLock::s_devices;
+
+gem::utils::HwLock::AccessScope::AccessScope(Access const& access) :
+  m_previous(s_access)
+{
+  s_access = access;
+}
+
+gem::utils::HwLock::AccessScope::~AccessScope()
+{
+  s_access = m_previous;
+}
+
+gem::utils::HwLock::HwLock() :
+  m_owned(false),
+  m_depth(0),
+  m_nShared(0),
+  m_lockedAt(0)
+{
+  pthread_mutex_init(&m_mutex, NULL);
+  pthread_cond_init(&m_released, NULL);
+  for (unsigned access = 0; access < kN_ACCESS; ++access)
+    m_nWaiting[access] = 0;
+}
+
+gem::utils::HwLock::~HwLock()
+{
+  pthread_cond_destroy(&m_released);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+void gem::utils::HwLock::lock()
+{
+  unsigned const access = s_access;
+  pthread_mutex_lock(&m_mutex);
+  if (isOwner()) {
+    ++m_depth;
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+
+  if (!isAvailable(access)) {
+    uint64_t const start = now();
+    ++m_nWaiting[access];
+    while (!isAvailable(access))
+      pthread_cond_wait(&m_released, &m_mutex);
+    --m_nWaiting[access];
+    recordWait(access, now() - start);
+  }
+  m_owner    = pthread_self();
+  m_owned    = true;
+  m_depth    = 1;
+  m_lockedAt = now();
+  ++m_stats.nLocks;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void gem::utils::HwLock::unlock()
+{
+  pthread_mutex_lock(&m_mutex);
+  // releasing a lock this thread does not hold is ignored
+  if (isOwner() && --m_depth == 0) {
+    uint64_t const held = now() - m_lockedAt;
+    m_stats.holdTime += held;
+    if (held > m_stats.maxHoldTime)
+      m_stats.maxHoldTime = held;
+    m_owned = false;
+    pthread_cond_broadcast(&m_released);
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void gem::utils::HwLock::lockShared()
+{
+  unsigned const access = s_access;
+  pthread_mutex_lock(&m_mutex);
+  if (isOwner()) {
+    ++m_depth;
+    pthread_mutex_unlock(&m_mutex);
+    return;
+  }
+
+  if (!isSharedAvailable()) {
+    uint64_t const start = now();
+    while (!isSharedAvailable())
+      pthread_cond_wait(&m_released, &m_mutex);
+    recordWait(access, now() - start);
+  }
+  ++m_nShared;
+  ++m_stats.nSharedLocks;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void gem::utils::HwLock::unlockShared()
+{
+  pthread_mutex_lock(&m_mutex);
+  if (isOwner()) {
+    pthread_mutex_unlock(&m_mutex);
+    unlock();
+    return;
+  }
+  if (m_nShared > 0 && --m_nShared == 0)
+    pthread_cond_broadcast(&m_released);
+  pthread_mutex_unlock(&m_mutex);
+}
+
+gem::utils::HwLock::Stats gem::utils::HwLock::getStats() const
+{
+  pthread_mutex_lock(&m_mutex);
+  Stats stats = m_stats;
+  pthread_mutex_unlock(&m_mutex);
+  return stats;
+}
+
+void gem::utils::HwLock::resetStats()
+{
+  pthread_mutex_lock(&m_mutex);
+  m_stats.reset();
+  pthread_mutex_unlock(&m_mutex);
+}
+
+std::shared_ptr<gem::utils::HwLock> gem::utils::HwLock::getDeviceLock(std::string const& device)
+{
+  pthread_mutex_lock(&s_devicesMutex);
+  std::shared_ptr<HwLock> lock = s_devices[device].lock();
+  if (!lock) {
+    lock = std::make_shared<HwLock>();
+    s_devices[device] = lock;
+  }
+  pthread_mutex_unlock(&s_devicesMutex);
+  return lock;
+}
+
+uint64_t gem::utils::HwLock::now()
+{
+  timeval tv;
+  gettimeofday(&tv, 0);
+  return static_cast<uint64_t>(tv.tv_sec)*1000000 + tv.tv_usec;
+}
+
+bool gem::utils::HwLock::isAvailable(unsigned const& access) const
+{
+  if (m_owned || m_nShared > 0)
+    return false;
+  for (unsigned higher = access+1; higher < kN_ACCESS; ++higher)
+    if (m_nWaiting[higher] > 0)
+      return false;
+  return true;
+}
+
+bool gem::utils::HwLock::isSharedAvailable() const
+{
+  if (m_owned)
+    return false;
+  for (unsigned access = 0; access < kN_ACCESS; ++access)
+    if (m_nWaiting[access] > 0)
+      return false;
+  return true;
+}
+
+void gem::utils::HwLock::recordWait(unsigned const& access, uint64_t const& waited)
+{
+  ++m_stats.nContended;
+  m_stats.waitTime[access] += waited;
+  if (waited > m_stats.maxWaitTime)
+    m_stats.maxWaitTime = waited;
+}